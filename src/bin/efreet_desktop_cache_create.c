@@ -5,6 +5,8 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
+#include <ctype.h>
+#include <locale.h>
 
 #include <Eina.h>
 #include <Eet.h>
@@ -26,8 +28,13 @@ static Eina_Hash *desktops = NULL;
 
 static Eina_Hash         *file_ids = NULL;
 static Efreet_Cache_Hash *old_file_ids = NULL;
+static long long          old_serial = 0;
 static Eina_Hash         *paths = NULL;
 
+/* orig_paths in the old cache, and the ones which had to be parsed again */
+static Eina_Hash         *old_paths = NULL;
+static Eina_Hash         *modified_paths = NULL;
+
 static Eina_Hash *mime_types = NULL;
 static Eina_Hash *categories = NULL;
 static Eina_Hash *startup_wm_class = NULL;
@@ -35,6 +42,32 @@ static Eina_Hash *name = NULL;
 static Eina_Hash *generic_name = NULL;
 static Eina_Hash *comment = NULL;
 static Eina_Hash *exec = NULL;
+/* normalized names, see efreet_util_desktop_wm_class_match() */
+static Eina_Hash *wm_class_index = NULL;
+
+/* mtime and entries of every scanned dir, unchanged dirs are not listed again */
+static Efreet_Cache_Hash *old_manifest = NULL;
+static Eina_Hash         *manifest = NULL;
+
+/* When there is no cache yet, all desktop files have to be parsed. Then
+ * the files are parsed by a pool of worker threads while the dirs are
+ * still listed, and the main thread stores the results in scan order so
+ * that file id shadowing is the same as in a sequential run. */
+typedef struct _Cache_Job Cache_Job;
+struct _Cache_Job
+{
+    const char *path;
+    const char *file_id;
+    Efreet_Desktop *desk;
+    Eina_Bool done:1;
+};
+
+static Eina_Array *jobs = NULL;
+static unsigned int jobs_next = 0;
+static int jobs_workers = 0;
+static Eina_Bool jobs_listed = EINA_FALSE;
+static Eina_Lock jobs_lock;
+static Eina_Condition jobs_cond;
 
 static int
 strcmplen(const void *data1, const void *data2)
@@ -42,16 +75,203 @@ strcmplen(const void *data1, const void *data2)
     return strncmp(data1, data2, eina_stringshare_strlen(data1));
 }
 
+static Eina_Bool
+cache_is_desktop_file(const char *path)
+{
+    const char *ext;
+
+    ext = strrchr(path, '.');
+    return (ext && (!strcmp(ext, ".desktop") || !strcmp(ext, ".directory")));
+}
+
+static void
+cache_dir_free(Efreet_Cache_Desktop_Dir *dcache)
+{
+    unsigned int i;
+
+    for (i = 0; i < dcache->entries_count; i++)
+        eina_stringshare_del(dcache->entries[i]);
+    free(dcache->entries);
+    free(dcache);
+}
+
+static Eina_Bool
+cache_old_dir_free(const Eina_Hash *hash __UNUSED__, const void *key __UNUSED__,
+                   void *data, void *fdata __UNUSED__)
+{
+    Efreet_Cache_Desktop_Dir *dcache = data;
+
+    free(dcache->entries);
+    free(dcache);
+    return EINA_TRUE;
+}
+
+static void
+cache_manifest_free(void)
+{
+    if (old_manifest)
+    {
+        eina_hash_foreach(old_manifest->hash, cache_old_dir_free, NULL);
+        eina_hash_free(old_manifest->hash);
+        free(old_manifest);
+        old_manifest = NULL;
+    }
+    IF_FREE_HASH(manifest);
+}
+
+static void
+cache_job_parse(void *data __UNUSED__, Ecore_Thread *thread __UNUSED__)
+{
+    Cache_Job *job;
+
+    eina_lock_take(&jobs_lock);
+    for (;;)
+    {
+        while ((jobs_next >= jobs->count) && !jobs_listed)
+            eina_condition_wait(&jobs_cond);
+        if (jobs_next >= jobs->count) break;
+
+        job = jobs->data[jobs_next++];
+        eina_lock_release(&jobs_lock);
+
+        job->desk = efreet_desktop_uncached_new(job->path);
+
+        eina_lock_take(&jobs_lock);
+        job->done = EINA_TRUE;
+        eina_condition_broadcast(&jobs_cond);
+    }
+    jobs_workers--;
+    eina_condition_broadcast(&jobs_cond);
+    eina_lock_release(&jobs_lock);
+}
+
+static Eina_Bool
+cache_jobs_start(int threads)
+{
+    int i;
+
+    if (!eina_threads_init()) return EINA_FALSE;
+    if (!eina_lock_new(&jobs_lock))
+    {
+        eina_threads_shutdown();
+        return EINA_FALSE;
+    }
+    if (!eina_condition_new(&jobs_cond, &jobs_lock))
+    {
+        eina_lock_free(&jobs_lock);
+        eina_threads_shutdown();
+        return EINA_FALSE;
+    }
+    jobs = eina_array_new(64);
+
+    /* the parser maps the files, make sure it is set up before the
+     * workers race for it */
+    eina_mmap_safety_enabled_set(EINA_TRUE);
+
+    if (ecore_thread_max_get() < threads)
+        ecore_thread_max_set(threads);
+    for (i = 0; i < threads; i++)
+    {
+        jobs_workers++;
+        if (!ecore_thread_run(cache_job_parse, NULL, NULL, NULL))
+            jobs_workers--;
+    }
+    INF("parsing with %d threads", jobs_workers);
+    return EINA_TRUE;
+}
+
+static int
+cache_job_add(const char *path, const char *file_id)
+{
+    Cache_Job *job;
+
+    job = NEW(Cache_Job, 1);
+    if (!job) return 0;
+    job->path = eina_stringshare_add(path);
+    job->file_id = eina_stringshare_add(file_id);
+
+    eina_lock_take(&jobs_lock);
+    eina_array_push(jobs, job);
+    eina_condition_broadcast(&jobs_cond);
+    eina_lock_release(&jobs_lock);
+    return 1;
+}
+
+static void
+cache_jobs_stop(void)
+{
+    Cache_Job *job;
+    unsigned int i;
+
+    if (!jobs) return;
+
+    /* let the workers run dry */
+    eina_lock_take(&jobs_lock);
+    jobs_listed = EINA_TRUE;
+    jobs_next = jobs->count;
+    eina_condition_broadcast(&jobs_cond);
+    while (jobs_workers > 0)
+        eina_condition_wait(&jobs_cond);
+    eina_lock_release(&jobs_lock);
+
+    for (i = 0; i < jobs->count; i++)
+    {
+        job = jobs->data[i];
+        if (job->desk) efreet_desktop_free(job->desk);
+        eina_stringshare_del(job->path);
+        eina_stringshare_del(job->file_id);
+        free(job);
+    }
+    eina_array_free(jobs);
+    jobs = NULL;
+    eina_condition_free(&jobs_cond);
+    eina_lock_free(&jobs_lock);
+    eina_threads_shutdown();
+}
+
+static int cache_store(Efreet_Desktop *desk, const char *file_id, int *changed);
+
+static int
+cache_jobs_store(int *changed)
+{
+    Cache_Job *job;
+    Efreet_Desktop *desk;
+    unsigned int i;
+
+    eina_lock_take(&jobs_lock);
+    jobs_listed = EINA_TRUE;
+    eina_condition_broadcast(&jobs_cond);
+    for (i = 0; i < jobs->count; i++)
+    {
+        job = jobs->data[i];
+        while (!job->done)
+            eina_condition_wait(&jobs_cond);
+        desk = job->desk;
+        job->desk = NULL;
+        eina_lock_release(&jobs_lock);
+
+        if (desk)
+        {
+            INF("  NEW: %s", desk->orig_path);
+            *changed = 1;
+            if (!cache_store(desk, job->file_id, changed)) return 0;
+        }
+
+        eina_lock_take(&jobs_lock);
+    }
+    eina_lock_release(&jobs_lock);
+    return 1;
+}
+
 static int
 cache_add(const char *path, const char *file_id, int priority __UNUSED__, int *changed)
 {
     Efreet_Desktop *desk;
-    char *ext;
 
     INF("FOUND: %s", path);
     if (file_id) INF(" (id): %s", file_id);
-    ext = strrchr(path, '.');
-    if (!ext || (strcmp(ext, ".desktop") && strcmp(ext, ".directory"))) return 1;
+    if (!cache_is_desktop_file(path)) return 1;
+    if (jobs) return cache_job_add(path, file_id);
     desk = efreet_desktop_new(path);
     if (desk) INF("  OK");
     else      INF("  FAIL");
@@ -71,6 +291,150 @@ cache_add(const char *path, const char *file_id, int priority __UNUSED__, int *c
         else      INF("  NO UNCACHED");
     }
     if (!desk) return 1;
+    return cache_store(desk, file_id, changed);
+}
+
+static const char **
+cache_list_array(Eina_List *list, unsigned int *count)
+{
+    const char **array;
+    Eina_List *l;
+    const char *str;
+
+    *count = 0;
+    if (!list) return NULL;
+    array = malloc(eina_list_count(list) * sizeof(char *));
+    if (!array) return NULL;
+    EINA_LIST_FOREACH(list, l, str)
+        array[(*count)++] = str;
+    return array;
+}
+
+static Eina_Bool
+cache_x_field_collect(const Eina_Hash *hash __UNUSED__, const void *key,
+                      void *data __UNUSED__, void *fdata)
+{
+    Eina_List **keys;
+
+    keys = fdata;
+    *keys = eina_list_append(*keys, key);
+    return EINA_TRUE;
+}
+
+static int
+cache_desktop_write(Efreet_Desktop *desk)
+{
+    Efreet_Cache_Desktop hot;
+    Efreet_Cache_Desktop_Cold cold;
+    char key[PATH_MAX];
+    int ret;
+
+    /* The hot record is read for every lookup, so seldom used fields go
+     * into a record of their own */
+    memset(&hot, 0, sizeof(hot));
+    hot.desktop = *desk;
+    if (desk->exec)
+        hot.exec_template = efreet_desktop_exec_compile(desk->exec, desk->orig_path,
+                                                        &hot.exec_flags);
+    hot.collate_key = efreet_collate_key_new(desk->name);
+    ret = !!eet_data_write(ef, edd, desk->orig_path, &hot, 0);
+    free((char *)hot.exec_template);
+    free((char *)hot.collate_key);
+    if (!ret) return 0;
+    if (!desk->categories && !desk->mime_types && !desk->x) return 1;
+
+    cold.categories = cache_list_array(desk->categories, &cold.categories_count);
+    cold.mime_types = cache_list_array(desk->mime_types, &cold.mime_types_count);
+    cold.x = NULL;
+    cold.x_count = 0;
+    if (desk->x)
+    {
+        Eina_List *keys = NULL;
+        const char *k;
+
+        /* Sorted by key, so lookups can bisect the array */
+        eina_hash_foreach(desk->x, cache_x_field_collect, &keys);
+        keys = eina_list_sort(keys, 0, EINA_COMPARE_CB(strcmp));
+        cold.x = malloc(2 * eina_list_count(keys) * sizeof(char *));
+        EINA_LIST_FREE(keys, k)
+        {
+            if (!cold.x) continue;
+            cold.x[cold.x_count++] = k;
+            cold.x[cold.x_count++] = eina_hash_find(desk->x, k);
+        }
+    }
+
+    snprintf(key, sizeof(key), EFREET_CACHE_DESKTOP_COLD "%s", desk->orig_path);
+    ret = !!eet_data_write(ef, efreet_desktop_cold_edd(), key, &cold, 0);
+    free(cold.categories);
+    free(cold.mime_types);
+    free(cold.x);
+    return ret;
+}
+
+static void
+cache_wm_class_add(char tag, const char *str, const char *path)
+{
+    Efreet_Cache_Array_String *array;
+    char key[PATH_MAX];
+
+    key[0] = tag;
+    key[1] = ':';
+    if (!efreet_util_wm_class_normalize(str, key + 2, sizeof(key) - 2)) return;
+
+    array = eina_hash_find(wm_class_index, key);
+    if (!array)
+    {
+        array = NEW(Efreet_Cache_Array_String, 1);
+        if (!array) return;
+        eina_hash_add(wm_class_index, key, array);
+    }
+    array->array = realloc(array->array, sizeof (char *) * (array->array_count + 1));
+    array->array[array->array_count++] = path;
+}
+
+static void
+cache_wm_class_index(Efreet_Desktop *desk, const char *file_id)
+{
+    char buf[PATH_MAX];
+    const char *p, *start, *end;
+
+    if (desk->startup_wm_class)
+        cache_wm_class_add('w', desk->startup_wm_class, desk->orig_path);
+
+    eina_strlcpy(buf, file_id, sizeof(buf));
+    end = strrchr(buf, '.');
+    if (end && !strcmp(end, ".desktop")) buf[end - buf] = '\0';
+    cache_wm_class_add('i', buf, desk->orig_path);
+
+    if (!desk->exec) return;
+    /* The basename of the first word which isn't env or an assignment */
+    p = desk->exec;
+    do
+    {
+        while (isspace((unsigned char)*p)) p++;
+        start = p;
+        if (*p == '"')
+        {
+            start = ++p;
+            while (*p && *p != '"') p++;
+        }
+        else
+            while (*p && !isspace((unsigned char)*p)) p++;
+        end = p;
+        if (*p) p++;
+    }
+    while (*start && (((end - start == 3) && !strncmp(start, "env", 3)) ||
+                      memchr(start, '=', end - start)));
+    if ((end == start) || (end - start >= (int)sizeof(buf))) return;
+    memcpy(buf, start, end - start);
+    buf[end - start] = '\0';
+    cache_wm_class_add('e', ecore_file_file_get(buf), desk->orig_path);
+}
+
+static int
+cache_store(Efreet_Desktop *desk, const char *file_id, int *changed)
+{
     if (file_id && old_file_ids && !eina_hash_find(old_file_ids->hash, file_id))
     {
         *changed = 1;
@@ -78,9 +442,14 @@ cache_add(const char *path, const char *file_id, int priority __UNUSED__, int *c
     }
     if (!eina_hash_find(paths, desk->orig_path))
     {
-        if (!eet_data_write(ef, edd, desk->orig_path, desk, 0))
+        if (!cache_desktop_write(desk))
+        {
+            efreet_desktop_free(desk);
             return 0;
+        }
         eina_hash_add(paths, desk->orig_path, (void *)1);
+        if (!desk->eet && old_paths && eina_hash_find(old_paths, desk->orig_path))
+            eina_hash_add(modified_paths, desk->orig_path, (void *)1);
     }
     /* TODO: We should check priority, and not just hope we search in right order */
     /* TODO: We need to find out if prioritized file id has changed because of
@@ -120,6 +489,7 @@ cache_add(const char *path, const char *file_id, int priority __UNUSED__, int *c
         ADD_ELEM(desk->generic_name, generic_name);
         ADD_ELEM(desk->comment, comment);
         ADD_ELEM(desk->exec, exec);
+        cache_wm_class_index(desk, file_id);
         eina_hash_add(file_ids, file_id, desk->orig_path);
         eina_hash_add(desktops, desk->orig_path, desk);
     }
@@ -132,23 +502,69 @@ cache_add(const char *path, const char *file_id, int priority __UNUSED__, int *c
 static int
 cache_scan(const char *path, const char *base_id, int priority, int recurse, int *changed)
 {
+    Efreet_Cache_Desktop_Dir *dcache = NULL;
     char *file_id = NULL;
     char id[PATH_MAX];
     char buf[PATH_MAX];
+    char fname[PATH_MAX];
+    Eina_Array *entries;
     Eina_Iterator *it;
     Eina_File_Direct_Info *info;
+    struct stat st;
+    const char *entry;
+    unsigned int i;
+    size_t len;
+    int ret = 1;
 
-    if (!ecore_file_is_dir(path)) return 1;
+    if (stat(path, &st) < 0) return 1;
+    if (!S_ISDIR(st.st_mode)) return 1;
 
-    it = eina_file_direct_ls(path);
-    if (!it) return 1;
+    entries = eina_array_new(16);
+    if (!entries) return 0;
+
+    if (old_manifest)
+        dcache = eina_hash_find(old_manifest->hash, path);
+    if (dcache && (dcache->modified_time == (long long) st.st_mtime))
+    {
+        /* Nothing was added or removed, so we know the entries. Changes in
+         * the files themselves are still caught by cache_add */
+        INF("UNCHANGED: %s", path);
+        for (i = 0; i < dcache->entries_count; i++)
+            eina_array_push(entries, eina_stringshare_add(dcache->entries[i]));
+    }
+    else
+    {
+        it = eina_file_direct_ls(path);
+        if (!it)
+        {
+            eina_array_free(entries);
+            return 1;
+        }
+
+        EINA_ITERATOR_FOREACH(it, info)
+        {
+            entry = info->path + info->name_start;
+            if (ecore_file_is_dir(info->path))
+            {
+                snprintf(fname, sizeof(fname), "%s/", entry);
+                eina_array_push(entries, eina_stringshare_add(fname));
+            }
+            else if (cache_is_desktop_file(entry))
+                eina_array_push(entries, eina_stringshare_add(entry));
+        }
+        eina_iterator_free(it);
+    }
 
     id[0] = '\0';
-    EINA_ITERATOR_FOREACH(it, info)
+    for (i = 0; i < entries->count; i++)
     {
-        const char *fname;
-       
-        fname = info->path + info->name_start;
+        entry = entries->data[i];
+        len = eina_stringshare_strlen(entry);
+        if (entry[len - 1] == '/')
+            snprintf(fname, sizeof(fname), "%.*s", (int)(len - 1), entry);
+        else
+            strcpy(fname, entry);
+
         if (base_id)
         {
             if (*base_id)
@@ -159,7 +575,7 @@ cache_scan(const char *path, const char *base_id, int priority, int recurse, int
         }
 
         snprintf(buf, sizeof(buf), "%s/%s", path, fname);
-        if (ecore_file_is_dir(buf))
+        if (entry[len - 1] == '/')
         {
             if (recurse)
                 cache_scan(buf, file_id, priority, recurse, changed);
@@ -168,15 +584,117 @@ cache_scan(const char *path, const char *base_id, int priority, int recurse, int
         {
             if (!cache_add(buf, file_id, priority, changed))
             {
-                eina_iterator_free(it);
-                return 0;
+                ret = 0;
+                break;
             }
         }
     }
-    eina_iterator_free(it);
+
+    dcache = NEW(Efreet_Cache_Desktop_Dir, 1);
+    if (dcache)
+        dcache->entries = NEW(const char *, entries->count);
+    if (!ret || !dcache || !dcache->entries)
+    {
+        if (dcache) free(dcache);
+        for (i = 0; i < entries->count; i++)
+            eina_stringshare_del(entries->data[i]);
+        eina_array_free(entries);
+        return ret;
+    }
+    dcache->modified_time = (long long) st.st_mtime;
+    for (i = 0; i < entries->count; i++)
+        dcache->entries[dcache->entries_count++] = entries->data[i];
+    eina_array_free(entries);
+
+    eina_hash_del_by_key(manifest, path);
+    eina_hash_add(manifest, path, dcache);
     return 1;
 }
 
+static void
+cache_changes_store(void)
+{
+    Efreet_Cache_Desktop_Changes changes;
+    Eina_Array *added, *removed, *modified;
+    Eina_Array *added_ids, *removed_ids, *modified_ids;
+    Eina_Iterator *it;
+    Eina_Hash_Tuple *tuple;
+    const char *key, *old;
+
+    added = eina_array_new(16);
+    removed = eina_array_new(16);
+    modified = eina_array_new(16);
+    added_ids = eina_array_new(16);
+    removed_ids = eina_array_new(16);
+    modified_ids = eina_array_new(16);
+
+    it = eina_hash_iterator_key_new(paths);
+    EINA_ITERATOR_FOREACH(it, key)
+    {
+        if (!old_paths || !eina_hash_find(old_paths, key))
+            eina_array_push(added, key);
+        else if (eina_hash_find(modified_paths, key))
+            eina_array_push(modified, key);
+    }
+    eina_iterator_free(it);
+    if (old_paths)
+    {
+        it = eina_hash_iterator_key_new(old_paths);
+        EINA_ITERATOR_FOREACH(it, key)
+        {
+            if (!eina_hash_find(paths, key))
+                eina_array_push(removed, key);
+        }
+        eina_iterator_free(it);
+    }
+
+    it = eina_hash_iterator_tuple_new(file_ids);
+    EINA_ITERATOR_FOREACH(it, tuple)
+    {
+        old = NULL;
+        if (old_file_ids) old = eina_hash_find(old_file_ids->hash, tuple->key);
+        if (!old)
+            eina_array_push(added_ids, tuple->key);
+        else if (strcmp(old, tuple->data) || eina_hash_find(modified_paths, tuple->data))
+            eina_array_push(modified_ids, tuple->key);
+    }
+    eina_iterator_free(it);
+    if (old_file_ids)
+    {
+        it = eina_hash_iterator_key_new(old_file_ids->hash);
+        EINA_ITERATOR_FOREACH(it, key)
+        {
+            if (!eina_hash_find(file_ids, key))
+                eina_array_push(removed_ids, key);
+        }
+        eina_iterator_free(it);
+    }
+
+#define CHANGES_SET(_name) \
+    changes._name = (const char **)_name->data; \
+    changes._name##_count = _name->count;
+    CHANGES_SET(added);
+    CHANGES_SET(removed);
+    CHANGES_SET(modified);
+    CHANGES_SET(added_ids);
+    CHANGES_SET(removed_ids);
+    CHANGES_SET(modified_ids);
+#undef CHANGES_SET
+
+    changes.base_serial = old_serial;
+
+    INF("changes: %d added, %d removed, %d modified",
+        changes.added_count, changes.removed_count, changes.modified_count);
+    eet_data_write(ef, efreet_desktop_changes_edd(), EFREET_CACHE_DESKTOP_CHANGES, &changes, 1);
+
+    eina_array_free(added);
+    eina_array_free(removed);
+    eina_array_free(modified);
+    eina_array_free(added_ids);
+    eina_array_free(removed_ids);
+    eina_array_free(modified_ids);
+}
+
 static int
 cache_lock_file(void)
 {
@@ -218,11 +736,17 @@ main(int argc, char **argv)
     Eina_List *extra_dirs = NULL;
     Eina_List *store_dirs = NULL;
     int priority = 0;
+    int threads = -1;
+    Eina_Bool cold = EINA_TRUE;
     char *dir = NULL;
     char *path;
+    const char *locale;
+    char buf[32];
+    long long serial;
     int lockfd = -1, tmpfd;
     int changed = 0;
-    int i;
+    int i, num;
+    char **keys;
     char file[PATH_MAX] = { '\0' };
     char util_file[PATH_MAX] = { '\0' };
 
@@ -247,6 +771,7 @@ main(int argc, char **argv)
             printf("Options:\n");
             printf("  -v              Verbose mode\n");
             printf("  -d dir1 dir2    Extra dirs\n");
+            printf("  -j threads      Parse threads for a new cache (default: cpu count)\n");
             exit(0);
         }
         else if (!strcmp(argv[i], "-d"))
@@ -254,6 +779,8 @@ main(int argc, char **argv)
             while ((i < (argc - 1)) && (argv[(i + 1)][0] != '-'))
                 extra_dirs = eina_list_append(extra_dirs, argv[++i]);
         }
+        else if ((!strcmp(argv[i], "-j")) && (i < (argc - 1)))
+            threads = atoi(argv[++i]);
     }
     extra_dirs = eina_list_sort(extra_dirs, -1, EINA_COMPARE_CB(strcmp));
 
@@ -285,7 +812,21 @@ main(int argc, char **argv)
     if (ef)
     {
         user_dirs = eet_data_read(ef, efreet_array_string_edd(), EFREET_CACHE_DESKTOP_DIRS);
+        old_manifest = eet_data_read(ef, efreet_desktop_manifest_edd(), EFREET_CACHE_DESKTOP_MANIFEST);
+        old_serial = efreet_desktop_cache_serial_get(ef);
+        keys = eet_list(ef, "*", &num);
+        if (keys)
+        {
+            old_paths = eina_hash_string_superfast_new(NULL);
+            for (i = 0; i < num; i++)
+            {
+                if (!strncmp(keys[i], "__efreet", 8)) continue;
+                eina_hash_add(old_paths, keys[i], (void *)1);
+            }
+            free(keys);
+        }
         eet_close(ef);
+        cold = EINA_FALSE;
     }
 
     ef = eet_open(efreet_desktop_util_cache_file(), EET_FILE_MODE_READ);
@@ -318,10 +859,24 @@ main(int argc, char **argv)
     version.minor = EFREET_DESKTOP_CACHE_MINOR;
     eet_data_write(ef, efreet_version_edd(), EFREET_CACHE_VERSION, &version, 1);
 
+    /* name keys are made for the collation of the users locale */
+    locale = setlocale(LC_COLLATE, "");
+    if (!locale) locale = "C";
+    eet_write(ef, EFREET_CACHE_DESKTOP_COLLATE, locale, strlen(locale) + 1, 0);
+
+    /* identify this cache, so clients can tell which cache the stored
+     * changes were computed against */
+    serial = (long long)(ecore_time_unix_get() * 1000000.0);
+    if (serial <= old_serial) serial = old_serial + 1;
+    snprintf(buf, sizeof(buf), "%lld", serial);
+    eet_write(ef, EFREET_CACHE_DESKTOP_SERIAL, buf, strlen(buf) + 1, 0);
+
     desktops = eina_hash_string_superfast_new(EINA_FREE_CB(efreet_desktop_free));
 
     file_ids = eina_hash_string_superfast_new(NULL);
     paths = eina_hash_string_superfast_new(NULL);
+    manifest = eina_hash_string_superfast_new(EINA_FREE_CB(cache_dir_free));
+    modified_paths = eina_hash_string_superfast_new(NULL);
 
     mime_types = eina_hash_string_superfast_new(EINA_FREE_CB(efreet_cache_array_string_free));
     categories = eina_hash_string_superfast_new(EINA_FREE_CB(efreet_cache_array_string_free));
@@ -329,12 +884,18 @@ main(int argc, char **argv)
     name = eina_hash_string_superfast_new(EINA_FREE_CB(efreet_cache_array_string_free));
     generic_name = eina_hash_string_superfast_new(EINA_FREE_CB(efreet_cache_array_string_free));
     comment = eina_hash_string_superfast_new(EINA_FREE_CB(efreet_cache_array_string_free));
+    wm_class_index = eina_hash_string_superfast_new(EINA_FREE_CB(efreet_cache_array_string_free));
     exec = eina_hash_string_superfast_new(EINA_FREE_CB(efreet_cache_array_string_free));
 
     dirs = efreet_default_dirs_get(efreet_data_home_get(), efreet_data_dirs_get(),
                                                                     "applications");
     if (!dirs) goto error;
 
+    /* Without an old cache every file has to be parsed, do it in parallel */
+    if (threads < 0) threads = eina_cpu_count();
+    if (cold && (threads > 1))
+        cache_jobs_start(threads);
+
     EINA_LIST_FREE(dirs, path)
     {
         char file_id[PATH_MAX] = { '\0' };
@@ -380,6 +941,12 @@ main(int argc, char **argv)
         store_dirs = eina_list_sort(store_dirs, -1, EINA_COMPARE_CB(strcmp));
     }
 
+    if (jobs)
+    {
+        if (!cache_jobs_store(&changed)) goto error;
+        cache_jobs_stop();
+    }
+
     if (user_dirs)
         efreet_cache_array_string_free(user_dirs);
 
@@ -399,6 +966,19 @@ main(int argc, char **argv)
         free(user_dirs);
     }
 
+    /* store dir manifest */
+    if (eina_hash_population(manifest) > 0)
+    {
+        hash.hash = manifest;
+        eet_data_write(ef, efreet_desktop_manifest_edd(), EFREET_CACHE_DESKTOP_MANIFEST, &hash, 1);
+    }
+    cache_manifest_free();
+
+    /* store what changed since the old cache */
+    cache_changes_store();
+    IF_FREE_HASH(old_paths);
+    IF_FREE_HASH(modified_paths);
+
     /* store util */
 #define STORE_HASH_ARRAY(_hash) \
     if (eina_hash_population((_hash)) > 0) \
@@ -425,6 +1005,7 @@ main(int argc, char **argv)
     STORE_HASH_ARRAY(generic_name);
     STORE_HASH_ARRAY(comment);
     STORE_HASH_ARRAY(exec);
+    STORE_HASH_ARRAY(wm_class_index);
     if (eina_hash_population(file_ids) > 0)
     {
         hash.hash = file_ids;
@@ -438,6 +1019,7 @@ main(int argc, char **argv)
     eina_hash_free(generic_name);
     eina_hash_free(comment);
     eina_hash_free(exec);
+    eina_hash_free(wm_class_index);
 
     if (old_file_ids)
     {
@@ -516,6 +1098,10 @@ main(int argc, char **argv)
     return 0;
 error:
     IF_FREE(dir);
+    cache_jobs_stop();
+    cache_manifest_free();
+    IF_FREE_HASH(old_paths);
+    IF_FREE_HASH(modified_paths);
 edd_error:
     if (user_dirs) efreet_cache_array_string_free(user_dirs);
     if (old_file_ids)
@@ -18,12 +18,17 @@ static int _efreet_icon_cache_log_dom = -1;
 #include "efreet_private.h"
 #include "efreet_cache_private.h"
 
-/* TODO:
- * - Need to handle programs using different exts
- */
+/* Image extensions which are always cached. Lookups filter the cached
+ * paths on the extensions of the calling program, so programs using
+ * different extensions can share the same cache. */
+static const char *default_exts[] = {
+    ".png", ".xpm", ".svg", ".svgz", ".jpg", ".jpeg", ".gif", ".bmp",
+    ".ico", ".tga", ".edj", NULL
+};
 
 static Eina_Array *exts = NULL;
 static Eina_Array *extra_dirs = NULL;
+static Eina_Array *requested = NULL;
 static Eina_Array *strs = NULL;
 static Eina_Hash *icon_themes = NULL;
 
@@ -245,11 +250,6 @@ cache_scan_path_dir(Efreet_Icon_Theme *theme,
             eina_array_push(strs, icon->theme);
             eina_hash_add(icons, name, icon);
         }
-        else if (icon->theme && strcmp(icon->theme, theme->name.internal))
-        {
-            /* We got this icon from a parent theme */
-            continue;
-        }
 
         /* find if we have the same icon in another type */
         for (i = 0; i < icon->icons_count; ++i)
@@ -313,72 +313,48 @@ cache_scan_path(Efreet_Icon_Theme *theme, Eina_Hash *icons, const char *path)
     return EINA_TRUE;
 }
 
+/*
+ * Only the icons of the theme itself are stored in its cache. Inherited
+ * themes have their own cache files, and the lookup follows the inherit
+ * chain at runtime, so a base theme like hicolor is scanned and stored once.
+ */
 static Eina_Bool
-cache_scan(Efreet_Icon_Theme *theme, Eina_Hash *themes, Eina_Hash *icons)
+cache_scan(Efreet_Icon_Theme *theme, Eina_Hash *icons)
 {
     Eina_List *l;
     const char *path;
-    const char *name;
 
     if (!theme) return EINA_TRUE;
-    if (eina_hash_find(themes, theme->name.internal)) return EINA_TRUE;
-    eina_hash_direct_add(themes, theme->name.internal, theme);
 
-    /* scan theme */
     EINA_LIST_FOREACH(theme->paths, l, path)
         if (!cache_scan_path(theme, icons, path)) return EINA_FALSE;
 
-    /* scan inherits */
-    if (theme->inherits)
-    {
-        EINA_LIST_FOREACH(theme->inherits, l, name)
-        {
-            Efreet_Icon_Theme *inherit;
-
-            inherit = eina_hash_find(icon_themes, name);
-            if (!inherit)
-                INF("Theme `%s` not found for `%s`.",
-                    name, theme->name.internal);
-            if (!cache_scan(inherit, themes, icons)) return EINA_FALSE;
-        }
-    }
-    else if (strcmp(theme->name.internal, "hicolor"))
-    {
-        theme = eina_hash_find(icon_themes, "hicolor");
-        if (!cache_scan(theme, themes, icons)) return EINA_FALSE;
-    }
-
     return EINA_TRUE;
 }
 
-static Eina_Bool
-check_changed(Efreet_Cache_Icon_Theme *theme)
+/*
+ * Marks the theme and every theme it inherits from as wanted, as the
+ * lookup of a theme needs the caches of its parents too
+ */
+static void
+cache_theme_want(const char *name, Eina_Hash *wanted)
 {
+    Efreet_Cache_Icon_Theme *theme;
     Eina_List *l;
-    const char *name;
+    const char *parent;
 
-    if (!theme) return EINA_FALSE;
+    if (eina_hash_find(wanted, name)) return;
+    theme = eina_hash_find(icon_themes, name);
+    if (!theme) return;
+    eina_hash_add(wanted, name, theme);
 
-    if (theme->changed) return EINA_TRUE;
     if (theme->theme.inherits)
     {
-        EINA_LIST_FOREACH(theme->theme.inherits, l, name)
-        {
-            Efreet_Cache_Icon_Theme *inherit;
-
-            inherit = eina_hash_find(icon_themes, name);
-            if (!inherit)
-                INF("Theme `%s` not found for `%s`.",
-                        name, theme->theme.name.internal);
-            if (check_changed(inherit)) return EINA_TRUE;
-        }
-    }
-    else if (strcmp(theme->theme.name.internal, "hicolor"))
-    {
-        theme = eina_hash_find(icon_themes, "hicolor");
-        if (check_changed(theme)) return EINA_TRUE;
+        EINA_LIST_FOREACH(theme->theme.inherits, l, parent)
+            cache_theme_want(parent, wanted);
     }
-    return EINA_FALSE;
+    else if (strcmp(name, "hicolor"))
+        cache_theme_want("hicolor", wanted);
 }
 
 static Efreet_Icon_Theme_Directory *
@@ -641,6 +617,49 @@ cache_theme_scan(const char *dir)
     return EINA_TRUE;
 }
 
+static void
+cache_theme_summary_save(Eet_File *ef)
+{
+    Efreet_Cache_Icon_Theme_Summary summary;
+    Efreet_Icon_Theme_Summary *themes;
+    Efreet_Cache_Icon_Theme *theme;
+    Eina_Iterator *it;
+    unsigned int i, count;
+
+    count = eina_hash_population(icon_themes);
+    if (!count) return;
+
+    themes = NEW(Efreet_Icon_Theme_Summary, count);
+    if (!themes) return;
+    summary.themes = NEW(Efreet_Icon_Theme_Summary *, count);
+    if (!summary.themes)
+    {
+        free(themes);
+        return;
+    }
+    summary.themes_count = 0;
+
+    it = eina_hash_iterator_data_new(icon_themes);
+    EINA_ITERATOR_FOREACH(it, theme)
+    {
+        if (!theme->valid) continue;
+#ifndef STRICT_SPEC
+        if (!theme->theme.name.name) continue;
+#endif
+        i = summary.themes_count++;
+        themes[i].name.internal = theme->theme.name.internal;
+        themes[i].name.name = theme->theme.name.name;
+        themes[i].comment = theme->theme.comment;
+        themes[i].example_icon = theme->theme.example_icon;
+        summary.themes[i] = &(themes[i]);
+    }
+    eina_iterator_free(it);
+
+    eet_data_write(ef, efreet_icon_theme_summary_edd(), EFREET_CACHE_ICON_THEME_SUMMARY, &summary, 1);
+    free(summary.themes);
+    free(themes);
+}
+
 static int
 cache_lock_file(void)
 {
@@ -769,11 +788,13 @@ main(int argc, char **argv)
     Eet_File *theme_ef;
     Eina_List *xdg_dirs = NULL;
     Eina_List *l = NULL;
+    Eina_Hash *wanted = NULL;
     char file[PATH_MAX];
     const char *path;
     char *dir = NULL;
     Eina_Bool changed = EINA_FALSE;
     Eina_Bool flush = EINA_FALSE;
+    Eina_Bool flush_fallback = EINA_FALSE;
     int lockfd = -1;
     int tmpfd = -1;
     char **keys;
@@ -793,6 +814,7 @@ main(int argc, char **argv)
 
     exts = eina_array_new(10);
     extra_dirs = eina_array_new(10);
+    requested = eina_array_new(10);
 
     for (i = 1; i < argc; i++)
     {
@@ -807,6 +829,7 @@ main(int argc, char **argv)
             printf("  -v              Verbose mode\n");
             printf("  -e .ext1 .ext2  Extensions\n");
             printf("  -d dir1 dir2    Extra dirs\n");
+            printf("  -t thm1 thm2    Themes to build icon caches for\n");
             exit(0);
         }
         else if (!strcmp(argv[i], "-e"))
@@ -819,6 +842,17 @@ main(int argc, char **argv)
             while ((i < (argc - 1)) && (argv[(i + 1)][0] != '-'))
                 eina_array_push(extra_dirs, argv[++i]);
         }
+        else if (!strcmp(argv[i], "-t"))
+        {
+            while ((i < (argc - 1)) && (argv[(i + 1)][0] != '-'))
+                eina_array_push(requested, argv[++i]);
+        }
+    }
+
+    for (i = 0; default_exts[i]; i++)
+    {
+        if (!cache_extension_lookup(default_exts[i]))
+            eina_array_push(exts, default_exts[i]);
     }
 
     if (!eet_init()) return -1;
@@ -873,18 +907,16 @@ main(int argc, char **argv)
     theme_version->major = EFREET_ICON_CACHE_MAJOR;
     theme_version->minor = EFREET_ICON_CACHE_MINOR;
 
+    /* Only a new extension needs a rescan of all themes, extra dirs are
+     * only part of the fallback cache */
     if (add_data(theme_ef, exts, EFREET_CACHE_ICON_EXTENSIONS))
         flush = EINA_TRUE;
     if (add_data(theme_ef, extra_dirs, EFREET_CACHE_ICON_EXTRA_DIRS))
-        flush = EINA_TRUE;
-    if (flush)
+        flush_fallback = EINA_TRUE;
+    if (flush || flush_fallback)
         changed = EINA_TRUE;
-
-    if (exts->count == 0)
-    {
-        ERR("Need to pass extensions to icon cache create process");
-        goto on_error_efreet;
-    }
+    /* themes requested by earlier runs are still wanted */
+    add_data(theme_ef, requested, EFREET_CACHE_ICON_REQUESTED);
 
     keys = eet_list(theme_ef, "*", &num);
     if (keys)
@@ -920,6 +952,10 @@ main(int argc, char **argv)
 
     cache_theme_scan("/usr/share/pixmaps");
 
+    wanted = eina_hash_string_superfast_new(NULL);
+    for (i = 0; i < (int)requested->count; i++)
+        cache_theme_want(requested->data[i], wanted);
+
     /* scan icons */
     it = eina_hash_iterator_data_new(icon_themes);
     EINA_ITERATOR_FOREACH(it, theme)
@@ -928,20 +964,36 @@ main(int argc, char **argv)
 #ifndef STRICT_SPEC
         if (!theme->theme.name.name) continue;
 #endif
-        INF("scan theme %s", theme->theme.name.name);
-
-        theme->changed = check_changed(theme);
         if (flush)
             theme->changed = EINA_TRUE;
 
+        if (!eina_hash_find(wanted, theme->theme.name.internal))
+        {
+            /* Nobody uses this theme, so only store the theme data and
+             * drop any stale icon cache. The library scans the theme
+             * directories directly until it asks for the theme. */
+            if (theme->changed)
+            {
+                INF("skip theme %s", theme->theme.name.name);
+                if (unlink(efreet_icon_cache_file(theme->theme.name.internal)) < 0)
+                {
+                    if (errno != ENOENT) goto on_error_efreet;
+                }
+                eet_data_write(theme_ef, theme_edd, theme->theme.name.internal, theme, 1);
+                changed = EINA_TRUE;
+            }
+            continue;
+        }
+        INF("scan theme %s", theme->theme.name.name);
+
         INF("open icon file");
         /* open icon file */
         icon_ef = eet_open(efreet_icon_cache_file(theme->theme.name.internal), EET_FILE_MODE_READ_WRITE);
         if (!icon_ef) goto on_error_efreet;
         icon_version = eet_data_read(icon_ef, efreet_version_edd(), EFREET_CACHE_VERSION);
-        if (theme->changed || (icon_version &&
+        if (theme->changed || !icon_version ||
             ((icon_version->major != EFREET_ICON_CACHE_MAJOR) ||
-             (icon_version->minor != EFREET_ICON_CACHE_MINOR))))
+             (icon_version->minor != EFREET_ICON_CACHE_MINOR)))
         {
             // delete old cache
             eet_close(icon_ef);
@@ -959,7 +1011,6 @@ main(int argc, char **argv)
 
         if (theme->changed)
         {
-            Eina_Hash *themes;
             Eina_Hash *icons;
 
             if (!icon_version)
@@ -968,11 +1019,10 @@ main(int argc, char **argv)
             icon_version->major = EFREET_ICON_CACHE_MAJOR;
             icon_version->minor = EFREET_ICON_CACHE_MINOR;
 
-            themes = eina_hash_string_superfast_new(NULL);
             icons = eina_hash_string_superfast_new(NULL);
 
             INF("scan icons\n");
-            if (cache_scan(&(theme->theme), themes, icons))
+            if (cache_scan(&(theme->theme), icons))
             {
                 Eina_Iterator *icons_it;
                 Eina_Hash_Tuple *tuple;
@@ -990,7 +1040,6 @@ main(int argc, char **argv)
                 INF("theme change: %s %lld", theme->theme.name.internal, theme->last_cache_check);
                 eet_data_write(theme_ef, theme_edd, theme->theme.name.internal, theme, 1);
             }
-            eina_hash_free(themes);
             eina_hash_free(icons);
         }
 
@@ -1000,6 +1049,11 @@ main(int argc, char **argv)
         free(icon_version);
     }
     eina_iterator_free(it);
+    eina_hash_free(wanted);
+    wanted = NULL;
+
+    if (changed)
+        cache_theme_summary_save(theme_ef);
 
     INF("scan fallback icons");
     theme = eet_data_read(theme_ef, theme_edd, EFREET_CACHE_ICON_FALLBACK);
@@ -1008,7 +1062,7 @@ main(int argc, char **argv)
         theme = NEW(Efreet_Cache_Icon_Theme, 1);
         theme->changed = EINA_TRUE;
     }
-    if (flush)
+    if (flush || flush_fallback)
         theme->changed = EINA_TRUE;
 
     INF("open fallback file");
@@ -1087,6 +1141,7 @@ main(int argc, char **argv)
     eet_data_write(theme_ef, efreet_version_edd(), EFREET_CACHE_VERSION, theme_version, 1);
     save_data(theme_ef, exts, EFREET_CACHE_ICON_EXTENSIONS);
     save_data(theme_ef, extra_dirs, EFREET_CACHE_ICON_EXTRA_DIRS);
+    save_data(theme_ef, requested, EFREET_CACHE_ICON_REQUESTED);
 
     eet_close(theme_ef);
     efreet_setowner(efreet_icon_theme_cache_file());
@@ -1107,6 +1162,7 @@ main(int argc, char **argv)
 
     INF("done");
 on_error_efreet:
+    if (wanted) eina_hash_free(wanted);
     efreet_shutdown();
 
 on_error:
@@ -1117,6 +1173,7 @@ on_error:
     eina_array_free(strs);
     eina_array_free(exts);
     eina_array_free(extra_dirs);
+    eina_array_free(requested);
 
     ecore_shutdown();
     eet_shutdown();
@@ -155,8 +155,9 @@ efreet_shutdown(void)
     if (--_efreet_init_count != 0)
         return _efreet_init_count;
 
-    efreet_util_shutdown();
+    /* menu builds in a thread use the util cache, they are waited for */
     efreet_menu_shutdown();
+    efreet_util_shutdown();
     efreet_desktop_shutdown();
     efreet_ini_shutdown();
     efreet_icon_shutdown();
@@ -70,6 +70,29 @@ EAPI const char *efreet_hostname_get(void);
  */
 typedef struct _Efreet_Event_Cache_Update Efreet_Event_Cache_Update;
 
+/**
+ * Efreet_Cache_Changes
+ * @since 1.7
+ */
+typedef struct _Efreet_Cache_Changes Efreet_Cache_Changes;
+
+/**
+ * Efreet_Cache_Changes
+ * @brief the desktop files which changed with a desktop cache update. All
+ * lists hold stringshared strings.
+ * @since 1.7
+ */
+struct _Efreet_Cache_Changes
+{
+    Eina_List *added;         /**< orig_path of the new desktop files */
+    Eina_List *removed;       /**< orig_path of the removed desktop files */
+    Eina_List *modified;      /**< orig_path of the changed desktop files */
+
+    Eina_List *added_ids;     /**< New file ids */
+    Eina_List *removed_ids;   /**< Removed file ids */
+    Eina_List *modified_ids;  /**< File ids which point to another or a changed desktop file */
+};
+
 /**
  * Efreet_Event_Cache_Update
  * @brief event struct sent with EFREET_EVENT_*_CACHE_UPDATE
@@ -77,6 +100,13 @@ typedef struct _Efreet_Event_Cache_Update Efreet_Event_Cache_Update;
 struct _Efreet_Event_Cache_Update
 {
     int dummy;
+    /**
+     * What changed with a EFREET_EVENT_DESKTOP_CACHE_UPDATE, NULL if not
+     * known. Desktops which aren't in one of the removed or modified lists
+     * stay valid and don't need to be fetched again.
+     * @since 1.7
+     */
+    Efreet_Cache_Changes *changes;
 };
 
 /**
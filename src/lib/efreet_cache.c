@@ -7,10 +7,10 @@
  *       browsing.
  */
 
-#include <libgen.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <locale.h>
 
 #include <Eet.h>
 #include <Ecore.h>
@@ -34,6 +34,19 @@ struct _Efreet_Old_Cache
     Eet_File *ef;
 };
 
+typedef struct _Efreet_Icon_Theme_Cache Efreet_Icon_Theme_Cache;
+
+/*
+ * The icon cache of one theme. It only holds the icons of the theme
+ * itself, inherited icons are looked up in the parent theme caches.
+ */
+struct _Efreet_Icon_Theme_Cache
+{
+    Eina_Hash *icons;
+    Eet_File *ef;
+    Eina_Bool requested;
+};
+
 /**
  * Data for cache files
  */
@@ -45,32 +58,48 @@ static Eet_Data_Descriptor *icon_fallback_edd = NULL;
 static Eet_Data_Descriptor *icon_element_pointer_edd = NULL;
 static Eet_Data_Descriptor *icon_element_edd = NULL;
 static Eet_Data_Descriptor *icon_edd = NULL;
+static Eet_Data_Descriptor *icon_theme_summary_edd = NULL;
+static Eet_Data_Descriptor *icon_theme_summary_pointer_edd = NULL;
+static Eet_Data_Descriptor *icon_theme_summaries_edd = NULL;
 
-static Eet_File            *icon_cache = NULL;
 static Eet_File            *fallback_cache = NULL;
 static Eet_File            *icon_theme_cache = NULL;
 
 static Eina_Hash           *themes = NULL;
-static Eina_Hash           *icons = NULL;
+static Eina_Hash           *theme_summaries = NULL;
+static Eina_Hash           *icon_caches = NULL;
 static Eina_Hash           *fallbacks = NULL;
 
 static const char          *icon_theme_cache_file = NULL;
-
-static const char          *theme_name = NULL;
+static Eina_List           *icon_themes_requested = NULL;
+static Efreet_Cache_Array_String *icon_extra_dirs = NULL;
 
 static Eet_Data_Descriptor *version_edd = NULL;
 static Eet_Data_Descriptor *desktop_edd = NULL;
+static Eet_Data_Descriptor *desktop_cold_edd = NULL;
 static Eet_Data_Descriptor *hash_array_string_edd = NULL;
 static Eet_Data_Descriptor *array_string_edd = NULL;
 static Eet_Data_Descriptor *hash_string_edd = NULL;
+static Eet_Data_Descriptor *desktop_dir_edd = NULL;
+static Eet_Data_Descriptor *desktop_manifest_edd = NULL;
+static Eet_Data_Descriptor *desktop_changes_edd = NULL;
+static Eet_Data_Descriptor *menu_cache_edd = NULL;
+static Eet_Data_Descriptor *menu_edd = NULL;
+static Eet_Data_Descriptor *menu_desktop_edd = NULL;
 
 static Eina_Hash           *desktops = NULL;
 static Eina_List           *desktop_dirs_add = NULL;
 static Eet_File            *desktop_cache = NULL;
 static const char          *desktop_cache_file = NULL;
+static Eina_Bool            desktop_lazy = EINA_FALSE;
+static Eina_Bool            desktop_compact = EINA_FALSE;
 
 static Ecore_File_Monitor  *cache_monitor = NULL;
 
+static Eina_Bool            watch_budget = EINA_FALSE;
+static int                  watch_lock = -1;
+static Eina_Bool            watch_owner = EINA_FALSE;
+
 static Ecore_Event_Handler *cache_exe_handler = NULL;
 static Ecore_Timer         *icon_cache_timer = NULL;
 static Ecore_Exe           *icon_cache_exe = NULL;
@@ -90,11 +119,20 @@ static const char                *util_cache_names_key = NULL;
 
 static void efreet_cache_edd_shutdown(void);
 static void efreet_cache_icon_free(Efreet_Cache_Icon *icon);
+static void efreet_cache_icon_theme_cache_free(Efreet_Icon_Theme_Cache *cache);
+static Eina_Bool efreet_cache_icon_extension_match(Efreet_Cache_Icon *cache);
+static Efreet_Cache_Icon *efreet_cache_icon_theme_icon_find(Efreet_Icon_Theme *theme,
+                                                            const char *icon,
+                                                            Eina_List **visited);
+static Efreet_Cache_Icon *efreet_cache_icon_theme_scan(Efreet_Icon_Theme *theme,
+                                                       const char *icon);
+static void efreet_cache_icon_theme_request(const char *theme);
 static void efreet_cache_icon_fallback_free(Efreet_Cache_Fallback_Icon *icon);
 static void efreet_cache_icon_theme_free(Efreet_Icon_Theme *theme);
 
 static Eina_Bool efreet_cache_check(Eet_File **ef, const char *path, int major);
 static void *efreet_cache_close(Eet_File *ef);
+static Eina_Bool efreet_cache_watch_lock_take(void);
 
 static Eina_Bool cache_exe_cb(void *data, int type, void *event);
 static Eina_Bool cache_check_change(const char *path);
@@ -103,9 +141,20 @@ static void cache_update_cb(void *data, Ecore_File_Monitor *em,
 
 static Eina_Bool desktop_cache_update_cache_cb(void *data);
 static Eina_Bool icon_cache_update_cache_cb(void *data);
+static void efreet_cache_icon_requests_clear(void);
 static void desktop_cache_update_free(void *data, void *ev);
+static void efreet_cache_desktop_cold_free(Efreet_Cache_Desktop_Cold *cold);
+static Efreet_Cache_Changes *desktop_cache_changes_get(Eet_File *old);
+static void desktop_cache_changes_free(Efreet_Cache_Changes *changes);
 static void icon_cache_update_free(void *data, void *ev);
 
+static Eet_Data_Descriptor *efreet_menu_cache_edd(void);
+static void efreet_menu_cache_file(char *buf, size_t size, const char *path);
+static void efreet_menu_cache_lang(char *buf, size_t size);
+static const char *efreet_menu_cache_dirs(const char *home, Eina_List *dirs);
+static Eina_Bool efreet_menu_cache_str_eq(const char *a, const char *b);
+static Eina_Bool efreet_menu_cache_desktops_load(Efreet_Menu *entry, Eina_Bool load);
+
 static void *hash_array_string_add(void *hash, const char *key, void *data);
 
 EAPI int EFREET_EVENT_ICON_CACHE_UPDATE = 0;
@@ -126,10 +175,13 @@ efreet_cache_init(void)
     EFREET_EVENT_DESKTOP_CACHE_BUILD = ecore_event_type_new();
 
     themes = eina_hash_string_superfast_new(EINA_FREE_CB(efreet_cache_icon_theme_free));
-    icons = eina_hash_string_superfast_new(EINA_FREE_CB(efreet_cache_icon_free));
+    icon_caches = eina_hash_string_superfast_new(EINA_FREE_CB(efreet_cache_icon_theme_cache_free));
     fallbacks = eina_hash_string_superfast_new(EINA_FREE_CB(efreet_cache_icon_fallback_free));
     desktops = eina_hash_string_superfast_new(NULL);
 
+    if (getenv("EFREET_WATCH_BUDGET"))
+        watch_budget = EINA_TRUE;
+
     if (efreet_cache_update)
     {
         snprintf(buf, sizeof(buf), "%s/efreet", efreet_cache_home_get());
@@ -160,6 +212,9 @@ efreet_cache_init(void)
             goto error;
         }
 
+        if (watch_budget)
+            watch_owner = efreet_cache_watch_lock_take();
+
         efreet_cache_icon_update();
         efreet_cache_desktop_update();
     }
@@ -168,8 +223,8 @@ efreet_cache_init(void)
 error:
     if (themes) eina_hash_free(themes);
     themes = NULL;
-    if (icons) eina_hash_free(icons);
-    icons = NULL;
+    if (icon_caches) eina_hash_free(icon_caches);
+    icon_caches = NULL;
     if (fallbacks) eina_hash_free(fallbacks);
     fallbacks = NULL;
     if (desktops) eina_hash_free(desktops);
@@ -189,18 +244,21 @@ efreet_cache_shutdown(void)
     Efreet_Old_Cache *d;
     void *data;
 
-    IF_RELEASE(theme_name);
-
-    icon_cache = efreet_cache_close(icon_cache);
     icon_theme_cache = efreet_cache_close(icon_theme_cache);
+    if (icon_extra_dirs != NON_EXISTING)
+        efreet_cache_array_string_free(icon_extra_dirs);
+    icon_extra_dirs = NULL;
 
     IF_FREE_HASH(themes);
-    IF_FREE_HASH(icons);
+    IF_FREE_HASH(theme_summaries);
+    IF_FREE_HASH(icon_caches);
     IF_FREE_HASH(fallbacks);
 
     IF_FREE_HASH_CB(desktops, EINA_FREE_CB(efreet_cache_desktop_free));
     EINA_LIST_FREE(desktop_dirs_add, data)
         eina_stringshare_del(data);
+    EINA_LIST_FREE(icon_themes_requested, data)
+        eina_stringshare_del(data);
     desktop_cache = efreet_cache_close(desktop_cache);
     IF_RELEASE(desktop_cache_file);
 
@@ -209,6 +267,14 @@ efreet_cache_shutdown(void)
     if (cache_monitor) ecore_file_monitor_del(cache_monitor);
     cache_monitor = NULL;
 
+    if (watch_lock >= 0)
+    {
+        close(watch_lock);
+        watch_lock = -1;
+    }
+    watch_owner = EINA_FALSE;
+    watch_budget = EINA_FALSE;
+
     efreet_cache_edd_shutdown();
     if (desktop_cache_timer)
     {
@@ -383,6 +449,82 @@ efreet_hash_string_edd(void)
     return hash_string_edd;
 }
 
+/*
+ * Needs EAPI because of helper binaries
+ */
+EAPI Eet_Data_Descriptor *
+efreet_desktop_manifest_edd(void)
+{
+    Eet_Data_Descriptor_Class eddc;
+
+    if (desktop_manifest_edd) return desktop_manifest_edd;
+
+    EET_EINA_FILE_DATA_DESCRIPTOR_CLASS_SET(&eddc, Efreet_Cache_Desktop_Dir);
+    desktop_dir_edd = eet_data_descriptor_file_new(&eddc);
+    if (!desktop_dir_edd) return NULL;
+
+    EET_DATA_DESCRIPTOR_ADD_BASIC(desktop_dir_edd, Efreet_Cache_Desktop_Dir,
+                                  "modified_time", modified_time, EET_T_LONG_LONG);
+    EET_DATA_DESCRIPTOR_ADD_VAR_ARRAY_STRING(desktop_dir_edd, Efreet_Cache_Desktop_Dir,
+                                             "entries", entries);
+
+    EET_EINA_FILE_DATA_DESCRIPTOR_CLASS_SET(&eddc, Efreet_Cache_Hash);
+    desktop_manifest_edd = eet_data_descriptor_file_new(&eddc);
+    if (!desktop_manifest_edd) return NULL;
+
+    EET_DATA_DESCRIPTOR_ADD_HASH(desktop_manifest_edd, Efreet_Cache_Hash,
+                                  "hash", hash, desktop_dir_edd);
+
+    return desktop_manifest_edd;
+}
+
+/*
+ * Needs EAPI because of helper binaries
+ */
+EAPI Eet_Data_Descriptor *
+efreet_desktop_changes_edd(void)
+{
+    Eet_Data_Descriptor_Class eddc;
+
+    if (desktop_changes_edd) return desktop_changes_edd;
+
+    EET_EINA_FILE_DATA_DESCRIPTOR_CLASS_SET(&eddc, Efreet_Cache_Desktop_Changes);
+    desktop_changes_edd = eet_data_descriptor_file_new(&eddc);
+    if (!desktop_changes_edd) return NULL;
+
+    EET_DATA_DESCRIPTOR_ADD_BASIC(desktop_changes_edd, Efreet_Cache_Desktop_Changes,
+                                  "base_serial", base_serial, EET_T_LONG_LONG);
+    EET_DATA_DESCRIPTOR_ADD_VAR_ARRAY_STRING(desktop_changes_edd, Efreet_Cache_Desktop_Changes,
+                                             "added", added);
+    EET_DATA_DESCRIPTOR_ADD_VAR_ARRAY_STRING(desktop_changes_edd, Efreet_Cache_Desktop_Changes,
+                                             "removed", removed);
+    EET_DATA_DESCRIPTOR_ADD_VAR_ARRAY_STRING(desktop_changes_edd, Efreet_Cache_Desktop_Changes,
+                                             "modified", modified);
+    EET_DATA_DESCRIPTOR_ADD_VAR_ARRAY_STRING(desktop_changes_edd, Efreet_Cache_Desktop_Changes,
+                                             "added_ids", added_ids);
+    EET_DATA_DESCRIPTOR_ADD_VAR_ARRAY_STRING(desktop_changes_edd, Efreet_Cache_Desktop_Changes,
+                                             "removed_ids", removed_ids);
+    EET_DATA_DESCRIPTOR_ADD_VAR_ARRAY_STRING(desktop_changes_edd, Efreet_Cache_Desktop_Changes,
+                                             "modified_ids", modified_ids);
+
+    return desktop_changes_edd;
+}
+
+/*
+ * Needs EAPI because of helper binaries
+ */
+EAPI long long
+efreet_desktop_cache_serial_get(Eet_File *ef)
+{
+    const char *serial;
+    int size = 0;
+
+    if (!ef) return 0;
+    serial = eet_read_direct(ef, EFREET_CACHE_DESKTOP_SERIAL, &size);
+    if (!serial || (size < 1) || (serial[size - 1] != '\0')) return 0;
+    return strtoll(serial, NULL, 10);
+}
+
 /*
  * Needs EAPI because of helper binaries
  */
@@ -440,9 +582,16 @@ efreet_cache_edd_shutdown(void)
 {
     EDD_SHUTDOWN(version_edd);
     EDD_SHUTDOWN(desktop_edd);
+    EDD_SHUTDOWN(desktop_cold_edd);
     EDD_SHUTDOWN(hash_array_string_edd);
     EDD_SHUTDOWN(array_string_edd);
     EDD_SHUTDOWN(hash_string_edd);
+    EDD_SHUTDOWN(desktop_dir_edd);
+    EDD_SHUTDOWN(desktop_manifest_edd);
+    EDD_SHUTDOWN(desktop_changes_edd);
+    EDD_SHUTDOWN(menu_cache_edd);
+    EDD_SHUTDOWN(menu_edd);
+    EDD_SHUTDOWN(menu_desktop_edd);
     EDD_SHUTDOWN(icon_theme_edd);
     EDD_SHUTDOWN(icon_theme_directory_edd);
     EDD_SHUTDOWN(directory_edd);
@@ -450,6 +599,9 @@ efreet_cache_edd_shutdown(void)
     EDD_SHUTDOWN(icon_element_pointer_edd);
     EDD_SHUTDOWN(icon_element_edd);
     EDD_SHUTDOWN(icon_edd);
+    EDD_SHUTDOWN(icon_theme_summary_edd);
+    EDD_SHUTDOWN(icon_theme_summary_pointer_edd);
+    EDD_SHUTDOWN(icon_theme_summaries_edd);
 }
 
 #define EFREET_POINTER_TYPE(Edd_Dest, Edd_Source, Type)   \
@@ -588,6 +740,41 @@ efreet_icon_theme_edd(Eina_Bool cache)
     return icon_theme_edd;
 }
 
+/*
+ * Needs EAPI because of helper binaries
+ */
+EAPI Eet_Data_Descriptor *
+efreet_icon_theme_summary_edd(void)
+{
+    Eet_Data_Descriptor_Class eddc;
+
+    if (icon_theme_summaries_edd) return icon_theme_summaries_edd;
+
+    EET_EINA_FILE_DATA_DESCRIPTOR_CLASS_SET(&eddc, Efreet_Icon_Theme_Summary);
+    icon_theme_summary_edd = eet_data_descriptor_file_new(&eddc);
+    if (!icon_theme_summary_edd) return NULL;
+
+    EET_DATA_DESCRIPTOR_ADD_BASIC(icon_theme_summary_edd, Efreet_Icon_Theme_Summary,
+                                  "name.internal", name.internal, EET_T_STRING);
+    EET_DATA_DESCRIPTOR_ADD_BASIC(icon_theme_summary_edd, Efreet_Icon_Theme_Summary,
+                                  "name.name", name.name, EET_T_STRING);
+    EET_DATA_DESCRIPTOR_ADD_BASIC(icon_theme_summary_edd, Efreet_Icon_Theme_Summary,
+                                  "comment", comment, EET_T_STRING);
+    EET_DATA_DESCRIPTOR_ADD_BASIC(icon_theme_summary_edd, Efreet_Icon_Theme_Summary,
+                                  "example_icon", example_icon, EET_T_STRING);
+
+    EFREET_POINTER_TYPE(icon_theme_summary_pointer_edd, icon_theme_summary_edd, Icon_Theme_Summary);
+
+    EET_EINA_FILE_DATA_DESCRIPTOR_CLASS_SET(&eddc, Efreet_Cache_Icon_Theme_Summary);
+    icon_theme_summaries_edd = eet_data_descriptor_file_new(&eddc);
+    if (!icon_theme_summaries_edd) return NULL;
+
+    EET_DATA_DESCRIPTOR_ADD_VAR_ARRAY(icon_theme_summaries_edd, Efreet_Cache_Icon_Theme_Summary,
+                                      "themes", themes, icon_theme_summary_pointer_edd);
+
+    return icon_theme_summaries_edd;
+}
+
 /*
  * Needs EAPI because of helper binaries
  */
@@ -637,48 +824,300 @@ efreet_desktop_edd(void)
     EET_DATA_DESCRIPTOR_ADD_BASIC(desktop_edd, Efreet_Cache_Desktop, "url", desktop.url, EET_T_STRING);
     eet_data_descriptor_element_add(desktop_edd, "only_show_in", EET_T_STRING, EET_G_LIST, offsetof(Efreet_Cache_Desktop, desktop.only_show_in), 0, NULL, NULL);
     eet_data_descriptor_element_add(desktop_edd, "not_show_in", EET_T_STRING, EET_G_LIST, offsetof(Efreet_Cache_Desktop, desktop.not_show_in), 0, NULL, NULL);
-    eet_data_descriptor_element_add(desktop_edd, "categories", EET_T_STRING, EET_G_LIST, offsetof(Efreet_Cache_Desktop, desktop.categories), 0, NULL, NULL);
-    eet_data_descriptor_element_add(desktop_edd, "mime_types", EET_T_STRING, EET_G_LIST, offsetof(Efreet_Cache_Desktop, desktop.mime_types), 0, NULL, NULL);
-    eet_data_descriptor_element_add(desktop_edd, "x", EET_T_STRING, EET_G_HASH, offsetof(Efreet_Cache_Desktop, desktop.x), 0, NULL, NULL);
     EET_DATA_DESCRIPTOR_ADD_BASIC(desktop_edd, Efreet_Cache_Desktop, "no_display", desktop.no_display, EET_T_UCHAR);
     EET_DATA_DESCRIPTOR_ADD_BASIC(desktop_edd, Efreet_Cache_Desktop, "hidden", desktop.hidden, EET_T_UCHAR);
     EET_DATA_DESCRIPTOR_ADD_BASIC(desktop_edd, Efreet_Cache_Desktop, "terminal", desktop.terminal, EET_T_UCHAR);
     EET_DATA_DESCRIPTOR_ADD_BASIC(desktop_edd, Efreet_Cache_Desktop, "startup_notify", desktop.startup_notify, EET_T_UCHAR);
+    EET_DATA_DESCRIPTOR_ADD_BASIC(desktop_edd, Efreet_Cache_Desktop, "exec_template", exec_template, EET_T_STRING);
+    EET_DATA_DESCRIPTOR_ADD_BASIC(desktop_edd, Efreet_Cache_Desktop, "exec_flags", exec_flags, EET_T_INT);
+    EET_DATA_DESCRIPTOR_ADD_BASIC(desktop_edd, Efreet_Cache_Desktop, "collate_key", collate_key, EET_T_STRING);
 
     return desktop_edd;
 }
 
+/*
+ * Needs EAPI because of helper binaries
+ */
+EAPI Eet_Data_Descriptor *
+efreet_desktop_cold_edd(void)
+{
+    Eet_Data_Descriptor_Class eddc;
+
+    if (desktop_cold_edd) return desktop_cold_edd;
+
+    EET_EINA_FILE_DATA_DESCRIPTOR_CLASS_SET(&eddc, Efreet_Cache_Desktop_Cold);
+    desktop_cold_edd = eet_data_descriptor_file_new(&eddc);
+    if (!desktop_cold_edd) return NULL;
+
+    EET_DATA_DESCRIPTOR_ADD_VAR_ARRAY_STRING(desktop_cold_edd, Efreet_Cache_Desktop_Cold,
+                                             "categories", categories);
+    EET_DATA_DESCRIPTOR_ADD_VAR_ARRAY_STRING(desktop_cold_edd, Efreet_Cache_Desktop_Cold,
+                                             "mime_types", mime_types);
+    EET_DATA_DESCRIPTOR_ADD_VAR_ARRAY_STRING(desktop_cold_edd, Efreet_Cache_Desktop_Cold,
+                                             "x", x);
+
+    return desktop_cold_edd;
+}
+
+/*
+ * The menu tree is stored with stringshared strings, so it can be handed
+ * out and freed with efreet_menu_free()
+ */
+static Eet_Data_Descriptor *
+efreet_menu_cache_edd(void)
+{
+    Eet_Data_Descriptor_Class eddc;
+
+    if (menu_cache_edd) return menu_cache_edd;
+
+    /* only the path of a desktop is stored, it is loaded again on read */
+    EET_EINA_STREAM_DATA_DESCRIPTOR_CLASS_SET(&eddc, Efreet_Desktop);
+    menu_desktop_edd = eet_data_descriptor_stream_new(&eddc);
+    if (!menu_desktop_edd) return NULL;
+
+    EET_DATA_DESCRIPTOR_ADD_BASIC(menu_desktop_edd, Efreet_Desktop, "orig_path", orig_path, EET_T_STRING);
+
+    EET_EINA_STREAM_DATA_DESCRIPTOR_CLASS_SET(&eddc, Efreet_Menu);
+    menu_edd = eet_data_descriptor_stream_new(&eddc);
+    if (!menu_edd) return NULL;
+
+    EET_DATA_DESCRIPTOR_ADD_BASIC(menu_edd, Efreet_Menu, "type", type, EET_T_INT);
+    EET_DATA_DESCRIPTOR_ADD_BASIC(menu_edd, Efreet_Menu, "id", id, EET_T_STRING);
+    EET_DATA_DESCRIPTOR_ADD_BASIC(menu_edd, Efreet_Menu, "name", name, EET_T_STRING);
+    EET_DATA_DESCRIPTOR_ADD_BASIC(menu_edd, Efreet_Menu, "icon", icon, EET_T_STRING);
+    EET_DATA_DESCRIPTOR_ADD_SUB(menu_edd, Efreet_Menu, "desktop", desktop, menu_desktop_edd);
+    EET_DATA_DESCRIPTOR_ADD_LIST(menu_edd, Efreet_Menu, "entries", entries, menu_edd);
+
+    EET_EINA_STREAM_DATA_DESCRIPTOR_CLASS_SET(&eddc, Efreet_Cache_Menu);
+    menu_cache_edd = eet_data_descriptor_stream_new(&eddc);
+    if (!menu_cache_edd) return NULL;
+
+    EET_DATA_DESCRIPTOR_ADD_BASIC(menu_cache_edd, Efreet_Cache_Menu, "path", path, EET_T_STRING);
+    EET_DATA_DESCRIPTOR_ADD_BASIC(menu_cache_edd, Efreet_Cache_Menu, "prefix", prefix, EET_T_STRING);
+    EET_DATA_DESCRIPTOR_ADD_BASIC(menu_cache_edd, Efreet_Cache_Menu, "lang", lang, EET_T_STRING);
+    EET_DATA_DESCRIPTOR_ADD_BASIC(menu_cache_edd, Efreet_Cache_Menu, "environment", environment, EET_T_STRING);
+    EET_DATA_DESCRIPTOR_ADD_BASIC(menu_cache_edd, Efreet_Cache_Menu, "config_dirs", config_dirs, EET_T_STRING);
+    EET_DATA_DESCRIPTOR_ADD_BASIC(menu_cache_edd, Efreet_Cache_Menu, "data_dirs", data_dirs, EET_T_STRING);
+    EET_DATA_DESCRIPTOR_ADD_BASIC(menu_cache_edd, Efreet_Cache_Menu, "collate", collate, EET_T_STRING);
+    EET_DATA_DESCRIPTOR_ADD_BASIC(menu_cache_edd, Efreet_Cache_Menu, "generation", generation, EET_T_LONG_LONG);
+    EET_DATA_DESCRIPTOR_ADD_HASH(menu_cache_edd, Efreet_Cache_Menu, "inputs", inputs, efreet_icon_directory_edd());
+    EET_DATA_DESCRIPTOR_ADD_SUB(menu_cache_edd, Efreet_Cache_Menu, "menu", menu, menu_edd);
+
+    return menu_cache_edd;
+}
+
 Efreet_Cache_Icon *
 efreet_cache_icon_find(Efreet_Icon_Theme *theme, const char *icon)
 {
-    Efreet_Cache_Icon *cache = NULL;
+    Efreet_Cache_Icon *cache;
+    Eina_List *visited = NULL;
+
+    cache = efreet_cache_icon_theme_icon_find(theme, icon, &visited);
+    eina_list_free(visited);
+    return cache;
+}
+
+/*
+ * Looks for the icon in the cache of the theme, and then follows the
+ * inherit chain the same way the themes were scanned before the caches
+ * were split per theme: depth first through Inherits, or hicolor if the
+ * theme doesn't inherit anything. The caches hold the icon in every
+ * extension, a theme which only has extensions that aren't asked for
+ * doesn't end the walk.
+ */
+static Efreet_Cache_Icon *
+efreet_cache_icon_theme_icon_find(Efreet_Icon_Theme *theme, const char *icon,
+                                  Eina_List **visited)
+{
+    Efreet_Icon_Theme_Cache *tc;
+    Efreet_Cache_Icon *cache = NULL, *parent;
+    Efreet_Icon_Theme *parent_theme;
 
-    if (theme_name && strcmp(theme_name, theme->name.internal))
+    if (eina_list_data_find(*visited, theme)) return NULL;
+    *visited = eina_list_append(*visited, theme);
+
+    tc = eina_hash_find(icon_caches, theme->name.internal);
+    if (!tc)
     {
-        /* FIXME: this is bad if people have pointer to this cache, things will go wrong */
-        INF("theme_name change from `%s` to `%s`", theme_name, theme->name.internal);
-        IF_RELEASE(theme_name);
-        icon_cache = efreet_cache_close(icon_cache);
-        eina_hash_free(icons);
-        icons = eina_hash_string_superfast_new(EINA_FREE_CB(efreet_cache_icon_free));
+        tc = NEW(Efreet_Icon_Theme_Cache, 1);
+        if (!tc) return NULL;
+        tc->icons = eina_hash_string_superfast_new(EINA_FREE_CB(efreet_cache_icon_free));
+        eina_hash_add(icon_caches, theme->name.internal, tc);
     }
 
-    if (!efreet_cache_check(&icon_cache, efreet_icon_cache_file(theme->name.internal), EFREET_ICON_CACHE_MAJOR)) return NULL;
-    if (!theme_name)
-        theme_name = eina_stringshare_add(theme->name.internal);
+    /* Caches are only built for themes which are in use, ask for this one.
+     * A dropped request resets requested, so it is sent again here */
+    if (!tc->requested &&
+        !efreet_cache_check(&tc->ef, efreet_icon_cache_file(theme->name.internal), EFREET_ICON_CACHE_MAJOR))
+    {
+        tc->requested = EINA_TRUE;
+        efreet_cache_icon_theme_request(theme->name.internal);
+    }
 
-    cache = eina_hash_find(icons, icon);
-    if (cache == NON_EXISTING) return NULL;
-    if (cache) return cache;
+    cache = eina_hash_find(tc->icons, icon);
+    if (cache == NON_EXISTING)
+        cache = NULL;
+    else if (!cache)
+    {
+        if (efreet_cache_check(&tc->ef, efreet_icon_cache_file(theme->name.internal), EFREET_ICON_CACHE_MAJOR))
+            cache = eet_data_read(tc->ef, efreet_icon_edd(), icon);
+        else
+            cache = efreet_cache_icon_theme_scan(theme, icon);
+        if (cache)
+            eina_hash_add(tc->icons, icon, cache);
+        else
+            eina_hash_add(tc->icons, icon, NON_EXISTING);
+    }
+    if (cache && efreet_cache_icon_extension_match(cache)) return cache;
 
-    cache = eet_data_read(icon_cache, efreet_icon_edd(), icon);
-    if (cache)
-        eina_hash_add(icons, icon, cache);
-    else
-        eina_hash_add(icons, icon, NON_EXISTING);
+    /* without a match further up an icon without the extensions is still
+     * returned, the caller finds no path in it */
+    if (theme->inherits)
+    {
+        const char *name;
+        Eina_List *l;
+
+        EINA_LIST_FOREACH(theme->inherits, l, name)
+        {
+            parent_theme = efreet_cache_icon_theme_find(name);
+            if (!parent_theme) continue;
+
+            parent = efreet_cache_icon_theme_icon_find(parent_theme, icon, visited);
+            if (!parent) continue;
+            if (efreet_cache_icon_extension_match(parent)) return parent;
+            if (!cache) cache = parent;
+        }
+    }
+    else if (strcmp(theme->name.internal, "hicolor"))
+    {
+        parent_theme = efreet_cache_icon_theme_find("hicolor");
+        if (parent_theme)
+        {
+            parent = efreet_cache_icon_theme_icon_find(parent_theme, icon, visited);
+            if (parent && (!cache || efreet_cache_icon_extension_match(parent)))
+                return parent;
+        }
+    }
     return cache;
 }
 
+/*
+ * Whether any path of the icon has one of the extensions looked up
+ */
+static Eina_Bool
+efreet_cache_icon_extension_match(Efreet_Cache_Icon *cache)
+{
+    Eina_List *exts, *l;
+    const char *ext, *p;
+    unsigned int i, j;
+
+    exts = efreet_icon_extensions_list_get();
+    for (i = 0; i < cache->icons_count; i++)
+    {
+        for (j = 0; j < cache->icons[i]->paths_count; j++)
+        {
+            p = strrchr(cache->icons[i]->paths[j], '.');
+            if (!p) continue;
+            EINA_LIST_FOREACH(exts, l, ext)
+            {
+                if (!strcmp(p, ext)) return EINA_TRUE;
+            }
+        }
+    }
+    return EINA_FALSE;
+}
+
+/*
+ * Stand in for the cache of a theme which hasn't been built yet. Probes
+ * each theme directory for the icon with the known extensions instead of
+ * listing them. The paths of each element are allocated in the same block
+ * as the path array, so efreet_cache_icon_free() can free it.
+ */
+static Efreet_Cache_Icon *
+efreet_cache_icon_theme_scan(Efreet_Icon_Theme *theme, const char *icon)
+{
+    Efreet_Cache_Icon *cache = NULL;
+    Efreet_Icon_Theme_Directory *dir;
+    Eina_List *exts, *l, *ll, *lll;
+    const char *path, *ext;
+    char buf[PATH_MAX];
+
+    exts = efreet_icon_extensions_list_get();
+    EINA_LIST_FOREACH(theme->directories, l, dir)
+    {
+        Efreet_Cache_Icon_Element *elem, **tmp;
+        Eina_List *found = NULL;
+        size_t size;
+        char *p;
+
+        EINA_LIST_FOREACH(theme->paths, ll, path)
+        {
+            EINA_LIST_FOREACH(exts, lll, ext)
+            {
+                snprintf(buf, sizeof(buf), "%s/%s/%s%s", path, dir->name, icon, ext);
+                if (ecore_file_exists(buf))
+                    found = eina_list_append(found, eina_stringshare_add(buf));
+            }
+        }
+        if (!found) continue;
+
+        if (!cache) cache = NEW(Efreet_Cache_Icon, 1);
+        if (!cache) goto next;
+        tmp = realloc(cache->icons, sizeof(Efreet_Cache_Icon_Element *) * (cache->icons_count + 1));
+        if (!tmp) goto next;
+        cache->icons = tmp;
+
+        size = sizeof(char *) * eina_list_count(found);
+        EINA_LIST_FOREACH(found, ll, path)
+            size += eina_stringshare_strlen(path) + 1;
+
+        elem = NEW(Efreet_Cache_Icon_Element, 1);
+        if (!elem) goto next;
+        elem->paths = malloc(size);
+        if (!elem->paths)
+        {
+            free(elem);
+            goto next;
+        }
+        elem->type = dir->type;
+        elem->normal = dir->size.normal;
+        elem->min = dir->size.min;
+        elem->max = dir->size.max;
+
+        p = (char *)(elem->paths + eina_list_count(found));
+        EINA_LIST_FOREACH(found, ll, path)
+        {
+            size = eina_stringshare_strlen(path) + 1;
+            memcpy(p, path, size);
+            elem->paths[elem->paths_count++] = p;
+            p += size;
+        }
+        cache->icons[cache->icons_count++] = elem;
+next:
+        EINA_LIST_FREE(found, path)
+            eina_stringshare_del(path);
+    }
+
+    if (cache && !cache->icons_count)
+    {
+        efreet_cache_icon_free(cache);
+        return NULL;
+    }
+    if (cache) cache->theme = theme->name.internal;
+    return cache;
+}
+
+static void
+efreet_cache_icon_theme_request(const char *theme)
+{
+    if (!efreet_cache_update) return;
+    if (eina_list_search_unsorted_list(icon_themes_requested, EINA_COMPARE_CB(strcmp), theme))
+        return;
+
+    icon_themes_requested = eina_list_append(icon_themes_requested, eina_stringshare_add(theme));
+    efreet_cache_icon_update();
+}
+
 Efreet_Cache_Fallback_Icon *
 efreet_cache_icon_fallback_find(const char *icon)
 {
@@ -720,6 +1159,27 @@ efreet_cache_icon_theme_find(const char *theme)
     return NULL;
 }
 
+/*
+ * All extra dirs which were passed to the icon cache builder. Their icons
+ * are in the fallback cache, but only the programs which use these dirs
+ * should see them.
+ */
+Efreet_Cache_Array_String *
+efreet_cache_icon_extra_dirs(void)
+{
+    if (icon_extra_dirs == NON_EXISTING) return NULL;
+    if (icon_extra_dirs) return icon_extra_dirs;
+    if (!efreet_cache_check(&icon_theme_cache, efreet_icon_theme_cache_file(), EFREET_ICON_CACHE_MAJOR)) return NULL;
+
+    icon_extra_dirs = eet_data_read(icon_theme_cache, efreet_array_string_edd(), EFREET_CACHE_ICON_EXTRA_DIRS);
+    if (!icon_extra_dirs)
+    {
+        icon_extra_dirs = NON_EXISTING;
+        return NULL;
+    }
+    return icon_extra_dirs;
+}
+
 static void
 efreet_cache_icon_free(Efreet_Cache_Icon *icon)
 {
@@ -738,6 +1198,16 @@ efreet_cache_icon_free(Efreet_Cache_Icon *icon)
     free(icon);
 }
 
+static void
+efreet_cache_icon_theme_cache_free(Efreet_Icon_Theme_Cache *cache)
+{
+    if (!cache) return;
+
+    IF_FREE_HASH(cache->icons);
+    efreet_cache_close(cache->ef);
+    free(cache);
+}
+
 static void
 efreet_cache_icon_fallback_free(Efreet_Cache_Fallback_Icon *icon)
 {
@@ -788,6 +1258,44 @@ efreet_cache_icon_theme_list(void)
     return ret;
 }
 
+/*
+ * Only reads the summary record of the theme cache, so the full themes are
+ * not decoded until they are used for a lookup.
+ */
+Eina_List *
+efreet_cache_icon_theme_summary_list(void)
+{
+    Efreet_Cache_Icon_Theme_Summary *summary;
+    Efreet_Icon_Theme_Summary *s;
+    Eina_Iterator *it;
+    Eina_List *ret = NULL;
+    unsigned int i;
+
+    if (!efreet_cache_check(&icon_theme_cache, efreet_icon_theme_cache_file(), EFREET_ICON_CACHE_MAJOR)) return NULL;
+    if (!theme_summaries)
+    {
+        theme_summaries = eina_hash_string_superfast_new(EINA_FREE_CB(free));
+        summary = eet_data_read(icon_theme_cache, efreet_icon_theme_summary_edd(), EFREET_CACHE_ICON_THEME_SUMMARY);
+        if (summary)
+        {
+            for (i = 0; i < summary->themes_count; ++i)
+            {
+                s = summary->themes[i];
+                if (!s->name.internal || !eina_hash_add(theme_summaries, s->name.internal, s))
+                    free(s);
+            }
+            free(summary->themes);
+            free(summary);
+        }
+    }
+
+    it = eina_hash_iterator_data_new(theme_summaries);
+    EINA_ITERATOR_FOREACH(it, s)
+        ret = eina_list_append(ret, s);
+    eina_iterator_free(it);
+    return ret;
+}
+
 /*
  * Needs EAPI because of helper binaries
  */
@@ -802,10 +1310,19 @@ efreet_cache_array_string_free(Efreet_Cache_Array_String *array)
 Efreet_Desktop *
 efreet_cache_desktop_find(const char *file)
 {
-    Efreet_Cache_Desktop *cache;
     char rp[PATH_MAX];
 
     if (!realpath(file, rp)) return NULL;
+    return efreet_cache_desktop_real_find(rp);
+}
+
+/*
+ * Looks up a desktop by the real path of its file, as stored in the caches
+ */
+Efreet_Desktop *
+efreet_cache_desktop_real_find(const char *rp)
+{
+    Efreet_Cache_Desktop *cache;
 
     if (!efreet_cache_check(&desktop_cache, efreet_desktop_cache_file(), EFREET_DESKTOP_CACHE_MAJOR)) return NULL;
 
@@ -846,6 +1363,10 @@ efreet_cache_desktop_find(const char *file)
         {
             cache->desktop.eet = 1;
             cache->check_time = ecore_time_get();
+            cache->ef = desktop_cache;
+            cache->exec_compiled = cache->desktop.exec;
+            cache->collate_name = cache->desktop.name;
+            if (!desktop_lazy) efreet_cache_desktop_cold_load(&cache->desktop);
             eina_hash_set(desktops, cache->desktop.orig_path, cache);
             return &cache->desktop;
         }
@@ -855,12 +1376,170 @@ efreet_cache_desktop_find(const char *file)
     return NULL;
 }
 
+void
+efreet_cache_desktop_cold_load(Efreet_Desktop *desktop)
+{
+    Efreet_Cache_Desktop *cache;
+    Efreet_Cache_Desktop_Cold *cold;
+    char key[PATH_MAX];
+
+    if (!desktop->eet) return;
+    cache = (Efreet_Cache_Desktop *)desktop;
+    if (cache->cold) return;
+    cache->cold = 1;
+
+    /* The cache file stays open as long as a desktop read from it is alive */
+    snprintf(key, sizeof(key), EFREET_CACHE_DESKTOP_COLD "%s", desktop->orig_path);
+    cold = eet_data_read(cache->ef, efreet_desktop_cold_edd(), key);
+    if (!cold) return;
+
+    cache->compact = cold;
+    if (!desktop_compact) efreet_cache_desktop_cold_expand(desktop);
+}
+
+void
+efreet_cache_desktop_cold_expand(Efreet_Desktop *desktop)
+{
+    Efreet_Cache_Desktop *cache;
+    Efreet_Cache_Desktop_Cold *cold;
+    unsigned int i;
+
+    efreet_cache_desktop_cold_load(desktop);
+    if (!desktop->eet) return;
+    cache = (Efreet_Cache_Desktop *)desktop;
+    cold = cache->compact;
+    if (!cold) return;
+    cache->compact = NULL;
+
+    /* Fields changed before the load win */
+    if (!desktop->categories)
+    {
+        for (i = 0; i < cold->categories_count; i++)
+            desktop->categories = eina_list_append(desktop->categories, cold->categories[i]);
+    }
+    if (!desktop->mime_types)
+    {
+        for (i = 0; i < cold->mime_types_count; i++)
+            desktop->mime_types = eina_list_append(desktop->mime_types, cold->mime_types[i]);
+    }
+    if (!desktop->x && (cold->x_count > 1))
+    {
+        desktop->x = eina_hash_string_superfast_new(NULL);
+        for (i = 0; i + 1 < cold->x_count; i += 2)
+            eina_hash_add(desktop->x, cold->x[i], cold->x[i + 1]);
+    }
+    efreet_cache_desktop_cold_free(cold);
+}
+
+Eina_Bool
+efreet_cache_desktop_x_field_find(Efreet_Desktop *desktop, const char *key,
+                                  const char **value)
+{
+    Efreet_Cache_Desktop_Cold *cold;
+    int lo, hi;
+
+    efreet_cache_desktop_cold_load(desktop);
+    if (!desktop->eet) return EINA_FALSE;
+    cold = ((Efreet_Cache_Desktop *)desktop)->compact;
+    if (!cold) return EINA_FALSE;
+
+    *value = NULL;
+    lo = 0;
+    hi = (cold->x_count / 2) - 1;
+    while (lo <= hi)
+    {
+        int mid, cmp;
+
+        mid = (lo + hi) / 2;
+        cmp = strcmp(key, cold->x[mid * 2]);
+        if (cmp == 0)
+        {
+            *value = cold->x[mid * 2 + 1];
+            break;
+        }
+        if (cmp < 0) hi = mid - 1;
+        else lo = mid + 1;
+    }
+    return EINA_TRUE;
+}
+
+Eina_Bool
+efreet_cache_desktop_category_count(Efreet_Desktop *desktop, unsigned int *count)
+{
+    Efreet_Cache_Desktop_Cold *cold;
+
+    efreet_cache_desktop_cold_load(desktop);
+    if (!desktop->eet) return EINA_FALSE;
+    cold = ((Efreet_Cache_Desktop *)desktop)->compact;
+    if (!cold) return EINA_FALSE;
+
+    *count = cold->categories_count;
+    return EINA_TRUE;
+}
+
+static void
+efreet_cache_desktop_cold_free(Efreet_Cache_Desktop_Cold *cold)
+{
+    if (!cold) return;
+    free(cold->categories);
+    free(cold->mime_types);
+    free(cold->x);
+    free(cold);
+}
+
+const char *
+efreet_cache_desktop_exec_template(Efreet_Desktop *desktop, int *flags)
+{
+    Efreet_Cache_Desktop *cache;
+
+    if (!desktop->eet) return NULL;
+    cache = (Efreet_Cache_Desktop *)desktop;
+    /* Don't use the template if exec has been changed since it was read */
+    if (!cache->exec_template || (cache->exec_compiled != desktop->exec))
+        return NULL;
+    *flags = cache->exec_flags;
+    return cache->exec_template;
+}
+
+const char *
+efreet_cache_desktop_collate_key(Efreet_Desktop *desktop)
+{
+    Efreet_Cache_Desktop *cache;
+    const char *locale, *current;
+    int size = 0;
+
+    if (!desktop->eet) return NULL;
+    cache = (Efreet_Cache_Desktop *)desktop;
+    if (!cache->collate_key || (cache->collate_name != desktop->name))
+        return NULL;
+
+    /* The key is only valid for the collation the cache was built with */
+    locale = eet_read_direct(cache->ef, EFREET_CACHE_DESKTOP_COLLATE, &size);
+    current = setlocale(LC_COLLATE, NULL);
+    if (!locale || (size < 1) || (locale[size - 1] != '\0') || !current ||
+        strcmp(locale, current))
+        return NULL;
+    return cache->collate_key;
+}
+
+void
+efreet_cache_desktop_lazy_set(Eina_Bool lazy)
+{
+    desktop_lazy = lazy;
+}
+
+void
+efreet_cache_desktop_compact_set(Eina_Bool compact)
+{
+    desktop_compact = compact;
+}
+
 void
 efreet_cache_desktop_free(Efreet_Desktop *desktop)
 {
     Efreet_Old_Cache *d;
     Efreet_Desktop *curr;
-    Eina_List *l;
+    Eina_List *l, *ll;
 
     if (!desktop ||
         desktop == NON_EXISTING ||
@@ -873,7 +1552,9 @@ efreet_cache_desktop_free(Efreet_Desktop *desktop)
         eina_hash_del_by_key(desktops, desktop->orig_path);
     }
 
-    EINA_LIST_FOREACH(old_desktop_caches, l, d)
+    /* Unchanged desktops are carried over to newer caches, so a desktop
+     * can be in more than one old cache */
+    EINA_LIST_FOREACH_SAFE(old_desktop_caches, l, ll, d)
     {
         curr = eina_hash_find(d->hash, desktop->orig_path);
         if (curr == desktop)
@@ -888,7 +1569,6 @@ efreet_cache_desktop_free(Efreet_Desktop *desktop)
                 free(d);
                 old_desktop_caches = eina_list_remove_list(old_desktop_caches, l);
             }
-            break;
         }
     }
 
@@ -897,23 +1577,18 @@ efreet_cache_desktop_free(Efreet_Desktop *desktop)
     eina_list_free(desktop->categories);
     eina_list_free(desktop->mime_types);
     IF_FREE_HASH(desktop->x);
+    efreet_cache_desktop_cold_free(((Efreet_Cache_Desktop *)desktop)->compact);
     free(desktop);
 }
 
 void
-efreet_cache_desktop_add(Efreet_Desktop *desktop)
+efreet_cache_desktop_dir_add(const char *dir)
 {
-    char buf[PATH_MAX];
-    char *dir;
     Efreet_Cache_Array_String *arr;
 
     /*
-     * Read file from disk, save path in cache so it will be included in next
-     * cache update
+     * Save dir so it will be included in next cache update
      */
-    strncpy(buf, desktop->orig_path, PATH_MAX);
-    buf[PATH_MAX - 1] = '\0';
-    dir = dirname(buf);
     arr = efreet_cache_desktop_dirs();
     if (arr)
     {
@@ -923,7 +1598,10 @@ efreet_cache_desktop_add(Efreet_Desktop *desktop)
         {
             /* Check if we already have this dir in cache */
             if (!strcmp(dir, arr->array[i]))
+            {
+                efreet_cache_array_string_free(arr);
                 return;
+            }
         }
         efreet_cache_array_string_free(arr);
     }
@@ -941,6 +1619,17 @@ efreet_cache_desktop_dirs(void)
     return eet_data_read(desktop_cache, efreet_array_string_edd(), EFREET_CACHE_DESKTOP_DIRS);
 }
 
+/*
+ * The serial of the desktop cache desktops are read from, 0 if there is none
+ */
+long long
+efreet_cache_desktop_generation(void)
+{
+    if (!efreet_cache_check(&desktop_cache, efreet_desktop_cache_file(), EFREET_DESKTOP_CACHE_MAJOR)) return 0;
+
+    return efreet_desktop_cache_serial_get(desktop_cache);
+}
+
 void
 efreet_cache_desktop_update(void)
 {
@@ -963,6 +1652,50 @@ efreet_cache_icon_update(void)
         icon_cache_timer = ecore_timer_add(0.2, icon_cache_update_cache_cb, NULL);
 }
 
+/*
+ * In watch budget mode only one process per user watches the source
+ * directories, the others rely on the *_data.update notifications.
+ */
+Eina_Bool
+efreet_cache_watch_budget_get(void)
+{
+    return watch_budget;
+}
+
+Eina_Bool
+efreet_cache_watch_owner_get(void)
+{
+    if (!efreet_cache_update) return EINA_FALSE;
+    if (!watch_budget) return EINA_TRUE;
+    return watch_owner;
+}
+
+static Eina_Bool
+efreet_cache_watch_lock_take(void)
+{
+    char file[PATH_MAX];
+    struct flock fl;
+
+    /*
+     * The lock fd is kept open even if we don't get the lock. Closing it
+     * would generate a close event for every other process waiting for
+     * the lock, and they would all retry.
+     */
+    if (watch_lock < 0)
+    {
+        snprintf(file, sizeof(file), "%s/efreet/watch.lock", efreet_cache_home_get());
+        watch_lock = open(file, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+        if (watch_lock < 0) return EINA_FALSE;
+        efreet_fsetowner(watch_lock);
+    }
+    memset(&fl, 0, sizeof(struct flock));
+    fl.l_type = F_WRLCK;
+    fl.l_whence = SEEK_SET;
+    if (fcntl(watch_lock, F_SETLK, &fl) < 0) return EINA_FALSE;
+    INF("Taking over directory watches for this session");
+    return EINA_TRUE;
+}
+
 static Eina_Bool
 efreet_cache_check(Eet_File **ef, const char *path, int major)
 {
@@ -1054,6 +1787,262 @@ efreet_cache_util_names(const char *key)
     return util_cache_names;
 }
 
+/*
+ * The processed menu cache. Each menu file gets its own cache file, which
+ * is replaced as a whole, so readers never see a partly written cache.
+ */
+Eina_Hash *
+efreet_cache_menu_inputs_new(void)
+{
+    Eina_Hash *inputs;
+
+    inputs = eina_hash_string_superfast_new(EINA_FREE_CB(free));
+    return inputs;
+}
+
+void
+efreet_cache_menu_input_add(Eina_Hash *inputs, const char *path)
+{
+    Efreet_Cache_Directory *input;
+
+    if (!inputs || !path) return;
+    if (eina_hash_find(inputs, path)) return;
+
+    input = NEW(Efreet_Cache_Directory, 1);
+    if (!input) return;
+    input->modified_time = ecore_file_mod_time(path);
+    eina_hash_add(inputs, path, input);
+}
+
+Efreet_Menu *
+efreet_cache_menu_find(const char *path, const char *prefix)
+{
+    Efreet_Cache_Menu *cache;
+    Efreet_Menu *menu = NULL;
+    Eet_File *ef = NULL;
+    Eina_Iterator *it;
+    Eina_Hash_Tuple *tuple;
+    Eina_Bool valid;
+    const char *config_dirs, *data_dirs;
+    char cache_file[PATH_MAX], lang[PATH_MAX];
+    long long generation;
+
+    EINA_SAFETY_ON_NULL_RETURN_VAL(path, NULL);
+
+    efreet_menu_cache_file(cache_file, sizeof(cache_file), path);
+    if (!efreet_cache_check(&ef, cache_file, EFREET_MENU_CACHE_MAJOR))
+        return NULL;
+    cache = eet_data_read(ef, efreet_menu_cache_edd(), EFREET_CACHE_MENU);
+    eet_close(ef);
+    if (!cache) return NULL;
+
+    efreet_menu_cache_lang(lang, sizeof(lang));
+    config_dirs = efreet_menu_cache_dirs(efreet_config_home_get(), efreet_config_dirs_get());
+    data_dirs = efreet_menu_cache_dirs(efreet_data_home_get(), efreet_data_dirs_get());
+    /* the menu must be built from the desktop cache we read desktops from */
+    generation = efreet_cache_desktop_generation();
+    valid = (cache->menu && cache->inputs && generation &&
+             (cache->generation == generation) &&
+             efreet_menu_cache_str_eq(cache->path, path) &&
+             efreet_menu_cache_str_eq(cache->prefix, prefix) &&
+             efreet_menu_cache_str_eq(cache->lang, lang) &&
+             efreet_menu_cache_str_eq(cache->environment,
+                                      efreet_desktop_environment_get()) &&
+             efreet_menu_cache_str_eq(cache->config_dirs, config_dirs) &&
+             efreet_menu_cache_str_eq(cache->data_dirs, data_dirs) &&
+             efreet_menu_cache_str_eq(cache->collate, setlocale(LC_COLLATE, NULL)));
+    eina_stringshare_del(config_dirs);
+    eina_stringshare_del(data_dirs);
+    if (valid)
+    {
+        it = eina_hash_iterator_tuple_new(cache->inputs);
+        EINA_ITERATOR_FOREACH(it, tuple)
+        {
+            Efreet_Cache_Directory *input;
+
+            input = tuple->data;
+            if (ecore_file_mod_time(tuple->key) != input->modified_time)
+            {
+                valid = EINA_FALSE;
+                break;
+            }
+        }
+        eina_iterator_free(it);
+    }
+
+    if (cache->menu)
+    {
+        /* always replace the stored paths, the tree is freed on failure */
+        if (!efreet_menu_cache_desktops_load(cache->menu, valid))
+            valid = EINA_FALSE;
+        if (valid) menu = cache->menu;
+        else efreet_menu_free(cache->menu);
+    }
+
+    IF_RELEASE(cache->path);
+    IF_RELEASE(cache->prefix);
+    IF_RELEASE(cache->lang);
+    IF_RELEASE(cache->environment);
+    IF_RELEASE(cache->config_dirs);
+    IF_RELEASE(cache->data_dirs);
+    IF_RELEASE(cache->collate);
+    if (cache->inputs) efreet_hash_free(cache->inputs, free);
+    free(cache);
+    return menu;
+}
+
+/*
+ * generation is the desktop cache serial from when the menu build started.
+ * The menu isn't stored if the desktop cache was replaced meanwhile, as it
+ * may be built from either cache.
+ */
+void
+efreet_cache_menu_save(const char *path, const char *prefix,
+                       Efreet_Menu *menu, Eina_Hash *inputs,
+                       long long generation)
+{
+    Efreet_Cache_Menu cache;
+    Efreet_Cache_Version version;
+    Eet_File *ef;
+    char file[PATH_MAX], cache_file[PATH_MAX], lang[PATH_MAX];
+    int tmpfd;
+    Eina_Bool ret;
+
+    if (!path || !menu || !inputs) return;
+
+    /* without a desktop cache edits to .desktop files can't be noticed */
+    if (!generation || (generation != efreet_cache_desktop_generation())) return;
+
+    snprintf(file, sizeof(file), "%s/efreet", efreet_cache_home_get());
+    if (!ecore_file_exists(file) && !ecore_file_mkpath(file)) return;
+
+    efreet_menu_cache_file(cache_file, sizeof(cache_file), path);
+    snprintf(file, sizeof(file), "%s.XXXXXX", cache_file);
+    tmpfd = mkstemp(file);
+    if (tmpfd < 0) return;
+    close(tmpfd);
+    ef = eet_open(file, EET_FILE_MODE_WRITE);
+    if (!ef)
+    {
+        unlink(file);
+        return;
+    }
+
+    efreet_menu_cache_lang(lang, sizeof(lang));
+    cache.path = path;
+    cache.prefix = prefix;
+    cache.lang = lang;
+    cache.environment = efreet_desktop_environment_get();
+    cache.config_dirs = efreet_menu_cache_dirs(efreet_config_home_get(), efreet_config_dirs_get());
+    cache.data_dirs = efreet_menu_cache_dirs(efreet_data_home_get(), efreet_data_dirs_get());
+    cache.collate = setlocale(LC_COLLATE, NULL);
+    cache.generation = generation;
+    cache.inputs = inputs;
+    cache.menu = menu;
+
+    version.major = EFREET_MENU_CACHE_MAJOR;
+    version.minor = EFREET_MENU_CACHE_MINOR;
+    eet_data_write(ef, efreet_version_edd(), EFREET_CACHE_VERSION, &version, 1);
+    ret = eet_data_write(ef, efreet_menu_cache_edd(), EFREET_CACHE_MENU, &cache, 1);
+    eina_stringshare_del(cache.config_dirs);
+    eina_stringshare_del(cache.data_dirs);
+    if (!ret)
+    {
+        eet_close(ef);
+        unlink(file);
+        return;
+    }
+    eet_close(ef);
+
+    if (rename(file, cache_file) < 0)
+        unlink(file);
+}
+
+static void
+efreet_menu_cache_file(char *buf, size_t size, const char *path)
+{
+    snprintf(buf, size, "%s/efreet/menu_%s_%08x.eet",
+             efreet_cache_home_get(), efreet_hostname_get(),
+             (unsigned int)eina_hash_superfast(path, strlen(path)));
+}
+
+static void
+efreet_menu_cache_lang(char *buf, size_t size)
+{
+    const char *lang, *country, *modifier;
+
+    lang = efreet_lang_get();
+    country = efreet_lang_country_get();
+    modifier = efreet_lang_modifier_get();
+
+    snprintf(buf, size, "%s_%s@%s", lang ? lang : "",
+             country ? country : "", modifier ? modifier : "");
+}
+
+/*
+ * Joins the home dir and the other dirs of a xdg search path, as menu files
+ * and desktops are looked up in them without their absence being recorded
+ */
+static const char *
+efreet_menu_cache_dirs(const char *home, Eina_List *dirs)
+{
+    Eina_Strbuf *buf;
+    Eina_List *l;
+    const char *dir, *ret;
+
+    buf = eina_strbuf_new();
+    if (!buf) return NULL;
+    if (home) eina_strbuf_append(buf, home);
+    EINA_LIST_FOREACH(dirs, l, dir)
+    {
+        eina_strbuf_append_char(buf, ':');
+        eina_strbuf_append(buf, dir);
+    }
+    ret = eina_stringshare_add(eina_strbuf_string_get(buf));
+    eina_strbuf_free(buf);
+    return ret;
+}
+
+static Eina_Bool
+efreet_menu_cache_str_eq(const char *a, const char *b)
+{
+    if (!a || !*a) return (!b || !*b);
+    if (!b) return EINA_FALSE;
+    return !strcmp(a, b);
+}
+
+/*
+ * Replaces the desktops read from the cache, which only hold orig_path, with
+ * the real desktops. Returns EINA_FALSE if a desktop couldn't be loaded.
+ */
+static Eina_Bool
+efreet_menu_cache_desktops_load(Efreet_Menu *entry, Eina_Bool load)
+{
+    Efreet_Menu *sub;
+    Eina_List *l;
+    Eina_Bool ret = EINA_TRUE;
+
+    if (entry->desktop)
+    {
+        Efreet_Desktop *stored;
+
+        stored = entry->desktop;
+        entry->desktop = NULL;
+        if (load && stored->orig_path)
+            entry->desktop = efreet_desktop_get(stored->orig_path);
+        if (!entry->desktop) ret = EINA_FALSE;
+        IF_RELEASE(stored->orig_path);
+        free(stored);
+    }
+
+    EINA_LIST_FOREACH(entry->entries, l, sub)
+    {
+        if (!efreet_menu_cache_desktops_load(sub, load && ret))
+            ret = EINA_FALSE;
+    }
+    return ret;
+}
+
 static Eina_Bool
 cache_exe_cb(void *data __UNUSED__, int type __UNUSED__, void *event)
 {
@@ -1077,6 +2066,8 @@ cache_exe_cb(void *data __UNUSED__, int type __UNUSED__, void *event)
             icon_cache_exe_lock = -1;
         }
         icon_cache_exe = NULL;
+        /* themes requested while the builder ran */
+        if (icon_themes_requested) efreet_cache_icon_update();
     }
     return ECORE_CALLBACK_RENEW;
 }
@@ -1104,6 +2095,8 @@ cache_update_cb(void *data __UNUSED__, Ecore_File_Monitor *em __UNUSED__,
     const char *file;
     Efreet_Event_Cache_Update *ev = NULL;
     Efreet_Old_Cache *d = NULL;
+    Efreet_Icon_Theme_Cache *tc;
+    Eina_Iterator *it;
     Eina_List *l = NULL;
 
     if (event != ECORE_FILE_EVENT_CLOSED)
@@ -1111,7 +2104,19 @@ cache_update_cb(void *data __UNUSED__, Ecore_File_Monitor *em __UNUSED__,
 
     file = ecore_file_file_get(path);
     if (!file) return;
-    if (!strcmp(file, "desktop_data.update"))
+    if (!strcmp(file, "watch.lock"))
+    {
+        /* The previous watch owner went away, try to take over */
+        if (!watch_budget || watch_owner) return;
+        if (!efreet_cache_watch_lock_take()) return;
+        watch_owner = EINA_TRUE;
+        efreet_icon_changes_listen();
+        efreet_desktop_changes_listen();
+        /* changes might have been missed while nobody was watching */
+        efreet_cache_icon_update();
+        efreet_cache_desktop_update();
+    }
+    else if (!strcmp(file, "desktop_data.update"))
     {
         if (cache_check_change(path))
         {
@@ -1133,6 +2138,33 @@ cache_update_cb(void *data __UNUSED__, Ecore_File_Monitor *em __UNUSED__,
             }
             desktop_cache = NULL;
 
+            ev->changes = desktop_cache_changes_get(d ? d->ef : NULL);
+            if (ev->changes && d)
+            {
+                Eina_Hash *stale;
+                Eina_Hash_Tuple *tuple;
+                const char *p;
+
+                /* Carry unchanged desktops over to the new cache, so they
+                 * stay valid. They are still kept in the old cache too, so
+                 * its file is closed when the last one is freed. */
+                stale = eina_hash_string_superfast_new(NULL);
+                EINA_LIST_FOREACH(ev->changes->removed, l, p)
+                    eina_hash_add(stale, p, (void *)1);
+                EINA_LIST_FOREACH(ev->changes->modified, l, p)
+                    eina_hash_add(stale, p, (void *)1);
+
+                it = eina_hash_iterator_tuple_new(d->hash);
+                EINA_ITERATOR_FOREACH(it, tuple)
+                {
+                    if (tuple->data == NON_EXISTING) continue;
+                    if (eina_hash_find(stale, tuple->key)) continue;
+                    eina_hash_add(desktops, tuple->key, tuple->data);
+                }
+                eina_iterator_free(it);
+                eina_hash_free(stale);
+            }
+
             efreet_cache_array_string_free(util_cache_names);
             util_cache_names = NULL;
 
@@ -1157,8 +2189,6 @@ cache_update_cb(void *data __UNUSED__, Ecore_File_Monitor *em __UNUSED__,
             ev = NEW(Efreet_Event_Cache_Update, 1);
             if (!ev) goto error;
 
-            IF_RELEASE(theme_name);
-
             /* Save all old caches */
             d = NEW(Efreet_Old_Cache, 1);
             if (!d) goto error;
@@ -1166,11 +2196,27 @@ cache_update_cb(void *data __UNUSED__, Ecore_File_Monitor *em __UNUSED__,
             d->ef = icon_theme_cache;
             l = eina_list_append(l, d);
 
-            d = NEW(Efreet_Old_Cache, 1);
-            if (!d) goto error;
-            d->hash = icons;
-            d->ef = icon_cache;
-            l = eina_list_append(l, d);
+            if (theme_summaries)
+            {
+                d = NEW(Efreet_Old_Cache, 1);
+                if (!d) goto error;
+                d->hash = theme_summaries;
+                l = eina_list_append(l, d);
+                theme_summaries = NULL;
+            }
+
+            it = eina_hash_iterator_data_new(icon_caches);
+            EINA_ITERATOR_FOREACH(it, tc)
+            {
+                d = NEW(Efreet_Old_Cache, 1);
+                if (!d) break;
+                d->hash = tc->icons;
+                d->ef = tc->ef;
+                l = eina_list_append(l, d);
+                tc->icons = NULL;
+                tc->ef = NULL;
+            }
+            eina_iterator_free(it);
 
             d = NEW(Efreet_Old_Cache, 1);
             if (!d) goto error;
@@ -1179,13 +2225,16 @@ cache_update_cb(void *data __UNUSED__, Ecore_File_Monitor *em __UNUSED__,
             l = eina_list_append(l, d);
 
             /* Create new empty caches */
+            eina_hash_free(icon_caches);
             themes = eina_hash_string_superfast_new(EINA_FREE_CB(efreet_cache_icon_theme_free));
-            icons = eina_hash_string_superfast_new(EINA_FREE_CB(efreet_cache_icon_free));
+            icon_caches = eina_hash_string_superfast_new(EINA_FREE_CB(efreet_cache_icon_theme_cache_free));
             fallbacks = eina_hash_string_superfast_new(EINA_FREE_CB(efreet_cache_icon_fallback_free));
 
             icon_theme_cache = NULL;
-            icon_cache = NULL;
             fallback_cache = NULL;
+            if (icon_extra_dirs != NON_EXISTING)
+                efreet_cache_array_string_free(icon_extra_dirs);
+            icon_extra_dirs = NULL;
 
             /* Send event */
             ecore_event_add(EFREET_EVENT_ICON_CACHE_UPDATE, ev, icon_cache_update_free, l);
@@ -1260,7 +2309,8 @@ icon_cache_update_cache_cb(void *data __UNUSED__)
 
     icon_cache_timer = NULL;
 
-    /* TODO: Retry update cache later */
+    /* our builder is running, it is run again for the themes requested
+     * meanwhile when it exits */
     if (icon_cache_exe_lock > 0) return ECORE_CALLBACK_CANCEL;
 
     snprintf(file, sizeof(file), "%s/efreet/icon_exec.lock", efreet_cache_home_get());
@@ -1301,6 +2351,18 @@ icon_cache_update_cache_cb(void *data __UNUSED__)
             eina_strlcat(file, p, sizeof(file));
         }
     }
+    if (icon_themes_requested)
+    {
+        const char *str;
+
+        eina_strlcat(file, " -t", sizeof(file));
+        EINA_LIST_FREE(icon_themes_requested, str)
+        {
+            eina_strlcat(file, " ", sizeof(file));
+            eina_strlcat(file, str, sizeof(file));
+            eina_stringshare_del(str);
+        }
+    }
     icon_cache_exe = ecore_exe_run(file, NULL);
     ecore_exe_run_priority_set(prio);
     if (!icon_cache_exe) goto error;
@@ -1313,9 +2375,26 @@ error:
         close(icon_cache_exe_lock);
         icon_cache_exe_lock = -1;
     }
+    /* another process is building, let later lookups request the themes
+     * again instead of dropping them as already requested */
+    efreet_cache_icon_requests_clear();
     return ECORE_CALLBACK_CANCEL;
 }
 
+static void
+efreet_cache_icon_requests_clear(void)
+{
+    Efreet_Icon_Theme_Cache *tc;
+    const char *str;
+
+    EINA_LIST_FREE(icon_themes_requested, str)
+    {
+        tc = eina_hash_find(icon_caches, str);
+        if (tc) tc->requested = EINA_FALSE;
+        eina_stringshare_del(str);
+    }
+}
+
 static void
 desktop_cache_update_free(void *data, void *ev)
 {
@@ -1339,6 +2418,8 @@ desktop_cache_update_free(void *data, void *ev)
             EINA_ITERATOR_FOREACH(it, tuple)
             {
                 if (tuple->data == NON_EXISTING) continue;
+                /* carried over to the current cache */
+                if (eina_hash_find(desktops, tuple->key) == tuple->data) continue;
                 WRN("%d:%s still in cache after update event!",
                     ((Efreet_Desktop *)tuple->data)->ref, (char *)tuple->key);
                 dangling++;
@@ -1355,9 +2436,72 @@ desktop_cache_update_free(void *data, void *ev)
                 dangling);
         }
     }
+    desktop_cache_changes_free(((Efreet_Event_Cache_Update *)ev)->changes);
     free(ev);
 }
 
+/*
+ * Read what the cache builder found changed for the new desktop cache. The
+ * changes are only valid if they were computed against the cache we had open,
+ * old, else NULL is returned so the whole cache is reloaded.
+ */
+static Efreet_Cache_Changes *
+desktop_cache_changes_get(Eet_File *old)
+{
+    Efreet_Cache_Desktop_Changes *cache;
+    Efreet_Cache_Changes *changes = NULL;
+    long long serial;
+    unsigned int i;
+
+    serial = efreet_desktop_cache_serial_get(old);
+    if (!serial) return NULL;
+    if (!efreet_cache_check(&desktop_cache, efreet_desktop_cache_file(), EFREET_DESKTOP_CACHE_MAJOR)) return NULL;
+    cache = eet_data_read(desktop_cache, efreet_desktop_changes_edd(), EFREET_CACHE_DESKTOP_CHANGES);
+    if (!cache) return NULL;
+    if (cache->base_serial != serial) goto error;
+
+    changes = NEW(Efreet_Cache_Changes, 1);
+    if (!changes) goto error;
+
+#define CHANGES_GET(_name) \
+    for (i = 0; i < cache->_name##_count; i++) \
+        changes->_name = eina_list_append(changes->_name, eina_stringshare_add(cache->_name[i])); \
+    IF_FREE(cache->_name);
+    CHANGES_GET(added);
+    CHANGES_GET(removed);
+    CHANGES_GET(modified);
+    CHANGES_GET(added_ids);
+    CHANGES_GET(removed_ids);
+    CHANGES_GET(modified_ids);
+#undef CHANGES_GET
+
+    free(cache);
+    return changes;
+error:
+    IF_FREE(cache->added);
+    IF_FREE(cache->removed);
+    IF_FREE(cache->modified);
+    IF_FREE(cache->added_ids);
+    IF_FREE(cache->removed_ids);
+    IF_FREE(cache->modified_ids);
+    free(cache);
+    return NULL;
+}
+
+static void
+desktop_cache_changes_free(Efreet_Cache_Changes *changes)
+{
+    if (!changes) return;
+
+    IF_FREE_LIST(changes->added, eina_stringshare_del);
+    IF_FREE_LIST(changes->removed, eina_stringshare_del);
+    IF_FREE_LIST(changes->modified, eina_stringshare_del);
+    IF_FREE_LIST(changes->added_ids, eina_stringshare_del);
+    IF_FREE_LIST(changes->removed_ids, eina_stringshare_del);
+    IF_FREE_LIST(changes->modified_ids, eina_stringshare_del);
+    free(changes);
+}
+
 static void
 icon_cache_update_free(void *data, void *ev)
 {
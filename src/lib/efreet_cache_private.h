@@ -1,19 +1,30 @@
 #ifndef EFREET_CACHE_PRIVATE_H
 #define EFREET_CACHE_PRIVATE_H
 
-#define EFREET_DESKTOP_CACHE_MAJOR 1
-#define EFREET_DESKTOP_CACHE_MINOR 0
+#define EFREET_DESKTOP_CACHE_MAJOR 4
+#define EFREET_DESKTOP_CACHE_MINOR 2
 #define EFREET_DESKTOP_UTILS_CACHE_MAJOR 1
-#define EFREET_DESKTOP_UTILS_CACHE_MINOR 0
+#define EFREET_DESKTOP_UTILS_CACHE_MINOR 1
 
-#define EFREET_ICON_CACHE_MAJOR 1
+#define EFREET_ICON_CACHE_MAJOR 2
 #define EFREET_ICON_CACHE_MINOR 0
 
+#define EFREET_MENU_CACHE_MAJOR 1
+#define EFREET_MENU_CACHE_MINOR 1
+
 #define EFREET_CACHE_VERSION "__efreet//version"
 #define EFREET_CACHE_ICON_FALLBACK "__efreet_fallback"
 #define EFREET_CACHE_ICON_EXTENSIONS "__efreet//icon_extensions"
 #define EFREET_CACHE_ICON_EXTRA_DIRS "__efreet//icon_extra_dirs"
+#define EFREET_CACHE_ICON_REQUESTED "__efreet//icon_requested"
+#define EFREET_CACHE_ICON_THEME_SUMMARY "__efreet//icon_theme_summary"
 #define EFREET_CACHE_DESKTOP_DIRS "__efreet//desktop_dirs"
+#define EFREET_CACHE_DESKTOP_MANIFEST "__efreet//desktop_manifest"
+#define EFREET_CACHE_DESKTOP_CHANGES "__efreet//desktop_changes"
+#define EFREET_CACHE_DESKTOP_COLD "__efreet_cold/"
+#define EFREET_CACHE_DESKTOP_COLLATE "__efreet//desktop_collate"
+#define EFREET_CACHE_DESKTOP_SERIAL "__efreet//desktop_serial"
+#define EFREET_CACHE_MENU "__efreet//menu"
 
 EAPI const char *efreet_desktop_util_cache_file(void);
 EAPI const char *efreet_desktop_cache_file(void);
@@ -22,16 +33,26 @@ EAPI const char *efreet_icon_theme_cache_file(void);
 
 EAPI Eet_Data_Descriptor *efreet_version_edd(void);
 EAPI Eet_Data_Descriptor *efreet_desktop_edd(void);
+EAPI Eet_Data_Descriptor *efreet_desktop_cold_edd(void);
 EAPI Eet_Data_Descriptor *efreet_hash_array_string_edd(void);
 EAPI Eet_Data_Descriptor *efreet_hash_string_edd(void);
 EAPI Eet_Data_Descriptor *efreet_array_string_edd(void);
+EAPI Eet_Data_Descriptor *efreet_desktop_manifest_edd(void);
+EAPI Eet_Data_Descriptor *efreet_desktop_changes_edd(void);
+EAPI long long efreet_desktop_cache_serial_get(Eet_File *ef);
 EAPI Eet_Data_Descriptor *efreet_icon_theme_edd(Eina_Bool cache);
 EAPI Eet_Data_Descriptor *efreet_icon_edd(void);
 EAPI Eet_Data_Descriptor *efreet_icon_fallback_edd(void);
+EAPI Eet_Data_Descriptor *efreet_icon_theme_summary_edd(void);
 
 typedef struct _Efreet_Cache_Icon_Theme Efreet_Cache_Icon_Theme;
+typedef struct _Efreet_Cache_Icon_Theme_Summary Efreet_Cache_Icon_Theme_Summary;
 typedef struct _Efreet_Cache_Directory Efreet_Cache_Directory;
 typedef struct _Efreet_Cache_Desktop Efreet_Cache_Desktop;
+typedef struct _Efreet_Cache_Desktop_Cold Efreet_Cache_Desktop_Cold;
+typedef struct _Efreet_Cache_Desktop_Dir Efreet_Cache_Desktop_Dir;
+typedef struct _Efreet_Cache_Desktop_Changes Efreet_Cache_Desktop_Changes;
+typedef struct _Efreet_Cache_Menu Efreet_Cache_Menu;
 
 struct _Efreet_Cache_Icon_Theme
 {
@@ -48,16 +69,90 @@ struct _Efreet_Cache_Icon_Theme
     Eina_Bool changed:1;        /**< Changed since last seen */
 };
 
+struct _Efreet_Cache_Icon_Theme_Summary
+{
+    Efreet_Icon_Theme_Summary **themes;
+    unsigned int themes_count;
+};
+
 struct _Efreet_Cache_Directory
 {
     long long modified_time;
 };
 
+struct _Efreet_Cache_Desktop_Dir
+{
+    long long modified_time;
+
+    const char **entries;   /**< desktop files, and sub dirs with a trailing '/' */
+    unsigned int entries_count;
+};
+
+/* Difference to the previous desktop cache */
+struct _Efreet_Cache_Desktop_Changes
+{
+    long long base_serial;  /**< serial of the cache the difference is against */
+
+    const char **added;
+    unsigned int added_count;
+    const char **removed;
+    unsigned int removed_count;
+    const char **modified;
+    unsigned int modified_count;
+
+    const char **added_ids;
+    unsigned int added_ids_count;
+    const char **removed_ids;
+    unsigned int removed_ids_count;
+    const char **modified_ids;
+    unsigned int modified_ids_count;
+};
+
 struct _Efreet_Cache_Desktop
 {
     Efreet_Desktop desktop;
 
     double check_time; /**< Last time we check for disk modification */
+
+    const char *exec_template; /**< Exec compiled by efreet_desktop_exec_compile() */
+    int exec_flags;            /**< File field codes present in exec_template */
+    const char *exec_compiled; /**< The exec exec_template was read for */
+
+    const char *collate_key;   /**< Name key from efreet_collate_key_new() */
+    const char *collate_name;  /**< The name collate_key was read for */
+
+    Eet_File *ef;      /**< The cache the desktop was read from */
+    Efreet_Cache_Desktop_Cold *compact; /**< Cold record kept as arrays */
+    Eina_Bool cold:1;  /**< The cold record has been read */
+};
+
+/* Fields which are seldom used, stored under EFREET_CACHE_DESKTOP_COLD + orig_path.
+ * The strings point into the cache file */
+struct _Efreet_Cache_Desktop_Cold
+{
+    const char **categories;
+    unsigned int categories_count;
+    const char **mime_types;
+    unsigned int mime_types_count;
+    const char **x;    /**< key, value pairs sorted by key */
+    unsigned int x_count;
+};
+
+/* A processed menu together with everything it was built from */
+struct _Efreet_Cache_Menu
+{
+    const char *path;        /**< The menu file which was parsed */
+    const char *prefix;      /**< $XDG_MENU_PREFIX */
+    const char *lang;        /**< The locale */
+    const char *environment; /**< The desktop environment */
+    const char *config_dirs; /**< The config dirs menus were looked up in */
+    const char *data_dirs;   /**< The data dirs desktops were looked up in */
+    const char *collate;     /**< LC_COLLATE the menus were sorted with */
+
+    long long generation;    /**< Serial of the desktop cache used */
+    Eina_Hash *inputs;       /**< Files and dirs read, with their modification time */
+
+    Efreet_Menu *menu;       /**< Desktops only have their orig_path stored */
 };
 
 #endif
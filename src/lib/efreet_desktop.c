@@ -24,6 +24,7 @@ void *alloca (size_t);
 # include <Evil.h>
 #endif
 
+#include <Ecore.h>
 #include <Ecore_File.h>
 
 /* define macros and variable for using the eina logging system  */
@@ -47,6 +48,34 @@ static Eina_List *efreet_desktop_types = NULL;
 
 static Eina_Hash *change_monitors = NULL;
 
+/**
+ * Desktops read by efreet_desktop_get() which aren't in the desktop cache,
+ * keyed by orig_path. They are kept for the lifetime of the process only,
+ * see efreet_desktop_dir_promote() to have a directory cached. The least
+ * recently used are dropped when there are more than
+ * EFREET_DESKTOP_OVERLAY_MAX, the list has the most recently used first.
+ */
+#define EFREET_DESKTOP_OVERLAY_MAX 32
+static Eina_Hash *desktop_overlay = NULL;
+static Eina_List *desktop_overlay_lru = NULL;
+
+/**
+ * In watch budget mode only the application roots are monitored, the
+ * directories below them are tracked by mtime and swept on changes. The
+ * mtime of a directory only changes when entries are added or removed, so
+ * the newest mtime of the desktop files in it is tracked for edits.
+ */
+#define EFREET_DESKTOP_SWEEP_INTERVAL 60.0
+typedef struct _Efreet_Desktop_Change_Dir Efreet_Desktop_Change_Dir;
+struct _Efreet_Desktop_Change_Dir
+{
+    long long mtime;
+    long long files_mtime;
+};
+static Eina_Hash *change_dirs = NULL;
+static Ecore_Timer *change_sweep_timer = NULL;
+static Ecore_Timer *change_sweep_poll = NULL;
+
 EAPI int EFREET_DESKTOP_TYPE_APPLICATION = 0;
 EAPI int EFREET_DESKTOP_TYPE_LINK = 0;
 EAPI int EFREET_DESKTOP_TYPE_DIRECTORY = 0;
@@ -89,12 +118,21 @@ static Eina_Bool efreet_desktop_x_fields_save(const Eina_Hash *hash,
                                                 void *value,
                                                 void *fdata);
 static int efreet_desktop_environment_check(Efreet_Desktop *desktop);
+static Efreet_Desktop *efreet_desktop_cache_hit(Efreet_Desktop *desktop);
+static Efreet_Desktop *efreet_desktop_overlay_find(const char *file);
+static void efreet_desktop_overlay_add(Efreet_Desktop *desktop);
+static void efreet_desktop_overlay_del(const char *file);
 
-static void efreet_desktop_changes_listen(void);
 static void efreet_desktop_changes_listen_recursive(const char *path);
 static void efreet_desktop_changes_monitor_add(const char *path);
 static void efreet_desktop_changes_cb(void *data, Ecore_File_Monitor *em,
                                              Ecore_File_Event event, const char *path);
+static void efreet_desktop_changes_dirs_add(const char *path);
+static void efreet_desktop_changes_dirs_scan(const char *path);
+static long long efreet_desktop_changes_files_mtime(const char *path);
+static void efreet_desktop_changes_sweep_queue(void);
+static Eina_Bool efreet_desktop_changes_sweep_cb(void *data);
+static Eina_Bool efreet_desktop_changes_poll_cb(void *data);
 
 /**
  * @internal
@@ -145,11 +183,20 @@ void
 efreet_desktop_shutdown(void)
 {
     Efreet_Desktop_Type_Info *info;
+    Efreet_Desktop *desktop;
 
     IF_RELEASE(desktop_environment);
+    IF_FREE_HASH(desktop_overlay);
+    EINA_LIST_FREE(desktop_overlay_lru, desktop)
+        efreet_desktop_free(desktop);
     EINA_LIST_FREE(efreet_desktop_types, info)
         efreet_desktop_type_info_free(info);
     IF_FREE_HASH(change_monitors);
+    IF_FREE_HASH(change_dirs);
+    if (change_sweep_timer) ecore_timer_del(change_sweep_timer);
+    change_sweep_timer = NULL;
+    if (change_sweep_poll) ecore_timer_del(change_sweep_poll);
+    change_sweep_poll = NULL;
 #ifdef HAVE_EVIL
     evil_sockets_shutdown();
 #endif
@@ -161,31 +208,65 @@ EAPI Efreet_Desktop *
 efreet_desktop_get(const char *file)
 {
     Efreet_Desktop *desktop;
+    Efreet_Desktop_Type_Info *info;
 
     EINA_SAFETY_ON_NULL_RETURN_VAL(file, NULL);
 
-    desktop = efreet_desktop_new(file);
-    if (!desktop) return NULL;
-
-    /* If we didn't find this file in the eet cache, add path to search path */
-    if (!desktop->eet)
+    desktop = efreet_cache_desktop_find(file);
+    if (desktop) return efreet_desktop_cache_hit(desktop);
+    desktop = efreet_desktop_overlay_find(file);
+    if (desktop)
     {
-        /* Check whether the desktop type is a system type,
-         * and therefor known by the cache builder */
-        Efreet_Desktop_Type_Info *info;
-
-        info = eina_list_nth(efreet_desktop_types, desktop->type);
-        if (info && (
-                info->id == EFREET_DESKTOP_TYPE_APPLICATION ||
-                info->id == EFREET_DESKTOP_TYPE_LINK ||
-                info->id == EFREET_DESKTOP_TYPE_DIRECTORY
-                ))
-            efreet_cache_desktop_add(desktop);
+        desktop->ref++;
+        return desktop;
     }
+    desktop = efreet_desktop_uncached_new(file);
+    if (!desktop) return NULL;
+
+    /* We didn't find this file in the eet cache, keep it in the overlay
+     * so the next lookup doesn't have to parse it again. Check whether the
+     * desktop type is a system type, and therefor known by the cache builder */
+    info = eina_list_nth(efreet_desktop_types, desktop->type);
+    if (info && (
+            info->id == EFREET_DESKTOP_TYPE_APPLICATION ||
+            info->id == EFREET_DESKTOP_TYPE_LINK ||
+            info->id == EFREET_DESKTOP_TYPE_DIRECTORY
+            ))
+        efreet_desktop_overlay_add(desktop);
 
     return desktop;
 }
 
+/*
+ * efreet_desktop_get() for a file path which is already resolved, like the
+ * paths stored in the desktop caches. Skips realpath() on a cache hit.
+ */
+Efreet_Desktop *
+efreet_desktop_real_get(const char *rp)
+{
+    Efreet_Desktop *desktop;
+
+    EINA_SAFETY_ON_NULL_RETURN_VAL(rp, NULL);
+
+    desktop = efreet_cache_desktop_real_find(rp);
+    if (desktop) return efreet_desktop_cache_hit(desktop);
+    return efreet_desktop_get(rp);
+}
+
+EAPI Eina_Bool
+efreet_desktop_dir_promote(const char *dir)
+{
+    char rp[PATH_MAX];
+
+    EINA_SAFETY_ON_NULL_RETURN_VAL(dir, EINA_FALSE);
+
+    if (!realpath(dir, rp)) return EINA_FALSE;
+    if (!ecore_file_is_dir(rp)) return EINA_FALSE;
+
+    efreet_cache_desktop_dir_add(rp);
+    return EINA_TRUE;
+}
+
 EAPI int
 efreet_desktop_ref(Efreet_Desktop *desktop)
 {
@@ -220,17 +301,7 @@ efreet_desktop_new(const char *file)
     EINA_SAFETY_ON_NULL_RETURN_VAL(file, NULL);
 
     desktop = efreet_cache_desktop_find(file);
-    if (desktop)
-    {
-        desktop->ref++;
-        if (!efreet_desktop_environment_check(desktop))
-        {
-            efreet_desktop_free(desktop);
-            return NULL;
-        }
-        return desktop;
-        efreet_desktop_free(desktop);
-    }
+    if (desktop) return efreet_desktop_cache_hit(desktop);
     return efreet_desktop_uncached_new(file);
 }
 
@@ -266,6 +337,7 @@ efreet_desktop_save(Efreet_Desktop *desktop)
     int ok = 1;
 
     EINA_SAFETY_ON_NULL_RETURN_VAL(desktop, 0);
+    efreet_cache_desktop_cold_expand(desktop);
 
     ini = efreet_ini_new(NULL);
     if (!ini) return 0;
@@ -317,15 +389,35 @@ efreet_desktop_save(Efreet_Desktop *desktop)
 EAPI int
 efreet_desktop_save_as(Efreet_Desktop *desktop, const char *file)
 {
+    char rp[PATH_MAX];
+    Eina_Bool overlaid;
+    int ok;
+
     EINA_SAFETY_ON_NULL_RETURN_VAL(desktop, 0);
     EINA_SAFETY_ON_NULL_RETURN_VAL(file, 0);
 
     /* If we save data from eet as new, we will be in trouble */
     if (desktop->eet) return 0;
 
+    /* the overlay is keyed by orig_path, take the desktop out while it
+     * changes and put it back under the new path. Our caller holds a
+     * reference too, so dropping the one of the overlay doesn't free it */
+    overlaid = (desktop_overlay &&
+                (eina_hash_find(desktop_overlay, desktop->orig_path) == desktop));
+    if (overlaid) efreet_desktop_overlay_del(desktop->orig_path);
+
     IF_FREE(desktop->orig_path);
     desktop->orig_path = strdup(file);
-    return efreet_desktop_save(desktop);
+    ok = efreet_desktop_save(desktop);
+
+    if (ok && overlaid && realpath(file, rp))
+    {
+        IF_FREE(desktop->orig_path);
+        desktop->orig_path = strdup(rp);
+        desktop->load_time = ecore_file_mod_time(rp);
+        efreet_desktop_overlay_add(desktop);
+    }
+    return ok;
 }
 
 EAPI void
@@ -389,10 +481,41 @@ efreet_desktop_environment_get(void)
     return desktop_environment;
 }
 
+EAPI void
+efreet_desktop_lazy_fields_set(Eina_Bool lazy)
+{
+    efreet_cache_desktop_lazy_set(lazy);
+}
+
+EAPI void
+efreet_desktop_compact_set(Eina_Bool compact)
+{
+    efreet_cache_desktop_compact_set(compact);
+}
+
+EAPI Eina_List *
+efreet_desktop_categories_get(Efreet_Desktop *desktop)
+{
+    EINA_SAFETY_ON_NULL_RETURN_VAL(desktop, NULL);
+    efreet_cache_desktop_cold_expand(desktop);
+    return desktop->categories;
+}
+
+EAPI Eina_List *
+efreet_desktop_mime_types_get(Efreet_Desktop *desktop)
+{
+    EINA_SAFETY_ON_NULL_RETURN_VAL(desktop, NULL);
+    efreet_cache_desktop_cold_expand(desktop);
+    return desktop->mime_types;
+}
+
 EAPI unsigned int
 efreet_desktop_category_count_get(Efreet_Desktop *desktop)
 {
+    unsigned int count;
+
     EINA_SAFETY_ON_NULL_RETURN_VAL(desktop, 0);
+    if (efreet_cache_desktop_category_count(desktop, &count)) return count;
     return eina_list_count(desktop->categories);
 }
 
@@ -401,6 +524,7 @@ efreet_desktop_category_add(Efreet_Desktop *desktop, const char *category)
 {
     EINA_SAFETY_ON_NULL_RETURN(desktop);
     EINA_SAFETY_ON_NULL_RETURN(category);
+    efreet_cache_desktop_cold_expand(desktop);
 
     if (eina_list_search_unsorted(desktop->categories,
                                   EINA_COMPARE_CB(strcmp), category)) return;
@@ -415,6 +539,7 @@ efreet_desktop_category_del(Efreet_Desktop *desktop, const char *category)
     char *found = NULL;
 
     EINA_SAFETY_ON_NULL_RETURN_VAL(desktop, 0);
+    efreet_cache_desktop_cold_expand(desktop);
 
     if ((found = eina_list_search_unsorted(desktop->categories,
                                            EINA_COMPARE_CB(strcmp), category)))
@@ -467,6 +592,7 @@ efreet_desktop_x_field_set(Efreet_Desktop *desktop, const char *key, const char
 {
     EINA_SAFETY_ON_NULL_RETURN_VAL(desktop, EINA_FALSE);
     EINA_SAFETY_ON_TRUE_RETURN_VAL(strncmp(key, "X-", 2), EINA_FALSE);
+    efreet_cache_desktop_cold_expand(desktop);
 
     if (!desktop->x)
         desktop->x = eina_hash_string_superfast_new(EINA_FREE_CB(eina_stringshare_del));
@@ -483,9 +609,12 @@ efreet_desktop_x_field_get(Efreet_Desktop *desktop, const char *key)
     const char *ret;
 
     EINA_SAFETY_ON_NULL_RETURN_VAL(desktop, NULL);
-    EINA_SAFETY_ON_NULL_RETURN_VAL(desktop->x, NULL);
     EINA_SAFETY_ON_TRUE_RETURN_VAL(strncmp(key, "X-", 2), NULL);
 
+    if (efreet_cache_desktop_x_field_find(desktop, key, &ret))
+        return ret ? eina_stringshare_add(ret) : NULL;
+    EINA_SAFETY_ON_NULL_RETURN_VAL(desktop->x, NULL);
+
     ret = eina_hash_find(desktop->x, key);
     if (!ret)
         return NULL;
@@ -498,6 +627,7 @@ efreet_desktop_x_field_del(Efreet_Desktop *desktop, const char *key)
 {
     EINA_SAFETY_ON_NULL_RETURN_VAL(desktop, EINA_FALSE);
     EINA_SAFETY_ON_TRUE_RETURN_VAL(strncmp(key, "X-", 2), EINA_FALSE);
+    efreet_cache_desktop_cold_expand(desktop);
     EINA_SAFETY_ON_NULL_RETURN_VAL(desktop->x, EINA_FALSE);
 
     return eina_hash_del_by_key(desktop->x, key);
@@ -597,7 +727,7 @@ efreet_desktop_read(Efreet_Desktop *desktop)
     int error = 0;
     int ok;
 
-    ini = efreet_ini_new(desktop->orig_path);
+    ini = efreet_ini_desktop_new(desktop->orig_path);
     if (!ini) return 0;
     if (!ini->data)
     {
@@ -932,6 +1062,99 @@ efreet_desktop_x_fields_save(const Eina_Hash *hash __UNUSED__, const void *key,
     return EINA_TRUE;
 }
 
+/**
+ * @internal
+ * @param desktop The desktop found in the cache
+ * @return Returns the referenced desktop, or NULL if it isn't for this
+ * environment
+ */
+static Efreet_Desktop *
+efreet_desktop_cache_hit(Efreet_Desktop *desktop)
+{
+    /* The cache has caught up with a desktop from the overlay */
+    efreet_desktop_overlay_del(desktop->orig_path);
+    desktop->ref++;
+    if (!efreet_desktop_environment_check(desktop))
+    {
+        efreet_desktop_free(desktop);
+        return NULL;
+    }
+    return desktop;
+}
+
+/**
+ * @internal
+ * @param file The file to look for
+ * @return Returns the desktop from the overlay, or NULL if it isn't there
+ * or the file has changed since it was read
+ */
+static Efreet_Desktop *
+efreet_desktop_overlay_find(const char *file)
+{
+    Efreet_Desktop *desktop;
+    char rp[PATH_MAX];
+
+    if (!desktop_overlay) return NULL;
+    if (!realpath(file, rp)) return NULL;
+
+    desktop = eina_hash_find(desktop_overlay, rp);
+    if (!desktop) return NULL;
+    if (desktop->load_time != ecore_file_mod_time(rp))
+    {
+        efreet_desktop_overlay_del(rp);
+        return NULL;
+    }
+    desktop_overlay_lru = eina_list_promote_list(desktop_overlay_lru,
+                                                 eina_list_data_find_list(desktop_overlay_lru, desktop));
+    return desktop;
+}
+
+/**
+ * @internal
+ * @param desktop The desktop to keep
+ * @brief Keeps a desktop which isn't in the desktop cache, the overlay
+ * holds a reference on it. Drops the least recently used desktop if the
+ * overlay is full.
+ */
+static void
+efreet_desktop_overlay_add(Efreet_Desktop *desktop)
+{
+    Efreet_Desktop *old;
+
+    if (!desktop_overlay)
+        desktop_overlay = eina_hash_string_superfast_new(NULL);
+    if (eina_hash_find(desktop_overlay, desktop->orig_path) == desktop) return;
+
+    efreet_desktop_overlay_del(desktop->orig_path);
+    if (eina_list_count(desktop_overlay_lru) >= EFREET_DESKTOP_OVERLAY_MAX)
+    {
+        old = eina_list_data_get(eina_list_last(desktop_overlay_lru));
+        efreet_desktop_overlay_del(old->orig_path);
+    }
+
+    desktop->ref++;
+    eina_hash_add(desktop_overlay, desktop->orig_path, desktop);
+    desktop_overlay_lru = eina_list_prepend(desktop_overlay_lru, desktop);
+}
+
+/**
+ * @internal
+ * @param file The real path of the desktop to drop
+ * @brief Drops a desktop from the overlay and releases its reference
+ */
+static void
+efreet_desktop_overlay_del(const char *file)
+{
+    Efreet_Desktop *desktop;
+
+    if (!desktop_overlay) return;
+    desktop = eina_hash_find(desktop_overlay, file);
+    if (!desktop) return;
+
+    eina_hash_del_by_key(desktop_overlay, file);
+    desktop_overlay_lru = eina_list_remove(desktop_overlay_lru, desktop);
+    efreet_desktop_free(desktop);
+}
 
 /**
  * @internal
@@ -983,25 +1206,47 @@ efreet_desktop_environment_check(Efreet_Desktop *desktop)
     return 1;
 }
 
-static void
+/**
+ * @internal
+ * @return Returns no value
+ * @brief Sets up the monitors for the application dirs. Only the process
+ * owning the watches does this, see efreet_cache_watch_owner_get().
+ */
+void
 efreet_desktop_changes_listen(void)
 {
     Efreet_Cache_Array_String *arr;
     Eina_List *dirs;
     const char *path;
 
-    if (!efreet_cache_update) return;
+    if (change_monitors) return;
+    if (!efreet_cache_watch_owner_get()) return;
 
     change_monitors = eina_hash_string_superfast_new(EINA_FREE_CB(ecore_file_monitor_del));
     if (!change_monitors) return;
 
+    if (efreet_cache_watch_budget_get())
+    {
+        change_dirs = eina_hash_string_superfast_new(EINA_FREE_CB(free));
+        change_sweep_poll = ecore_timer_add(EFREET_DESKTOP_SWEEP_INTERVAL,
+                                           efreet_desktop_changes_poll_cb, NULL);
+    }
+
     dirs = efreet_default_dirs_get(efreet_data_home_get(),
                                    efreet_data_dirs_get(), "applications");
 
     EINA_LIST_FREE(dirs, path)
     {
         if (ecore_file_is_dir(path))
-            efreet_desktop_changes_listen_recursive(path);
+        {
+            if (change_dirs)
+            {
+                efreet_desktop_changes_monitor_add(path);
+                efreet_desktop_changes_dirs_add(path);
+            }
+            else
+                efreet_desktop_changes_listen_recursive(path);
+        }
         eina_stringshare_del(path);
     }
 
@@ -1052,6 +1297,11 @@ efreet_desktop_changes_cb(void *data __UNUSED__, Ecore_File_Monitor *em __UNUSED
 {
     const char *ext;
 
+    /* the roots are the only monitored dirs, anything there may have
+     * touched the unmonitored dirs below them */
+    if (change_dirs && (event != ECORE_FILE_EVENT_NONE))
+        efreet_desktop_changes_sweep_queue();
+
     /* TODO: If we get a stale symlink, we need to rerun cache creation */
     /* TODO: Check for desktop*.cache, as this will be created when app is installed */
     /* TODO: Do efreet_cache_icon_update() when app is installed, as it has the same
@@ -1078,8 +1328,155 @@ efreet_desktop_changes_cb(void *data __UNUSED__, Ecore_File_Monitor *em __UNUSED
             break;
 
         case ECORE_FILE_EVENT_CREATED_DIRECTORY:
-            efreet_desktop_changes_monitor_add(path);
+            if (change_dirs)
+                efreet_desktop_changes_dirs_add(path);
+            else
+                efreet_desktop_changes_monitor_add(path);
             efreet_cache_desktop_update();
             break;
     }
 }
+
+/**
+ * @internal
+ * @param path The directory to track
+ * @return Returns no value
+ * @brief Records the mtimes of @a path and all directories below it
+ */
+static void
+efreet_desktop_changes_dirs_add(const char *path)
+{
+    Efreet_Desktop_Change_Dir *dir;
+    char rp[PATH_MAX];
+
+    if (!realpath(path, rp)) return;
+    if (eina_hash_find(change_dirs, rp)) return;
+    dir = NEW(Efreet_Desktop_Change_Dir, 1);
+    if (!dir) return;
+    dir->mtime = ecore_file_mod_time(rp);
+    dir->files_mtime = efreet_desktop_changes_files_mtime(rp);
+    eina_hash_add(change_dirs, rp, dir);
+
+    efreet_desktop_changes_dirs_scan(rp);
+}
+
+static void
+efreet_desktop_changes_dirs_scan(const char *path)
+{
+    Eina_Iterator *it;
+    Eina_File_Direct_Info *info;
+
+    it = eina_file_direct_ls(path);
+    if (!it) return;
+    EINA_ITERATOR_FOREACH(it, info)
+    {
+        if (ecore_file_is_dir(info->path)) efreet_desktop_changes_dirs_add(info->path);
+    }
+    eina_iterator_free(it);
+}
+
+/**
+ * @internal
+ * @param path The directory to check
+ * @return Returns the newest mtime of the desktop files in @a path
+ */
+static long long
+efreet_desktop_changes_files_mtime(const char *path)
+{
+    Eina_Iterator *it;
+    Eina_File_Direct_Info *info;
+    long long newest = 0;
+
+    it = eina_file_direct_ls(path);
+    if (!it) return 0;
+    EINA_ITERATOR_FOREACH(it, info)
+    {
+        const char *ext;
+        long long mtime;
+
+        ext = strrchr(info->path + info->name_start, '.');
+        if (!ext || (strcmp(ext, ".desktop") && strcmp(ext, ".directory")))
+            continue;
+        mtime = ecore_file_mod_time(info->path);
+        if (mtime > newest) newest = mtime;
+    }
+    eina_iterator_free(it);
+    return newest;
+}
+
+static void
+efreet_desktop_changes_sweep_queue(void)
+{
+    if (change_sweep_timer)
+        ecore_timer_delay(change_sweep_timer, 0.5);
+    else
+        change_sweep_timer = ecore_timer_add(0.5, efreet_desktop_changes_sweep_cb, NULL);
+}
+
+/**
+ * @internal
+ * @brief Compares the recorded mtimes of the unmonitored directories and
+ * their desktop files with the current ones. This catches added, removed,
+ * renamed and edited files below the roots, and triggers a cache update if
+ * anything changed.
+ */
+static Eina_Bool
+efreet_desktop_changes_sweep_cb(void *data __UNUSED__)
+{
+    Eina_Iterator *it;
+    Eina_Hash_Tuple *tuple;
+    Eina_List *changed = NULL;
+    const char *path;
+    Eina_Bool edited = EINA_FALSE;
+
+    change_sweep_timer = NULL;
+    if (!change_dirs) return ECORE_CALLBACK_CANCEL;
+
+    it = eina_hash_iterator_tuple_new(change_dirs);
+    EINA_ITERATOR_FOREACH(it, tuple)
+    {
+        Efreet_Desktop_Change_Dir *dir;
+        long long mtime, files_mtime;
+
+        /* monitored dirs report their own changes */
+        if (eina_hash_find(change_monitors, tuple->key)) continue;
+        dir = tuple->data;
+        mtime = ecore_file_mod_time(tuple->key);
+        if (mtime != dir->mtime)
+        {
+            dir->mtime = mtime;
+            changed = eina_list_append(changed, eina_stringshare_add(tuple->key));
+        }
+        files_mtime = efreet_desktop_changes_files_mtime(tuple->key);
+        if (files_mtime != dir->files_mtime)
+        {
+            dir->files_mtime = files_mtime;
+            edited = EINA_TRUE;
+        }
+    }
+    eina_iterator_free(it);
+
+    if (!changed)
+    {
+        if (edited) efreet_cache_desktop_update();
+        return ECORE_CALLBACK_CANCEL;
+    }
+
+    EINA_LIST_FREE(changed, path)
+    {
+        if (ecore_file_is_dir(path))
+            efreet_desktop_changes_dirs_scan(path);
+        else
+            eina_hash_del_by_key(change_dirs, path);
+        eina_stringshare_del(path);
+    }
+    efreet_cache_desktop_update();
+    return ECORE_CALLBACK_CANCEL;
+}
+
+static Eina_Bool
+efreet_desktop_changes_poll_cb(void *data __UNUSED__)
+{
+    efreet_desktop_changes_sweep_queue();
+    return ECORE_CALLBACK_RENEW;
+}
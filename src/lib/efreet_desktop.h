@@ -28,7 +28,8 @@ EAPI extern int EFREET_DESKTOP_TYPE_DIRECTORY;
 /**
  * Event id for cache update. All users of efreet_desktop_get must listen to
  * this event and refetch. The old eet cache will be closed and mem will
- * be invalidated.
+ * be invalidated. If the event has changes set, only the removed and
+ * modified desktops have to be refetched.
  */
 EAPI extern int EFREET_EVENT_DESKTOP_CACHE_UPDATE;
 /**
@@ -121,7 +122,9 @@ struct _Efreet_Desktop
  * contents of @a file or NULL if @a file is not a valid .desktop file.
  *
  * By using efreet_desktop_get the Efreet_Desktop will be saved in an internal
- * cache for quicker loading.
+ * cache for quicker loading. Files outside the directories of the desktop
+ * cache are only kept in memory for the lifetime of the process, use
+ * efreet_desktop_dir_promote() to add their directory to the desktop cache.
  *
  * Users of this command should listen to EFREET_EVENT_DESKTOP_CACHE_UPDATE
  * event, if the application is to keep the reference. When the event fires
@@ -130,6 +133,16 @@ struct _Efreet_Desktop
  */
 EAPI Efreet_Desktop   *efreet_desktop_get(const char *file);
 
+/**
+ * @param dir The directory to add
+ * @return Returns EINA_TRUE if the directory was queued, EINA_FALSE if it
+ * doesn't exist
+ * @brief Adds @a dir to the directories scanned by the desktop cache. The
+ * cache is rebuilt in the background and keeps the directory from then on.
+ * @since 1.7
+ */
+EAPI Eina_Bool         efreet_desktop_dir_promote(const char *dir);
+
 /**
  * @param desktop The Efreet_Desktop to ref
  * @return Returns the new reference count
@@ -262,6 +275,77 @@ EAPI void              *efreet_desktop_command_get(Efreet_Desktop *desktop,
 EAPI Eina_List *      efreet_desktop_command_local_get(Efreet_Desktop *desktop,
                                          Eina_List *files);
 
+/**
+ * @param desktop the desktop entry
+ * @param files an eina list of local files, as absolute paths, local paths, or file// uris (or NULL to get the arguments with no files appended)
+ * @return Returns an eina list of NULL terminated argument vectors
+ * @brief Get the arguments to use to execute a desktop entry without a shell
+ *
+ * The Exec string is split following its quoting rules. A field code making
+ * up a whole argument expands to one argument per value, so file names are
+ * never split or quoted. The returned list and each of its elements must be
+ * freed, each vector is a single allocation.
+ * @since 1.7
+ */
+EAPI Eina_List *      efreet_desktop_command_argv_get(Efreet_Desktop *desktop,
+                                         Eina_List *files);
+
+/**
+ * @param desktop the desktop entry
+ * @param files an eina list of local files, as absolute paths, local paths, or file// uris
+ * @return Returns EINA_TRUE if every command was launched
+ * @brief Launches a desktop entry with posix_spawn, using the arguments
+ * from efreet_desktop_command_argv_get(), without going through a shell.
+ * Falls back to efreet_desktop_exec() where posix_spawn isn't available.
+ * @since 1.7
+ */
+EAPI Eina_Bool         efreet_desktop_exec_argv(Efreet_Desktop *desktop,
+                                                Eina_List *files);
+
+
+/**
+ * @param lazy EINA_TRUE to defer decoding of seldom used fields
+ * @brief Sets whether desktops read from the cache decode their categories,
+ * mime types and X- fields on first use rather than on load
+ *
+ * When enabled, the categories, mime_types and x members of a cached
+ * desktop may be NULL until one of efreet_desktop_categories_get(),
+ * efreet_desktop_mime_types_get() or the category and X- field functions
+ * has been called for it. Off by default.
+ * @since 1.7
+ */
+EAPI void              efreet_desktop_lazy_fields_set(Eina_Bool lazy);
+
+/**
+ * @param compact EINA_TRUE to keep seldom used fields in compact form
+ * @brief Sets whether desktops read from the cache keep their categories,
+ * mime types and X- fields as arrays pointing into the cache file
+ *
+ * When enabled, the categories, mime_types and x members of a cached
+ * desktop stay NULL and efreet_desktop_x_field_get() and
+ * efreet_desktop_category_count_get() work on the arrays directly. The
+ * lists and the hash are only built when efreet_desktop_categories_get(),
+ * efreet_desktop_mime_types_get() or a function changing them is called.
+ * Off by default.
+ * @since 1.7
+ */
+EAPI void              efreet_desktop_compact_set(Eina_Bool compact);
+
+/**
+ * @param desktop The desktop to work with
+ * @return Returns the list of categories of this desktop, owned by the desktop
+ * @brief Retrieves the categories the given @a desktop belongs to
+ * @since 1.7
+ */
+EAPI Eina_List        *efreet_desktop_categories_get(Efreet_Desktop *desktop);
+
+/**
+ * @param desktop The desktop to work with
+ * @return Returns the list of mime types of this desktop, owned by the desktop
+ * @brief Retrieves the mime types the given @a desktop handles
+ * @since 1.7
+ */
+EAPI Eina_List        *efreet_desktop_mime_types_get(Efreet_Desktop *desktop);
 
 /**
  * @param desktop The desktop to work with
@@ -23,6 +23,11 @@ void *alloca (size_t);
 #include <unistd.h>
 #include <ctype.h>
 
+#ifdef HAVE_SPAWN_H
+# include <spawn.h>
+extern char **environ;
+#endif
+
 #ifdef _WIN32
 # include <winsock2.h>
 #endif
@@ -63,6 +68,8 @@ struct Efreet_Desktop_Command
   int num_pending;
 
   Efreet_Desktop_Command_Flag flags;
+  const char *tmpl;  /**< Compiled Exec, see efreet_desktop_exec_compile() */
+  char *tmpl_alloc;  /**< tmpl when it doesn't come from the desktop cache */
 
   Efreet_Desktop_Command_Cb cb_command;
   Efreet_Desktop_Progress_Cb cb_progress;
@@ -96,21 +103,35 @@ static int efreet_desktop_command_file_id = 0;
 
 static void *efreet_desktop_exec_cb(void *data, Efreet_Desktop *desktop,
                                             char *exec, int remaining);
-static int efreet_desktop_command_flags_get(Efreet_Desktop *desktop);
+static int efreet_desktop_command_template_get(Efreet_Desktop_Command *command);
 static void *efreet_desktop_command_execs_process(Efreet_Desktop_Command *command, Eina_List *execs);
 
+static Efreet_Desktop_Command *efreet_desktop_command_local_new(Efreet_Desktop *desktop,
+                                                                Eina_List *files);
 static Eina_List *efreet_desktop_command_build(Efreet_Desktop_Command *command);
+static Eina_List *efreet_desktop_command_argv_build(Efreet_Desktop_Command *command);
+static char **efreet_desktop_command_argv_split(Efreet_Desktop_Command *command,
+                                                Efreet_Desktop_Command_File *file,
+                                                int *file_added);
+static Eina_Bool efreet_desktop_command_argv_field(Efreet_Desktop_Command *command,
+                                                   Efreet_Desktop_Command_File *file,
+                                                   char type, Eina_Bool inside,
+                                                   Eina_Strbuf *word, Eina_List **args,
+                                                   int *file_added);
 static void efreet_desktop_command_free(Efreet_Desktop_Command *command);
-static char *efreet_desktop_command_append_quoted(char *dest, int *size,
-                                                    int *len, char *src);
-static char *efreet_desktop_command_append_multiple(char *dest, int *size, int *len,
-                                                    Efreet_Desktop_Command *command,
-                                                    char type);
-static char *efreet_desktop_command_append_single(char *dest, int *size, int *len,
+static int efreet_desktop_command_expand(Efreet_Desktop_Command *command,
+                                         Efreet_Desktop_Command_File *file,
+                                         char *dest, int *file_added);
+static int efreet_desktop_command_append_quoted(char *dest, const char *src);
+static int efreet_desktop_command_append_multiple(char *dest,
+                                                  Efreet_Desktop_Command *command,
+                                                  char type);
+static int efreet_desktop_command_append_single(char *dest,
                                                 Efreet_Desktop_Command_File *file,
                                                 char type);
-static char *efreet_desktop_command_append_icon(char *dest, int *size, int *len,
-                                                Efreet_Desktop *desktop);
+static const char *efreet_desktop_command_file_field(Efreet_Desktop_Command_File *file,
+                                                     char type);
+static int efreet_desktop_command_append_icon(char *dest, Efreet_Desktop *desktop);
 
 static Efreet_Desktop_Command_File *efreet_desktop_command_file_process(
                                                     Efreet_Desktop_Command *command,
@@ -128,8 +149,6 @@ static char *efreet_desktop_command_path_absolute(const char *path);
 
 static char *efreet_string_append(char *dest, int *size,
                                     int *len, const char *src);
-static char *efreet_string_append_char(char *dest, int *size,
-                                        int *len, char c);
 
 
 EAPI void
@@ -149,18 +168,94 @@ EAPI Eina_List *
 efreet_desktop_command_local_get(Efreet_Desktop *desktop, Eina_List *files)
 {
     Efreet_Desktop_Command *command;
-    char *file;
-    Eina_List *execs, *l;
+    Eina_List *execs;
+
+    EINA_SAFETY_ON_NULL_RETURN_VAL(desktop, NULL);
+    EINA_SAFETY_ON_NULL_RETURN_VAL(desktop->exec, NULL);
+
+    command = efreet_desktop_command_local_new(desktop, files);
+    if (!command) return NULL;
+
+    execs = efreet_desktop_command_build(command);
+    efreet_desktop_command_free(command);
+
+    return execs;
+}
+
+EAPI Eina_List *
+efreet_desktop_command_argv_get(Efreet_Desktop *desktop, Eina_List *files)
+{
+    Efreet_Desktop_Command *command;
+    Eina_List *argvs;
 
     EINA_SAFETY_ON_NULL_RETURN_VAL(desktop, NULL);
     EINA_SAFETY_ON_NULL_RETURN_VAL(desktop->exec, NULL);
 
+    command = efreet_desktop_command_local_new(desktop, files);
+    if (!command) return NULL;
+
+    argvs = efreet_desktop_command_argv_build(command);
+    efreet_desktop_command_free(command);
+
+    return argvs;
+}
+
+EAPI Eina_Bool
+efreet_desktop_exec_argv(Efreet_Desktop *desktop, Eina_List *files)
+{
+#ifdef HAVE_SPAWN_H
+    Eina_List *argvs;
+    char **argv;
+    Eina_Bool ret = EINA_TRUE;
+
+    argvs = efreet_desktop_command_argv_get(desktop, files);
+    if (!argvs) return EINA_FALSE;
+
+    /* The children are reaped by ecore's SIGCHLD handler */
+    EINA_LIST_FREE(argvs, argv)
+    {
+        pid_t pid;
+
+        if (posix_spawnp(&pid, argv[0], NULL, NULL, argv, environ) != 0)
+        {
+            ERR("Could not launch %s", argv[0]);
+            ret = EINA_FALSE;
+        }
+        free(argv);
+    }
+    return ret;
+#else
+    EINA_SAFETY_ON_NULL_RETURN_VAL(desktop, EINA_FALSE);
+    EINA_SAFETY_ON_NULL_RETURN_VAL(desktop->exec, EINA_FALSE);
+
+    efreet_desktop_exec(desktop, files, NULL);
+    return EINA_TRUE;
+#endif
+}
+
+/**
+ * @internal
+ * @param desktop the desktop to create the command for
+ * @param files the files to pass, remote files are skipped
+ * @return Returns a command for local files only
+ */
+static Efreet_Desktop_Command *
+efreet_desktop_command_local_new(Efreet_Desktop *desktop, Eina_List *files)
+{
+    Efreet_Desktop_Command *command;
+    char *file;
+    Eina_List *l;
+
     command = NEW(Efreet_Desktop_Command, 1);
-    if (!command) return 0;
+    if (!command) return NULL;
 
     command->desktop = desktop;
 
-    command->flags = efreet_desktop_command_flags_get(desktop);
+    if (!efreet_desktop_command_template_get(command))
+    {
+        efreet_desktop_command_free(command);
+        return NULL;
+    }
     /* get the required info for each file passed in */
     if (files)
     {
@@ -179,10 +274,7 @@ efreet_desktop_command_local_get(Efreet_Desktop *desktop, Eina_List *files)
         }
     }
 
-    execs = efreet_desktop_command_build(command);
-    efreet_desktop_command_free(command);
-
-    return execs;
+    return command;
 }
 
 EAPI void *
@@ -208,7 +300,11 @@ efreet_desktop_command_progress_get(Efreet_Desktop *desktop, Eina_List *files,
     command->data = data;
     command->desktop = desktop;
 
-    command->flags = efreet_desktop_command_flags_get(desktop);
+    if (!efreet_desktop_command_template_get(command))
+    {
+        efreet_desktop_command_free(command);
+        return NULL;
+    }
     /* get the required info for each file passed in */
     if (files)
     {
@@ -251,41 +347,101 @@ efreet_desktop_exec_cb(void *data,
     return NULL;
 }
 
-/**
- * @internal
- *
- * @brief Determine which file related field codes are present in the Exec string of a .desktop
- * @params desktop and Efreet Desktop
- * @return a bitmask of file field codes present in exec string
+/*
+ * Needs EAPI because of helper binaries
  */
-static int
-efreet_desktop_command_flags_get(Efreet_Desktop *desktop)
+EAPI char *
+efreet_desktop_exec_compile(const char *exec, const char *path, int *flags)
 {
-    int flags = 0;
+    char *tmpl;
     const char *p;
-    /* first, determine which fields are present in the Exec string */
-    p = strchr(desktop->exec, '%');
-    while (p)
+    int len = 0;
+
+    *flags = 0;
+    /* A field code keeps its length, so the template is never longer
+     * than the Exec string */
+    tmpl = malloc(strlen(exec) + 1);
+    if (!tmpl) return NULL;
+
+    for (p = exec; *p; p++)
     {
+        if (*p != '%')
+        {
+            if (*p != EFREET_EXEC_OP) tmpl[len++] = *p;
+            continue;
+        }
+
+        /* XXX handle fields inside quotes? */
         p++;
-        switch(*p)
+        switch (*p)
         {
             case 'f':
             case 'F':
-                flags |= EFREET_DESKTOP_EXEC_FLAG_FULLPATH;
+                *flags |= EFREET_DESKTOP_EXEC_FLAG_FULLPATH;
+                tmpl[len++] = EFREET_EXEC_OP;
+                tmpl[len++] = *p;
                 break;
             case 'u':
             case 'U':
-                flags |= EFREET_DESKTOP_EXEC_FLAG_URI;
+                *flags |= EFREET_DESKTOP_EXEC_FLAG_URI;
+                tmpl[len++] = EFREET_EXEC_OP;
+                tmpl[len++] = *p;
+                break;
+            case 'd':
+            case 'D':
+            case 'n':
+            case 'N':
+            case 'i':
+            case 'c':
+            case 'k':
+                tmpl[len++] = EFREET_EXEC_OP;
+                tmpl[len++] = *p;
+                break;
+            case 'v':
+            case 'm':
+                WRN("[Efreet]: Deprecated conversion char: '%c' in file '%s'",
+                        *p, path);
                 break;
             case '%':
-                p++;
+                tmpl[len++] = '%';
+                break;
+            case '\0':
+                /* Trailing '%' */
+                p--;
                 break;
             default:
+#ifdef STRICT_SPEC
+                WRN("[Efreet_desktop]: Unknown conversion character: '%c'", *p);
+#endif
                 break;
         }
+    }
+    tmpl[len] = '\0';
+
+    return tmpl;
+}
+
+/**
+ * @internal
+ *
+ * @brief Get the compiled Exec template of the desktop, and the file field
+ * codes present in it
+ * @param command The command to get the template for
+ * @return 1 on success, 0 on failure
+ */
+static int
+efreet_desktop_command_template_get(Efreet_Desktop_Command *command)
+{
+    int flags = 0;
 
-        p = strchr(p, '%');
+    command->tmpl = efreet_cache_desktop_exec_template(command->desktop, &flags);
+    if (!command->tmpl)
+    {
+        command->tmpl_alloc = efreet_desktop_exec_compile(command->desktop->exec,
+                                                          command->desktop->orig_path,
+                                                          &flags);
+        if (!command->tmpl_alloc) return 0;
+        command->tmpl = command->tmpl_alloc;
     }
 #ifdef SLOPPY_SPEC
     /* NON-SPEC!!! this is to work around LOTS of 'broken' .desktop files that
@@ -295,8 +451,9 @@ efreet_desktop_command_flags_get(Efreet_Desktop *desktop)
      */
     if (!flags) flags |= EFREET_DESKTOP_EXEC_FLAG_FULLPATH;
 #endif
+    command->flags = flags;
 
-    return flags;
+    return 1;
 }
 
 
@@ -325,8 +482,8 @@ efreet_desktop_command_execs_process(Efreet_Desktop_Command *command, Eina_List
 
 
 /**
- * @brief Builds the actual exec string from the raw string and a list of
- * processed filename information. The callback passed in to
+ * @brief Builds the actual exec string from the compiled template and a list
+ * of processed filename information. The callback passed in to
  * efreet_desktop_command_get is called for each exec string created.
  *
  * @param command the command to build
@@ -346,101 +503,111 @@ efreet_desktop_command_build(Efreet_Desktop_Command *command)
     l = command->files;
     do
     {
-        const char *p;
-        int len = 0;
-        int size = PATH_MAX;
+        int len;
         int file_added = 0;
         Efreet_Desktop_Command_File *file = eina_list_data_get(l);
 
-        exec = malloc(size);
+        /* Measure first, so the command is a single allocation */
+        len = efreet_desktop_command_expand(command, file, NULL, &file_added);
+        exec = malloc(len + 1);
         if (!exec) goto error;
-        p = command->desktop->exec;
-        len = 0;
+        efreet_desktop_command_expand(command, file, exec, &file_added);
+        exec[len] = '\0';
 
-        while (*p)
-        {
-            if (len >= size - 1)
-            {
-                char *tmp;
+        execs = eina_list_append(execs, exec);
+        exec = NULL;
 
-                size = len + 1024;
-                tmp = realloc(exec, size);
-                if (!tmp) goto error;
-                exec = tmp;
-            }
+        /* If no file was added, then the Exec field doesn't contain any file
+         * fields (fFuUdDnN). We only want to run the app once in this case. */
+        if (!file_added) break;
+    }
+    while ((l = eina_list_next(l)));
 
-            /* XXX handle fields inside quotes? */
-            if (*p == '%')
-            {
-                p++;
-                switch (*p)
+    return execs;
+error:
+    EINA_LIST_FREE(execs, exec)
+        free(exec);
+    return NULL;
+}
+
+/**
+ * @internal
+ * @param command the command to expand
+ * @param file the file to expand single file fields with, or NULL
+ * @param dest the buffer to write to, or NULL to only measure
+ * @param file_added set to 1 if a file field was expanded
+ * @return the length of the expanded command
+ * @brief Walks the compiled template of @a command
+ */
+static int
+efreet_desktop_command_expand(Efreet_Desktop_Command *command,
+                              Efreet_Desktop_Command_File *file,
+                              char *dest, int *file_added)
+{
+    const char *p;
+    int len = 0;
+
+    *file_added = 0;
+    for (p = command->tmpl; *p; p++)
+    {
+        if (*p != EFREET_EXEC_OP)
+        {
+            if (dest) dest[len] = *p;
+            len++;
+            continue;
+        }
+
+        p++;
+        switch (*p)
+        {
+            case 'f':
+            case 'u':
+            case 'd':
+            case 'n':
+                if (file)
                 {
-                    case 'f':
-                    case 'u':
-                    case 'd':
-                    case 'n':
-                        if (file)
-                        {
-                            exec = efreet_desktop_command_append_single(exec, &size,
-                                    &len, file, *p);
-                            if (!exec) goto error;
-                            file_added = 1;
-                        }
-                        break;
-                    case 'F':
-                    case 'U':
-                    case 'D':
-                    case 'N':
-                        if (file)
-                        {
-                            exec = efreet_desktop_command_append_multiple(exec, &size,
-                                    &len, command, *p);
-                            if (!exec) goto error;
-                            file_added = 1;
-                        }
-                        break;
-                    case 'i':
-                        exec = efreet_desktop_command_append_icon(exec, &size, &len,
-                                command->desktop);
-                        if (!exec) goto error;
-                        break;
-                    case 'c':
-                        exec = efreet_desktop_command_append_quoted(exec, &size, &len,
-                                command->desktop->name);
-                        if (!exec) goto error;
-                        break;
-                    case 'k':
-                        exec = efreet_desktop_command_append_quoted(exec, &size, &len,
-                                command->desktop->orig_path);
-                        if (!exec) goto error;
-                        break;
-                    case 'v':
-                    case 'm':
-                        WRN("[Efreet]: Deprecated conversion char: '%c' in file '%s'",
-                                *p, command->desktop->orig_path);
-                        break;
-                    case '%':
-                        exec[len++] = *p;
-                        break;
-                    default:
-#ifdef STRICT_SPEC
-                        WRN("[Efreet_desktop]: Unknown conversion character: '%c'", *p);
-#endif
-                        break;
+                    len += efreet_desktop_command_append_single(dest ? dest + len : NULL,
+                                                                file, *p);
+                    *file_added = 1;
                 }
-            }
-            else exec[len++] = *p;
-            p++;
+                break;
+            case 'F':
+            case 'U':
+            case 'D':
+            case 'N':
+                if (file)
+                {
+                    len += efreet_desktop_command_append_multiple(dest ? dest + len : NULL,
+                                                                  command, *p);
+                    *file_added = 1;
+                }
+                break;
+            case 'i':
+                len += efreet_desktop_command_append_icon(dest ? dest + len : NULL,
+                                                          command->desktop);
+                break;
+            case 'c':
+                len += efreet_desktop_command_append_quoted(dest ? dest + len : NULL,
+                                                            command->desktop->name);
+                break;
+            case 'k':
+                len += efreet_desktop_command_append_quoted(dest ? dest + len : NULL,
+                                                            command->desktop->orig_path);
+                break;
+            default:
+                break;
         }
+    }
 
 #ifdef SLOPPY_SPEC
-        /* NON-SPEC!!! this is to work around LOTS of 'broken' .desktop files that
-         * do not specify %U/%u, %F/F etc. etc. at all. just a command. this is
-         * unlikely to be fixed in distributions etc. in the long run as gnome/kde
-         * seem to have workarounds too so no one notices.
-         */
-        if ((file) && (!file_added))
-        {
+    /* NON-SPEC!!! this is to work around LOTS of 'broken' .desktop files that
+     * do not specify %U/%u, %F/F etc. etc. at all. just a command. this is
+     * unlikely to be fixed in distributions etc. in the long run as gnome/kde
+     * seem to have workarounds too so no one notices.
+     */
+    if ((file) && (!*file_added))
+    {
+        if (!dest)
             WRN("Efreet_desktop: %s\n"
                 "  command: %s\n"
                 "  has no file path/uri spec info for executing this app WITH a\n"
@@ -448,40 +615,240 @@ efreet_desktop_command_build(Efreet_Desktop_Command *command)
                 "  please check the .desktop file and fix it by adding a %%U or %%F\n"
                 "  or something appropriate.",
                 command->desktop->orig_path, command->desktop->exec);
-            if (len >= size - 1)
+        if (dest) dest[len] = ' ';
+        len++;
+        len += efreet_desktop_command_append_multiple(dest ? dest + len : NULL,
+                                                      command, 'F');
+        *file_added = 1;
+    }
+#endif
+
+    return len;
+}
+
+/**
+ * @brief Builds argument vectors from the compiled template and a list of
+ * processed filename information, the same way efreet_desktop_command_build()
+ * builds strings.
+ *
+ * @param command the command to build
+ * @return a list of NULL terminated argument vectors
+ */
+static Eina_List *
+efreet_desktop_command_argv_build(Efreet_Desktop_Command *command)
+{
+    Eina_List *argvs = NULL;
+    const Eina_List *l;
+    char **argv;
+
+    l = command->files;
+    do
+    {
+        int file_added = 0;
+
+        argv = efreet_desktop_command_argv_split(command, eina_list_data_get(l),
+                                                 &file_added);
+        if (!argv) goto error;
+        argvs = eina_list_append(argvs, argv);
+
+        if (!file_added) break;
+    }
+    while ((l = eina_list_next(l)));
+
+    return argvs;
+error:
+    EINA_LIST_FREE(argvs, argv)
+        free(argv);
+    return NULL;
+}
+
+/**
+ * @internal
+ * @param command the command to split
+ * @param file the file to expand single file fields with, or NULL
+ * @param file_added set to 1 if a file field was expanded
+ * @return a NULL terminated argument vector, allocated as one block
+ * @brief Splits the compiled template of @a command into arguments following
+ * the quoting rules of the Exec key, and expands the field codes. A field
+ * code which makes up a whole argument expands to whole arguments.
+ */
+static char **
+efreet_desktop_command_argv_split(Efreet_Desktop_Command *command,
+                                  Efreet_Desktop_Command_File *file,
+                                  int *file_added)
+{
+    Eina_Strbuf *word;
+    Eina_List *args = NULL, *l;
+    const char *p;
+    char **argv, *arg, *pos;
+    size_t size;
+    int n = 0;
+    Eina_Bool in_word = EINA_FALSE, quoted = EINA_FALSE;
+
+    word = eina_strbuf_new();
+    if (!word) return NULL;
+
+    *file_added = 0;
+    for (p = command->tmpl; *p; p++)
+    {
+        if (*p == EFREET_EXEC_OP)
+        {
+            p++;
+            if (efreet_desktop_command_argv_field(command, file, *p, in_word,
+                                                  word, &args, file_added))
+                in_word = EINA_TRUE;
+        }
+        else if (quoted)
+        {
+            if (*p == '"')
+                quoted = EINA_FALSE;
+            else if ((*p == '\\') && p[1] && strchr("\"`$\\", p[1]))
+                eina_strbuf_append_char(word, *(++p));
+            else
+                eina_strbuf_append_char(word, *p);
+        }
+        else if ((*p == ' ') || (*p == '\t'))
+        {
+            if (in_word)
             {
-                char *tmp;
-                size = len + 1024;
-                tmp = realloc(exec, size);
-                if (!tmp) goto error;
-                exec = tmp;
+                args = eina_list_append(args, strdup(eina_strbuf_string_get(word)));
+                eina_strbuf_reset(word);
+                in_word = EINA_FALSE;
             }
-            exec[len++] = ' ';
-            exec = efreet_desktop_command_append_multiple(exec, &size,
-                    &len, command, 'F');
-            if (!exec) goto error;
-            file_added = 1;
         }
+        else
+        {
+            if (*p == '"')
+                quoted = EINA_TRUE;
+            else if ((*p == '\\') && p[1])
+                eina_strbuf_append_char(word, *(++p));
+            else
+                eina_strbuf_append_char(word, *p);
+            in_word = EINA_TRUE;
+        }
+    }
+    if (in_word)
+        args = eina_list_append(args, strdup(eina_strbuf_string_get(word)));
+    eina_strbuf_free(word);
+
+#ifdef SLOPPY_SPEC
+    /* NON-SPEC!!! See efreet_desktop_command_expand() */
+    if ((file) && (!*file_added))
+    {
+        efreet_desktop_command_argv_field(command, file, 'F', EINA_FALSE,
+                                          NULL, &args, file_added);
+    }
 #endif
-        exec[len++] = '\0';
 
-        execs = eina_list_append(execs, exec);
-        exec = NULL;
+    /* Pack the vector and the strings in one block, so it's freed with free() */
+    size = sizeof(char *);
+    EINA_LIST_FOREACH(args, l, arg)
+    {
+        if (!arg) goto error;
+        size += sizeof(char *) + strlen(arg) + 1;
+        n++;
+    }
+    if (n == 0) goto error;
+    argv = malloc(size);
+    if (!argv) goto error;
 
-        /* If no file was added, then the Exec field doesn't contain any file
-         * fields (fFuUdDnN). We only want to run the app once in this case. */
-        if (!file_added) break;
+    pos = (char *)(argv + n + 1);
+    n = 0;
+    EINA_LIST_FREE(args, arg)
+    {
+        size_t len;
+
+        len = strlen(arg) + 1;
+        memcpy(pos, arg, len);
+        argv[n++] = pos;
+        pos += len;
+        free(arg);
     }
-    while ((l = eina_list_next(l)));
+    argv[n] = NULL;
 
-    return execs;
+    return argv;
 error:
-    IF_FREE(exec);
-    EINA_LIST_FREE(execs, exec)
-        free(exec);
+    EINA_LIST_FREE(args, arg)
+        free(arg);
     return NULL;
 }
 
+/**
+ * @internal
+ * @return EINA_TRUE if something was appended to @a word
+ * @brief Expands the field code @a type for efreet_desktop_command_argv_split().
+ * If @a inside is EINA_FALSE, list fields and %i add whole arguments to @a args,
+ * otherwise all fields are appended to @a word.
+ */
+static Eina_Bool
+efreet_desktop_command_argv_field(Efreet_Desktop_Command *command,
+                                  Efreet_Desktop_Command_File *file,
+                                  char type, Eina_Bool inside,
+                                  Eina_Strbuf *word, Eina_List **args,
+                                  int *file_added)
+{
+    Efreet_Desktop_Command_File *dcf;
+    Eina_List *l;
+    const char *str = NULL;
+    Eina_Bool appended = EINA_FALSE;
+
+    switch (type)
+    {
+        case 'f':
+        case 'u':
+        case 'd':
+        case 'n':
+            if (!file) return EINA_FALSE;
+            *file_added = 1;
+            str = efreet_desktop_command_file_field(file, type);
+            break;
+        case 'F':
+        case 'U':
+        case 'D':
+        case 'N':
+            if (!file) return EINA_FALSE;
+            *file_added = 1;
+            EINA_LIST_FOREACH(command->files, l, dcf)
+            {
+                str = efreet_desktop_command_file_field(dcf, tolower(type));
+                if (!str) continue;
+                if (inside)
+                {
+                    if (appended) eina_strbuf_append_char(word, ' ');
+                    eina_strbuf_append(word, str);
+                    appended = EINA_TRUE;
+                }
+                else
+                    *args = eina_list_append(*args, strdup(str));
+            }
+            return appended;
+        case 'i':
+            str = command->desktop->icon;
+            if (!str || !str[0]) return EINA_FALSE;
+            if (inside)
+            {
+                eina_strbuf_append(word, "--icon ");
+                eina_strbuf_append(word, str);
+                return EINA_TRUE;
+            }
+            *args = eina_list_append(*args, strdup("--icon"));
+            *args = eina_list_append(*args, strdup(str));
+            return EINA_FALSE;
+        case 'c':
+            str = command->desktop->name;
+            break;
+        case 'k':
+            str = command->desktop->orig_path;
+            break;
+        default:
+            break;
+    }
+
+    if (!str) return EINA_FALSE;
+    eina_strbuf_append(word, str);
+    return EINA_TRUE;
+}
+
 static void
 efreet_desktop_command_free(Efreet_Desktop_Command *command)
 {
@@ -496,56 +863,52 @@ efreet_desktop_command_free(Efreet_Desktop_Command *command)
         command->files = eina_list_remove_list(command->files,
                                                command->files);
     }
+    IF_FREE(command->tmpl_alloc);
     FREE(command);
 }
 
-static char *
-efreet_desktop_command_append_quoted(char *dest, int *size, int *len, char *src)
+/*
+ * The append functions write to dest if it isn't NULL, and return the
+ * number of chars they write
+ */
+static int
+efreet_desktop_command_append_quoted(char *dest, const char *src)
 {
-    if (!src) return dest;
-    dest = efreet_string_append(dest, size, len, "'");
-    if (!dest) return NULL;
+    int len = 0;
+
+    if (!src) return 0;
+    if (dest) dest[len] = '\'';
+    len++;
 
     /* single quotes in src need to be escaped */
-    if (strchr(src, '\''))
+    for (; *src; src++)
     {
-        char *p;
-        p = src;
-        while (*p)
+        if (*src == '\'')
         {
-            if (*p == '\'')
-            {
-                dest = efreet_string_append(dest, size, len, "\'\\\'");
-                if (!dest) return NULL;
-            }
-
-            dest = efreet_string_append_char(dest, size, len, *p);
-            if (!dest) return NULL;
-            p++;
+            if (dest) memcpy(dest + len, "\'\\\'", 3);
+            len += 3;
         }
-    }
-    else
-    {
-        dest = efreet_string_append(dest, size, len, src);
-        if (!dest) return NULL;
+        if (dest) dest[len] = *src;
+        len++;
     }
 
-    dest = efreet_string_append(dest, size, len, "'");
-    if (!dest) return NULL;
+    if (dest) dest[len] = '\'';
+    len++;
 
-    return dest;
+    return len;
 }
 
-static char *
-efreet_desktop_command_append_multiple(char *dest, int *size, int *len,
-                                        Efreet_Desktop_Command *command,
-                                        char type)
+static int
+efreet_desktop_command_append_multiple(char *dest,
+                                       Efreet_Desktop_Command *command,
+                                       char type)
 {
     Efreet_Desktop_Command_File *file;
     Eina_List *l;
+    int len = 0;
     int first = 1;
 
-    if (!command->files) return dest;
+    if (!command->files) return 0;
 
     EINA_LIST_FOREACH(command->files, l, file)
     {
@@ -553,22 +916,28 @@ efreet_desktop_command_append_multiple(char *dest, int *size, int *len,
             first = 0;
         else
         {
-            dest = efreet_string_append_char(dest, size, len, ' ');
-            if (!dest) return NULL;
+            if (dest) dest[len] = ' ';
+            len++;
         }
 
-        dest = efreet_desktop_command_append_single(dest, size, len,
+        len += efreet_desktop_command_append_single(dest ? dest + len : NULL,
                                                     file, tolower(type));
-        if (!dest) return NULL;
     }
 
-    return dest;
+    return len;
 }
 
-static char *
-efreet_desktop_command_append_single(char *dest, int *size, int *len,
-                                        Efreet_Desktop_Command_File *file,
-                                        char type)
+static int
+efreet_desktop_command_append_single(char *dest,
+                                     Efreet_Desktop_Command_File *file,
+                                     char type)
+{
+    return efreet_desktop_command_append_quoted(dest,
+                efreet_desktop_command_file_field(file, type));
+}
+
+static const char *
+efreet_desktop_command_file_field(Efreet_Desktop_Command_File *file, char type)
 {
     char *str;
     switch(type)
@@ -586,31 +955,27 @@ efreet_desktop_command_append_single(char *dest, int *size, int *len,
             str = file->file;
             break;
         default:
-            ERR("Invalid type passed to efreet_desktop_command_append_single:"
+            ERR("Invalid type passed to efreet_desktop_command_file_field:"
                                                                 " '%c'", type);
-            return dest;
+            return NULL;
     }
 
-    if (!str) return dest;
-
-    dest = efreet_desktop_command_append_quoted(dest, size, len, str);
-    if (!dest) return NULL;
-
-    return dest;
+    return str;
 }
 
-static char *
-efreet_desktop_command_append_icon(char *dest, int *size, int *len,
-                                            Efreet_Desktop *desktop)
+static int
+efreet_desktop_command_append_icon(char *dest, Efreet_Desktop *desktop)
 {
-    if (!desktop->icon || !desktop->icon[0]) return dest;
+    int len;
 
-    dest = efreet_string_append(dest, size, len, "--icon ");
-    if (!dest) return NULL;
-    dest = efreet_desktop_command_append_quoted(dest, size, len, desktop->icon);
-    if (!dest) return NULL;
+    if (!desktop->icon || !desktop->icon[0]) return 0;
 
-    return dest;
+    len = strlen("--icon ");
+    if (dest) memcpy(dest, "--icon ", len);
+    len += efreet_desktop_command_append_quoted(dest ? dest + len : NULL,
+                                                desktop->icon);
+
+    return len;
 }
 
 /**
@@ -887,26 +1252,3 @@ efreet_string_append(char *dest, int *size, int *len, const char *src)
 
     return dest;
 }
-
-static char *
-efreet_string_append_char(char *dest, int *size, int *len, char c)
-{
-    if (*len >= *size - 1)
-    {
-        char *tmp;
-        *size += 1024;
-        tmp = realloc(dest, *size);
-        if (!tmp)
-        {
-            free(dest);
-            return NULL;
-        }
-        dest = tmp;
-    }
-
-    dest[(*len)++] = c;
-    dest[*len] = '\0';
-
-    return dest;
-}
-
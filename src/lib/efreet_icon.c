@@ -59,8 +59,8 @@ static const char *efreet_icon_lookup_path_path(Efreet_Cache_Icon_Element *elem,
 static const char *efreet_icon_fallback_lookup_path(Efreet_Cache_Fallback_Icon *icon);
 static const char *efreet_icon_fallback_lookup_path_path(Efreet_Cache_Fallback_Icon *icon,
                                                                const char *path);
+static Eina_Bool efreet_icon_fallback_path_allowed(const char *path);
 
-static void efreet_icon_changes_listen(void);
 static void efreet_icon_changes_monitor_add(const char *path);
 static void efreet_icon_changes_cb(void *data, Ecore_File_Monitor *em,
                                    Ecore_File_Event event, const char *path);
@@ -186,6 +186,12 @@ efreet_icon_theme_list_get(void)
     return efreet_cache_icon_theme_list();
 }
 
+EAPI Eina_List *
+efreet_icon_theme_summary_list(void)
+{
+    return efreet_cache_icon_theme_summary_list();
+}
+
 EAPI Efreet_Icon_Theme *
 efreet_icon_theme_find(const char *theme_name)
 {
@@ -743,6 +749,7 @@ efreet_icon_fallback_lookup_path(Efreet_Cache_Fallback_Icon *icon)
 
         pp = strrchr(icon->icons[0], '.');
         if (!pp) return NULL;
+        if (!efreet_icon_fallback_path_allowed(icon->icons[0])) return NULL;
 
         EINA_LIST_FOREACH(efreet_icon_extensions, l, ext)
             if (!strcmp(pp, ext))
@@ -804,6 +811,7 @@ efreet_icon_fallback_lookup_path_path(Efreet_Cache_Fallback_Icon *icon, const ch
 
         pp = strrchr(icon->icons[i], '.');
         if (!pp) continue;
+        if (!efreet_icon_fallback_path_allowed(icon->icons[i])) continue;
 
         EINA_LIST_FOREACH(efreet_icon_extensions, ll, ext)
             if (!strcmp(pp, ext))
@@ -813,7 +821,44 @@ efreet_icon_fallback_lookup_path_path(Efreet_Cache_Fallback_Icon *icon, const ch
     return NULL;
 }
 
-static void
+/**
+ * @internal
+ * @param path The path of a fallback icon
+ * @return Returns EINA_TRUE if the icon may be used by this program
+ * @brief The fallback cache holds the icons of the extra dirs of every
+ * program which ran the cache builder. Icons from an extra dir are only
+ * used if this program added that dir too.
+ */
+static Eina_Bool
+efreet_icon_fallback_path_allowed(const char *path)
+{
+    Efreet_Cache_Array_String *dirs;
+    unsigned int i;
+
+    dirs = efreet_cache_icon_extra_dirs();
+    if (!dirs) return EINA_TRUE;
+
+    for (i = 0; i < dirs->array_count; i++)
+    {
+        size_t len;
+
+        len = strlen(dirs->array[i]);
+        if (strncmp(path, dirs->array[i], len) || (path[len] != '/')) continue;
+        return !!eina_list_search_unsorted_list(efreet_extra_icon_dirs,
+                                                EINA_COMPARE_CB(strcmp),
+                                                dirs->array[i]);
+    }
+    return EINA_TRUE;
+}
+
+/**
+ * @internal
+ * @return Returns no value
+ * @brief Watches the icon base dirs and their top level theme dirs. Changes
+ * further down are picked up by the directory mtime checks in the cache
+ * builder.
+ */
+void
 efreet_icon_changes_listen(void)
 {
     Eina_List *l;
@@ -821,7 +866,8 @@ efreet_icon_changes_listen(void)
     char buf[PATH_MAX];
     const char *dir;
 
-    if (!efreet_cache_update) return;
+    if (change_monitors) return;
+    if (!efreet_cache_watch_owner_get()) return;
 
     change_monitors = eina_hash_string_superfast_new(EINA_FREE_CB(ecore_file_monitor_del));
     if (!change_monitors) return;
@@ -68,6 +68,30 @@ struct Efreet_Icon_Theme
     Eina_List *directories;     /**< List of subdirectories for this theme */
 };
 
+/**
+ * Efreet_Icon_Theme_Summary
+ * @since 1.7
+ */
+typedef struct Efreet_Icon_Theme_Summary Efreet_Icon_Theme_Summary;
+
+/**
+ * Efreet_Icon_Theme_Summary
+ * @brief contains the information about a theme which is needed to present
+ * it to the user, without the directories needed for icon lookups
+ * @since 1.7
+ */
+struct Efreet_Icon_Theme_Summary
+{
+    struct
+    {
+        const char *internal;   /**< The internal theme name */
+        const char *name;       /**< The user visible name */
+    } name;                     /**< The different names for the theme */
+
+    const char *comment;        /**< String describing the theme */
+    const char *example_icon;   /**< Icon to use as an example of the theme */
+};
+
 /**
  * Efreet_Icon_Theme_Directory
  */
@@ -183,6 +207,16 @@ EAPI Eina_List         *efreet_icon_extensions_list_get(void);
  */
 EAPI Eina_List         *efreet_icon_theme_list_get(void);
 
+/**
+ * @return Returns a list of Efreet_Icon_Theme_Summary structs for all the
+ * icon themes
+ * @brief Retrieves the names, comments and example icons of all icon themes
+ * available on the system, without loading the themes themselves. The
+ * returned list must be freed. Do not free the list data.
+ * @since 1.7
+ */
+EAPI Eina_List         *efreet_icon_theme_summary_list(void);
+
 /**
  * @param theme_name The theme to look for
  * @return Returns the icon theme related to the given theme name or NULL if
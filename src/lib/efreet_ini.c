@@ -34,7 +34,8 @@ static int _efreet_ini_log_dom = -1;
 #include "Efreet.h"
 #include "efreet_private.h"
 
-static Eina_Hash *efreet_ini_parse(const char *file);
+static Eina_Hash *efreet_ini_parse(const char *file, Eina_Bool desktop);
+static Eina_Bool efreet_ini_locale_wanted(const char *key, const char **locales);
 static const char *efreet_ini_unescape(const char *str) EINA_ARG_NONNULL(1);
 static Eina_Bool
 efreet_ini_section_save(const Eina_Hash *hash, const void *key, void *data, void *fdata);
@@ -82,7 +83,29 @@ efreet_ini_new(const char *file)
     /* This can validly be NULL at the moment as _parse() will return NULL
      * if the input file doesn't exist. Should we change _parse() to create
      * the hash and only return NULL on failed parse? */
-    ini->data = efreet_ini_parse(file);
+    ini->data = efreet_ini_parse(file, EINA_FALSE);
+
+    return ini;
+}
+
+/**
+ * @internal
+ * @param file The .desktop file to parse
+ * @return Returns a new Efreet_Ini with the desktop entry of @a file
+ * @brief Parses only the [Desktop Entry] and [KDE Desktop Entry] sections of
+ * a .desktop file, and drops all translations which are not for the current
+ * locale. Desktop files often carry dozens of translations per key, and
+ * efreet_desktop_new() never looks at them.
+ */
+Efreet_Ini *
+efreet_ini_desktop_new(const char *file)
+{
+    Efreet_Ini *ini;
+
+    ini = NEW(Efreet_Ini, 1);
+    if (!ini) return NULL;
+
+    ini->data = efreet_ini_parse(file, EINA_TRUE);
 
     return ini;
 }
@@ -90,21 +113,64 @@ efreet_ini_new(const char *file)
 /**
  * @internal
  * @param file The file to parse
+ * @param desktop Only keep the desktop entry for the current locale
  * @return Returns an Eina_Hash with the contents of @a file, or NULL if the
  *         file fails to parse or if the file doesn't exist
  * @brief Parses the ini file @a file into an Eina_Hash
  */
 static Eina_Hash *
-efreet_ini_parse(const char *file)
+efreet_ini_parse(const char *file, Eina_Bool desktop)
 {
     const char *buffer, *line_start;
+    const char *locales[5] = { NULL, NULL, NULL, NULL, NULL };
     FILE *f;
     Eina_Hash *data, *section = NULL;
     struct stat file_stat;
     int line_length, left;
+    Eina_Bool skip = EINA_FALSE;
 
     if (!file) return NULL;
 
+    if (desktop)
+    {
+        const char *lang, *country, *modifier;
+        char *buf;
+        int maxlen = 3; /* _, @ and \0 */
+        int n = 0;
+
+        lang = efreet_lang_get();
+        country = efreet_lang_country_get();
+        modifier = efreet_lang_modifier_get();
+
+        if (lang)
+        {
+            maxlen += strlen(lang);
+            if (country) maxlen += strlen(country);
+            if (modifier) maxlen += strlen(modifier);
+
+            /* same order as efreet_ini_localestring_get() */
+            if (country && modifier)
+            {
+                buf = alloca(maxlen);
+                snprintf(buf, maxlen, "%s_%s@%s", lang, country, modifier);
+                locales[n++] = buf;
+            }
+            if (country)
+            {
+                buf = alloca(maxlen);
+                snprintf(buf, maxlen, "%s_%s", lang, country);
+                locales[n++] = buf;
+            }
+            if (modifier)
+            {
+                buf = alloca(maxlen);
+                snprintf(buf, maxlen, "%s@%s", lang, modifier);
+                locales[n++] = buf;
+            }
+            locales[n++] = lang;
+        }
+    }
+
     f = fopen(file, "rb");
     if (!f) return NULL;
 
@@ -177,6 +243,15 @@ efreet_ini_parse(const char *file)
                 memcpy((char*)header, line_start + 1, header_length - 1);
                 ((char*)header)[header_length - 1] = '\0';
 
+                if (desktop && strcmp(header, "Desktop Entry") &&
+                    strcmp(header, "KDE Desktop Entry"))
+                {
+                    /* actions and other groups aren't used by efreet */
+                    skip = EINA_TRUE;
+                    goto next_line;
+                }
+                skip = EINA_FALSE;
+
                 section = eina_hash_string_small_new(EINA_FREE_CB(eina_stringshare_del));
 
                 eina_hash_del_by_key(data, header);
@@ -194,6 +269,8 @@ efreet_ini_parse(const char *file)
             goto next_line;
         }
 
+        if (skip) goto next_line;
+
         if (!section)
         {
             INF("Invalid file (%s) (missing section)", file);
@@ -250,6 +327,9 @@ efreet_ini_parse(const char *file)
             memcpy(key, line_start, key_end);
             key[key_end] = '\0';
 
+            if (desktop && !efreet_ini_locale_wanted(key, locales))
+                goto next_line;
+
             memcpy(value, line_start + value_start,
                     value_end - value_start);
             value[value_end - value_start] = '\0';
@@ -284,6 +364,36 @@ error:
     return NULL;
 }
 
+/**
+ * @internal
+ * @param key The key to check
+ * @param locales NULL terminated list of the wanted locales
+ * @return Returns EINA_TRUE if @a key isn't localized, or localized for
+ *         one of @a locales
+ * @brief Checks if a Key[locale] entry is of interest
+ */
+static Eina_Bool
+efreet_ini_locale_wanted(const char *key, const char **locales)
+{
+    const char *start, *end;
+    size_t len;
+    int i;
+
+    start = strchr(key, '[');
+    if (!start) return EINA_TRUE;
+    start++;
+    end = strchr(start, ']');
+    if (!end) return EINA_TRUE;
+
+    len = end - start;
+    for (i = 0; locales[i]; i++)
+    {
+        if ((strlen(locales[i]) == len) && !strncmp(start, locales[i], len))
+            return EINA_TRUE;
+    }
+    return EINA_FALSE;
+}
+
 EAPI void
 efreet_ini_free(Efreet_Ini *ini)
 {
@@ -20,6 +20,7 @@ extern "C"
 void *alloca (size_t);
 #endif
 
+#include <Ecore.h>
 #include <Ecore_File.h>
 
 /* define macros and variable for using the eina logging system  */
@@ -39,6 +40,7 @@ struct Efreet_Menu_Move
 };
 
 typedef struct Efreet_Menu_Internal Efreet_Menu_Internal;
+typedef struct Efreet_Menu_Context Efreet_Menu_Context;
 
 struct Efreet_Menu_Internal
 {
@@ -52,6 +54,7 @@ struct Efreet_Menu_Internal
     {
         const char *internal;     /**< The menu name */
         const char *name;         /**< Name to use in the menus */
+        char *key;                /**< Collation key of the menu name */
     } name;                       /**< The names for this menu */
 
     Efreet_Desktop *directory; /**< The directory */
@@ -62,6 +65,8 @@ struct Efreet_Menu_Internal
     Eina_List *app_dirs;           /**< .desktop application directories */
 
     Eina_List *app_pool;           /**< application pool */
+    Eina_Hash *app_pool_index;     /**< app_pool by desktop id */
+    unsigned long *visible;        /**< Pool desktops this menu can include */
     Eina_List *applications;       /**< applications in this menu */
 
     Eina_List *directory_dirs;    /**< .directory file directories */
@@ -70,8 +75,10 @@ struct Efreet_Menu_Internal
     Eina_List *moves;              /**< List of moves to be handled by the menu */
     Eina_List *filters;            /**< Include and Exclude filters */
 
+    Efreet_Menu_Context *context;   /**< The build this menu is part of */
     Efreet_Menu_Internal *parent;   /**< Our parent menu */
     Eina_List *sub_menus;          /**< Our sub menus */
+    Eina_Hash *sub_menus_index;    /**< First sub menu of each name */
 
     Eina_List *layout;             /**< This menus layout */
     Eina_List *default_layout;     /**< Default layout */
@@ -89,6 +96,7 @@ struct Efreet_Menu_Internal
 };
 
 typedef struct Efreet_Menu_App_Dir Efreet_Menu_App_Dir;
+typedef struct Efreet_Menu_Util_Dir Efreet_Menu_Util_Dir;
 
 struct Efreet_Menu_App_Dir
 {
@@ -97,6 +105,16 @@ struct Efreet_Menu_App_Dir
     unsigned int legacy:1;      /**< is this a legacy dir */
 };
 
+/* A standard application dir, filled from the desktop util cache */
+struct Efreet_Menu_Util_Dir
+{
+    const char *path;           /**< directory path */
+    char *real;                 /**< the resolved path, NULL if missing */
+    size_t real_len;            /**< length of real */
+    Eina_List *ids;             /**< file ids of the desktops in this dir */
+    Eina_List *paths;           /**< their resolved paths, in the same order */
+};
+
 enum Efreet_Menu_Filter_Op_Type
 {
     EFREET_MENU_FILTER_OP_OR,
@@ -166,7 +184,74 @@ struct Efreet_Menu_Desktop
 {
     Efreet_Desktop *desktop;   /**< The desktop we refer too */
     const char *id;            /**< The desktop file id */
-    unsigned char allocated:1; /**< If this desktop has been allocated */
+    unsigned int index;        /**< The bit of this desktop in filter bitsets */
+    const char *key;           /**< Collation key of the desktop name */
+    unsigned int key_owned:1;  /**< The key isn't from the desktop cache */
+};
+
+#define EFREET_MENU_BIT_WORD(i) ((i) / (sizeof(unsigned long) * 8))
+#define EFREET_MENU_BIT_MASK(i) (1UL << ((i) % (sizeof(unsigned long) * 8)))
+#define EFREET_MENU_BIT_SET(bits, i) ((bits)[EFREET_MENU_BIT_WORD(i)] |= EFREET_MENU_BIT_MASK(i))
+#define EFREET_MENU_BIT_CLEAR(bits, i) ((bits)[EFREET_MENU_BIT_WORD(i)] &= ~EFREET_MENU_BIT_MASK(i))
+
+typedef struct Efreet_Menu_Terms Efreet_Menu_Terms;
+
+/*
+ * The filters of a menu build are run on bitsets with one bit per pool
+ * desktop, so each filter op handles all desktops a word at a time
+ */
+struct Efreet_Menu_Terms
+{
+    Eina_Hash *categories;          /**< Filter category -> desktops in it */
+    Eina_Hash *filenames;           /**< Filter desktop id -> desktops with it */
+    Eina_Hash *ids;                 /**< Desktop id -> list of pool desktops */
+    Efreet_Menu_Desktop **desktops; /**< Pool desktops by bit index */
+    unsigned long *with_categories; /**< Desktops with any category */
+    unsigned long *allocated;       /**< Desktops included by a menu */
+    unsigned int count;             /**< Number of pool desktops */
+    unsigned int words;             /**< Words in each bitset */
+};
+
+/*
+ * The state of one menu build. It hangs off the menu tree, so builds in
+ * different threads don't share anything but the read only handler hashes
+ */
+struct Efreet_Menu_Context
+{
+    Efreet_Menu_Internal *root; /**< The menu tree, which owns the context */
+    Eina_Hash *merged_menus;    /**< Menu files merged so far */
+    Eina_Hash *merged_dirs;     /**< Menu dirs merged so far */
+    Eina_Hash *inputs;          /**< Files and dirs read for the menu cache */
+    Efreet_Menu_Terms *terms;   /**< Filter bitsets while the tree is processed */
+    long long generation;       /**< Serial of the desktop cache at the start */
+    int main_loop;              /**< Depth of efreet_menu_main_loop_begin() */
+};
+
+typedef struct Efreet_Menu_Async Efreet_Menu_Async;
+
+/* A menu built in a thread for efreet_menu_get_async() */
+struct Efreet_Menu_Async
+{
+    Efreet_Menu_Cb cb;              /**< Gets the menu on the main loop */
+    const void *data;               /**< Data for cb */
+    const char *path;               /**< The menu file */
+    Efreet_Menu_Context *context;   /**< The state for the build */
+    Efreet_Menu *entry;             /**< The menu from the menu cache */
+    Efreet_Menu_Internal *internal; /**< The processed menu tree */
+    Ecore_Job *job;                 /**< Hands over a build which ran without a thread */
+    Eina_Bool done;                 /**< The thread is done, under the async lock */
+    Eina_Bool dropped;              /**< Handed over at shutdown, only free it */
+    unsigned int lazy:1;            /**< Whether sub menus are laid out on first access */
+};
+
+typedef struct Efreet_Menu_Source Efreet_Menu_Source;
+
+/* Where a parsed menu came from, so it can be updated in place */
+struct Efreet_Menu_Source
+{
+    const char *path;               /**< The menu file */
+    Efreet_Menu_Internal *internal; /**< The processed menu tree, kept from the first update */
+    unsigned int lazy:1;            /**< Whether sub menus are laid out on first access */
 };
 
 static const char *efreet_menu_prefix = NULL; /**< The $XDG_MENU_PREFIX env var */
@@ -174,8 +259,22 @@ Eina_List *efreet_menu_kde_legacy_dirs = NULL; /**< The directories to use for K
 static const char *efreet_tag_menu = NULL;
 static const char *efreet_menu_file = NULL; /**< A menu file set explicityl as default */
 
-static Eina_Hash *efreet_merged_menus = NULL;
-static Eina_Hash *efreet_merged_dirs = NULL;
+static Eina_List *efreet_menu_asyncs = NULL; /**< Builds of efreet_menu_get_async() */
+static Efreet_Menu_Async *efreet_menu_async_starting = NULL; /**< The build in ecore_thread_run() */
+
+/* Builds in a thread take the main loop through a handshake with the main
+ * loop, so shutdown can serve them while it waits for them */
+static Eina_Lock efreet_menu_async_lock;
+static Eina_Condition efreet_menu_async_cond;
+static int efreet_menu_async_ready = 0;     /**< The lock is set up, main loop only */
+static int efreet_menu_async_serving = 0;   /**< A serve call is queued on the main loop */
+static int efreet_menu_async_waiting = 0;   /**< Builds waiting for the main loop */
+static int efreet_menu_async_granted = 0;   /**< The main loop is handed to a waiting build */
+static int efreet_menu_async_holding = 0;   /**< A build holds the main loop */
+static int efreet_menu_async_cancelled = 0; /**< Shutdown waits, builds are skipped */
+static Eina_Hash *efreet_menu_sources = NULL; /**< Parsed Efreet_Menu -> Efreet_Menu_Source */
+static Eina_Hash *efreet_menu_stubs = NULL; /**< Sub menu not laid out yet -> Efreet_Menu_Internal */
+static int efreet_menu_lazy = 0; /**< Lay out sub menus on first access */
 
 static Eina_Hash *efreet_menu_handle_cbs = NULL;
 static Eina_Hash *efreet_menu_filter_cbs = NULL;
@@ -187,6 +286,13 @@ static const char *efreet_menu_prefix_get(void);
 static Efreet_Menu_Internal *efreet_menu_by_name_find(Efreet_Menu_Internal *internal,
                                                     const char *name,
                                                     Efreet_Menu_Internal **parent);
+static Efreet_Menu_Internal *efreet_menu_sub_menu_find(Efreet_Menu_Internal *internal,
+                                                    const char *name);
+static void efreet_menu_sub_menu_add(Efreet_Menu_Internal *parent,
+                                        Efreet_Menu_Internal *sub, int append);
+static void efreet_menu_sub_menu_remove(Efreet_Menu_Internal *parent,
+                                        Efreet_Menu_Internal *sub);
+static void efreet_menu_sub_menus_index(Efreet_Menu_Internal *internal);
 static int efreet_menu_cb_compare_names(Efreet_Menu_Internal *internal, const char *name);
 static int efreet_menu_cb_md_compare_ids(Efreet_Menu_Desktop *md, const char *name);
 
@@ -195,42 +301,79 @@ static int efreet_menu_cb_entry_compare_desktop(Efreet_Menu *entry, Efreet_Deskt
 
 static int efreet_menu_cb_move_compare(Efreet_Menu_Move *move, const char *old);
 
-static int efreet_menu_process(Efreet_Menu_Internal *internal, unsigned int only_unallocated);
+static int efreet_menu_path_find(char *menu, size_t size);
+static void efreet_menu_async_run(void *data, Ecore_Thread *thread);
+static void efreet_menu_async_end(void *data, Ecore_Thread *thread);
+static void efreet_menu_async_cancel(void *data, Ecore_Thread *thread);
+static void efreet_menu_async_end_job(void *data);
+static void efreet_menu_async_cancel_job(void *data);
+static void efreet_menu_async_drop(Efreet_Menu_Async *async);
+static void efreet_menu_async_serve(void);
+static void efreet_menu_async_serve_cb(void *data);
+static Efreet_Menu_Internal *efreet_menu_build(const char *path, Efreet_Menu_Context *context);
+static Efreet_Menu *efreet_menu_finish(const char *path, Efreet_Menu_Internal *internal,
+                                        int lazy);
+static int efreet_menu_process_tree(Efreet_Menu_Internal *internal);
+static int efreet_menu_process(Efreet_Menu_Internal *internal, Eina_List **unallocated);
+static void efreet_menu_process_visible(Efreet_Menu_Internal *internal);
 static int efreet_menu_process_dirs(Efreet_Menu_Internal *internal);
 static int efreet_menu_app_dirs_process(Efreet_Menu_Internal *internal);
 static int efreet_menu_app_dir_scan(Efreet_Menu_Internal *internal,
                                         const char *path,
                                         const char *id,
                                         int legacy);
+static Eina_List *efreet_menu_util_dirs_get(Efreet_Menu_Internal *internal);
+static void efreet_menu_util_dirs_free(Eina_List *util_dirs);
+static Eina_Bool efreet_menu_util_dir_add(Efreet_Menu_Internal *internal,
+                                        Efreet_Menu_Util_Dir *util_dir);
+static void efreet_menu_app_pool_add(Efreet_Menu_Internal *internal,
+                                        const char *id,
+                                        Efreet_Desktop *desktop);
 static int efreet_menu_directory_dirs_process(Efreet_Menu_Internal *internal);
-static int efreet_menu_directory_dir_scan(const char *path,
+static int efreet_menu_directory_dir_scan(Efreet_Menu_Internal *internal,
+                                            const char *path,
                                             const char *relative_path,
                                             Eina_Hash *cache);
 static Efreet_Desktop *efreet_menu_directory_get(Efreet_Menu_Internal *internal,
                                                     const char *path);
-static void efreet_menu_process_filters(Efreet_Menu_Internal *internal,
-                                            unsigned int only_unallocated);
-static Eina_List *efreet_menu_process_app_pool(Eina_List *pool,
-                                               Eina_List *applications,
-                                               Eina_Hash *matches,
-                                               Efreet_Menu_Filter *filter,
-                                               unsigned int only_unallocated);
-static int efreet_menu_filter_matches(Efreet_Menu_Filter_Op *op,
-                                        Efreet_Menu_Desktop *md);
-static int efreet_menu_filter_or_matches(Efreet_Menu_Filter_Op *op,
-                                            Efreet_Menu_Desktop *md);
-static int efreet_menu_filter_and_matches(Efreet_Menu_Filter_Op *op,
-                                            Efreet_Menu_Desktop *md);
-static int efreet_menu_filter_not_matches(Efreet_Menu_Filter_Op *op,
-                                            Efreet_Menu_Desktop *md);
-
-static Efreet_Menu *efreet_menu_layout_menu(Efreet_Menu_Internal *internal);
+static void efreet_menu_process_filters(Efreet_Menu_Internal *internal);
+static int efreet_menu_terms_build(Efreet_Menu_Internal *internal);
+static void efreet_menu_terms_free(Efreet_Menu_Context *context);
+static void efreet_menu_terms_number(Efreet_Menu_Internal *internal);
+static void efreet_menu_terms_collect(Efreet_Menu_Internal *internal);
+static void efreet_menu_terms_op_collect(Efreet_Menu_Terms *terms, Efreet_Menu_Filter_Op *op);
+static void efreet_menu_terms_fill(Efreet_Menu_Internal *internal);
+static unsigned long *efreet_menu_filter_matches(Efreet_Menu_Terms *terms,
+                                                Efreet_Menu_Filter_Op *op);
+static void efreet_menu_filter_or_matches(Efreet_Menu_Terms *terms,
+                                            Efreet_Menu_Filter_Op *op,
+                                            unsigned long *ret);
+static void efreet_menu_filter_and_matches(Efreet_Menu_Terms *terms,
+                                            Efreet_Menu_Filter_Op *op,
+                                            unsigned long *ret);
+static void efreet_menu_filter_not_matches(Efreet_Menu_Terms *terms,
+                                            Efreet_Menu_Filter_Op *op,
+                                            unsigned long *ret);
+
+static Efreet_Menu *efreet_menu_layout_menu(Efreet_Menu_Internal *internal, int lazy);
+static Efreet_Menu *efreet_menu_layout_stub(Efreet_Menu_Internal *internal);
 static Efreet_Menu *efreet_menu_layout_desktop(Efreet_Menu_Desktop *md);
 static void efreet_menu_layout_entries_get(Efreet_Menu *entry, Efreet_Menu_Internal *internal,
-                                            Efreet_Menu_Layout *layout);
+                                            Efreet_Menu_Layout *layout, int lazy);
+static Eina_List *efreet_menu_layout_rules_get(Efreet_Menu_Internal *internal);
 static int efreet_menu_layout_is_empty(Efreet_Menu *entry);
-
-static Efreet_Menu_Internal *efreet_menu_internal_new(void);
+static int efreet_menu_layout_internal_is_empty(Efreet_Menu_Internal *internal);
+static int efreet_menu_show_empty_get(Efreet_Menu_Internal *internal);
+
+static Efreet_Menu_Internal *efreet_menu_internal_new(Efreet_Menu_Context *context);
+static Efreet_Menu_Context *efreet_menu_context_new(void);
+static void efreet_menu_context_free(Efreet_Menu_Context *context);
+static void efreet_menu_main_loop_begin(Efreet_Menu_Context *context);
+static void efreet_menu_main_loop_end(Efreet_Menu_Context *context);
+static Efreet_Desktop *efreet_menu_desktop_load(Efreet_Menu_Internal *internal,
+                                                const char *path, int real);
+static void efreet_menu_desktop_release(Efreet_Menu_Internal *internal,
+                                        Efreet_Desktop *desktop);
 static void efreet_menu_internal_free(Efreet_Menu_Internal *internal);
 static void efreet_menu_create_sub_menu_list(Efreet_Menu_Internal *internal);
 static void efreet_menu_create_app_dirs_list(Efreet_Menu_Internal *internal);
@@ -262,6 +405,16 @@ static void efreet_menu_desktop_free(Efreet_Menu_Desktop *md);
 
 static Efreet_Menu *efreet_menu_entry_new(void);
 
+static void efreet_menu_source_add(Efreet_Menu *entry, const char *path,
+                                    Efreet_Menu_Internal *internal);
+static void efreet_menu_source_free(Efreet_Menu_Source *source);
+static int efreet_menu_update_pools(Efreet_Menu_Internal *internal, Eina_List *paths);
+static void efreet_menu_update_merge(Efreet_Menu *entry, Efreet_Menu *update,
+                                        Eina_List **changed);
+static int efreet_menu_update_fields(Efreet_Menu *entry, Efreet_Menu *update);
+static void efreet_menu_stubs_del(Efreet_Menu *entry);
+static int efreet_menu_cb_entry_compare_same(Efreet_Menu *entry, Efreet_Menu *update);
+
 static int efreet_menu_handle_menu(Efreet_Menu_Internal *internal, Efreet_Xml *xml);
 static int efreet_menu_handle_name(Efreet_Menu_Internal *parent, Efreet_Xml *xml);
 
@@ -318,7 +471,9 @@ static void efreet_menu_resolve_moves(Efreet_Menu_Internal *internal);
 static void efreet_menu_concatenate(Efreet_Menu_Internal *dest, Efreet_Menu_Internal *src);
 
 static int efreet_menu_cb_menu_compare(Efreet_Menu_Internal *a, Efreet_Menu_Internal *b);
-static int efreet_menu_cb_md_compare(const Efreet_Menu_Desktop *a, const Efreet_Menu_Desktop *b);
+static int efreet_menu_cb_md_compare(const void *a, const void *b);
+static void efreet_menu_cb_ids_free(void *data);
+static const char *efreet_menu_desktop_key_get(Efreet_Menu_Desktop *md);
 
 static int efreet_menu_save_menu(Efreet_Menu *menu, FILE *f, int indent);
 static int efreet_menu_save_indent(FILE *f, int indent);
@@ -455,6 +610,12 @@ efreet_menu_init(void)
                         layout_cbs[i].key,
                         layout_cbs[i].cb);
     }
+
+    eina_lock_new(&efreet_menu_async_lock);
+    eina_condition_new(&efreet_menu_async_cond, &efreet_menu_async_lock);
+    efreet_menu_async_serving = 0;
+    efreet_menu_async_cancelled = 0;
+    efreet_menu_async_ready = 1;
     return 1;
 }
 
@@ -500,6 +661,42 @@ efreet_menu_kde_legacy_init(void)
 void
 efreet_menu_shutdown(void)
 {
+    Efreet_Menu_Async *async;
+    Eina_List *l;
+
+    /* builds in a thread use the handlers and the caches. Builds not
+     * started yet are skipped, the others are waited for and their main
+     * loop requests served meanwhile */
+    eina_lock_take(&efreet_menu_async_lock);
+    efreet_menu_async_cancelled = 1;
+    for (;;)
+    {
+        efreet_menu_async_serve();
+        EINA_LIST_FOREACH(efreet_menu_asyncs, l, async)
+        {
+            if (!async->done && !async->job) break;
+        }
+        if (!l) break;
+        eina_condition_wait(&efreet_menu_async_cond);
+    }
+    eina_lock_release(&efreet_menu_async_lock);
+
+    /* the callbacks of their threads only free them now */
+    EINA_LIST_FREE(efreet_menu_asyncs, async)
+    {
+        efreet_menu_async_drop(async);
+        if (async->job)
+        {
+            ecore_job_del(async->job);
+            free(async);
+        }
+        else
+            async->dropped = EINA_TRUE;
+    }
+    efreet_menu_async_ready = 0;
+    eina_condition_free(&efreet_menu_async_cond);
+    eina_lock_free(&efreet_menu_async_lock);
+
     IF_RELEASE(efreet_menu_file);
 
     IF_FREE_HASH(efreet_menu_handle_cbs);
@@ -509,8 +706,8 @@ efreet_menu_shutdown(void)
 
     IF_FREE_LIST(efreet_menu_kde_legacy_dirs, eina_stringshare_del);
 
-    IF_FREE_HASH(efreet_merged_menus);
-    IF_FREE_HASH(efreet_merged_dirs);
+    IF_FREE_HASH(efreet_menu_sources);
+    IF_FREE_HASH(efreet_menu_stubs);
 
     IF_RELEASE(efreet_tag_menu);
 
@@ -539,10 +736,81 @@ efreet_menu_file_set(const char *file)
     if (file) efreet_menu_file = eina_stringshare_add(file);
 }
 
+EAPI void
+efreet_menu_lazy_set(Eina_Bool lazy)
+{
+    efreet_menu_lazy = !!lazy;
+}
+
 EAPI Efreet_Menu *
 efreet_menu_get(void)
 {
     char menu[PATH_MAX];
+
+    if (!efreet_menu_path_find(menu, sizeof(menu))) return NULL;
+    return efreet_menu_parse(menu);
+}
+
+EAPI Eina_Bool
+efreet_menu_get_async(Efreet_Menu_Cb cb, const void *data)
+{
+    Efreet_Menu_Async *async;
+    char menu[PATH_MAX];
+
+    EINA_SAFETY_ON_NULL_RETURN_VAL(cb, EINA_FALSE);
+
+    if (!efreet_menu_path_find(menu, sizeof(menu))) return EINA_FALSE;
+
+    async = NEW(Efreet_Menu_Async, 1);
+    if (!async) return EINA_FALSE;
+    async->cb = cb;
+    async->data = data;
+    async->path = eina_stringshare_add(menu);
+    async->lazy = efreet_menu_lazy;
+
+    /* a menu cache hit goes through the thread as well, so cb is always
+     * called from the main loop after we return */
+    async->entry = efreet_cache_menu_find(menu, efreet_menu_prefix_get());
+
+    /* the base dirs and the context are set up here, as the first use of
+     * the base dirs has to happen on the main loop */
+    efreet_data_home_get();
+    efreet_data_dirs_get();
+    efreet_config_home_get();
+    efreet_config_dirs_get();
+    if (!async->entry)
+    {
+        async->context = efreet_menu_context_new();
+        if (!async->context)
+        {
+            eina_stringshare_del(async->path);
+            free(async);
+            return EINA_FALSE;
+        }
+    }
+
+    efreet_menu_asyncs = eina_list_append(efreet_menu_asyncs, async);
+    /* without threads ecore_thread_run() runs the build right away, its
+     * callbacks defer cb to a job then */
+    efreet_menu_async_starting = async;
+    ecore_thread_run(efreet_menu_async_run,
+                     efreet_menu_async_end,
+                     efreet_menu_async_cancel,
+                     async);
+    efreet_menu_async_starting = NULL;
+    return EINA_TRUE;
+}
+
+/**
+ * @internal
+ * @param menu Returns the path of the menu file
+ * @param size The size of @a menu
+ * @return Returns 1 if a menu file was found or 0 otherwise
+ * @brief Looks up the menu file to use as the applications menu
+ */
+static int
+efreet_menu_path_find(char *menu, size_t size)
+{
     const char *dir;
     Eina_List *config_dirs, *l;
 
@@ -551,61 +819,395 @@ efreet_menu_get(void)
     if (efreet_menu_file)
     {
         if (ecore_file_exists(efreet_menu_file))
-        return efreet_menu_parse(efreet_menu_file);
+        {
+            eina_strlcpy(menu, efreet_menu_file, size);
+            return 1;
+        }
     }
 #endif
 
     /* check the users config directory first */
-    snprintf(menu, sizeof(menu), "%s/menus/%sapplications.menu",
+    snprintf(menu, size, "%s/menus/%sapplications.menu",
                         efreet_config_home_get(), efreet_menu_prefix_get());
     if (ecore_file_exists(menu))
-        return efreet_menu_parse(menu);
+        return 1;
 
     /* fallback to the XDG_CONFIG_DIRS */
     config_dirs = efreet_config_dirs_get();
     EINA_LIST_FOREACH(config_dirs, l, dir)
     {
-        snprintf(menu, sizeof(menu), "%s/menus/%sapplications.menu",
+        snprintf(menu, size, "%s/menus/%sapplications.menu",
                                     dir, efreet_menu_prefix_get());
         if (ecore_file_exists(menu))
-            return efreet_menu_parse(menu);
+            return 1;
     }
 
-    snprintf(menu, sizeof(menu), "/etc/xdg/menus/enlightenment-applications.menu");
-    if (ecore_file_exists(menu)) return efreet_menu_parse(menu);
+    snprintf(menu, size, "/etc/xdg/menus/enlightenment-applications.menu");
+    if (ecore_file_exists(menu)) return 1;
 
-    return NULL;
+    return 0;
+}
+
+/**
+ * @internal
+ * @param data The build
+ * @param thread The thread running the build
+ * @return Returns no value
+ * @brief Parses, merges and processes the menu in a thread
+ */
+static void
+efreet_menu_async_run(void *data, Ecore_Thread *thread __UNUSED__)
+{
+    Efreet_Menu_Async *async;
+    int cancelled;
+
+    async = data;
+    eina_lock_take(&efreet_menu_async_lock);
+    cancelled = efreet_menu_async_cancelled;
+    eina_lock_release(&efreet_menu_async_lock);
+
+    /* nothing is built once shutdown has started */
+    if (!async->entry && !cancelled)
+    {
+        async->internal = efreet_menu_build(async->path, async->context);
+        async->context = NULL;
+    }
+
+    eina_lock_take(&efreet_menu_async_lock);
+    async->done = EINA_TRUE;
+    eina_condition_broadcast(&efreet_menu_async_cond);
+    eina_lock_release(&efreet_menu_async_lock);
+}
+
+/**
+ * @internal
+ * @param data The build
+ * @param thread The thread which ran the build
+ * @return Returns no value
+ * @brief Lays out the built menu and hands it over, on the main loop
+ */
+static void
+efreet_menu_async_end(void *data, Ecore_Thread *thread __UNUSED__)
+{
+    Efreet_Menu_Async *async;
+    Efreet_Menu *entry;
+
+    async = data;
+    if (async->dropped)
+    {
+        free(async);
+        return;
+    }
+    if (async == efreet_menu_async_starting)
+    {
+        async->job = ecore_job_add(efreet_menu_async_end_job, async);
+        if (async->job) return;
+    }
+    efreet_menu_asyncs = eina_list_remove(efreet_menu_asyncs, async);
+
+    entry = async->entry;
+    if (entry)
+        efreet_menu_source_add(entry, async->path, NULL);
+    else if (async->internal)
+        entry = efreet_menu_finish(async->path, async->internal, async->lazy);
+
+    async->cb((void *)async->data, entry);
+    eina_stringshare_del(async->path);
+    free(async);
+}
+
+/**
+ * @internal
+ * @param data The build
+ * @param thread The thread of the build
+ * @return Returns no value
+ * @brief Drops a cancelled build, its callback gets no menu
+ */
+static void
+efreet_menu_async_cancel(void *data, Ecore_Thread *thread __UNUSED__)
+{
+    Efreet_Menu_Async *async;
+
+    async = data;
+    if (async == efreet_menu_async_starting)
+    {
+        async->job = ecore_job_add(efreet_menu_async_cancel_job, async);
+        if (async->job) return;
+    }
+    if (!async->dropped)
+    {
+        efreet_menu_asyncs = eina_list_remove(efreet_menu_asyncs, async);
+        efreet_menu_async_drop(async);
+    }
+    free(async);
+}
+
+/**
+ * @internal
+ * @param data The build
+ * @return Returns no value
+ * @brief Hands over a build which ran without a thread, after
+ * efreet_menu_get_async() returned
+ */
+static void
+efreet_menu_async_end_job(void *data)
+{
+    Efreet_Menu_Async *async;
+
+    async = data;
+    async->job = NULL;
+    efreet_menu_async_end(async, NULL);
+}
+
+/**
+ * @internal
+ * @param data The build
+ * @return Returns no value
+ * @brief Drops a build which failed to start, after efreet_menu_get_async()
+ * returned
+ */
+static void
+efreet_menu_async_cancel_job(void *data)
+{
+    Efreet_Menu_Async *async;
+
+    async = data;
+    async->job = NULL;
+    efreet_menu_async_cancel(async, NULL);
+}
+
+/**
+ * @internal
+ * @param async The build
+ * @return Returns no value
+ * @brief Frees what a build got so far, on the main loop. Its callback gets
+ * no menu.
+ */
+static void
+efreet_menu_async_drop(Efreet_Menu_Async *async)
+{
+    if (async->entry) efreet_menu_free(async->entry);
+    efreet_menu_context_free(async->context);
+    efreet_menu_internal_free(async->internal);
+    async->entry = NULL;
+    async->context = NULL;
+    async->internal = NULL;
+    async->cb((void *)async->data, NULL);
+    IF_RELEASE(async->path);
+}
+
+/**
+ * @internal
+ * @return Returns no value
+ * @brief Hands the main loop to the builds waiting for it, one at a time,
+ * and blocks while they hold it. Called on the main loop with the async
+ * lock held.
+ */
+static void
+efreet_menu_async_serve(void)
+{
+    while (efreet_menu_async_waiting)
+    {
+        efreet_menu_async_granted = 1;
+        efreet_menu_async_holding = 1;
+        eina_condition_broadcast(&efreet_menu_async_cond);
+        while (efreet_menu_async_holding)
+            eina_condition_wait(&efreet_menu_async_cond);
+    }
+}
+
+/**
+ * @internal
+ * @param data Not used
+ * @return Returns no value
+ * @brief Serves the builds waiting for the main loop, from the main loop
+ */
+static void
+efreet_menu_async_serve_cb(void *data __UNUSED__)
+{
+    /* queued before a shutdown, which has served the builds */
+    if (!efreet_menu_async_ready) return;
+
+    eina_lock_take(&efreet_menu_async_lock);
+    efreet_menu_async_serving = 0;
+    efreet_menu_async_serve();
+    eina_lock_release(&efreet_menu_async_lock);
 }
 
 EAPI Efreet_Menu *
 efreet_menu_parse(const char *path)
+{
+    Efreet_Menu_Internal *internal;
+    Efreet_Menu *entry;
+
+    EINA_SAFETY_ON_NULL_RETURN_VAL(path, NULL);
+
+    entry = efreet_cache_menu_find(path, efreet_menu_prefix_get());
+    if (entry)
+    {
+        efreet_menu_source_add(entry, path, NULL);
+        return entry;
+    }
+
+    internal = efreet_menu_build(path, efreet_menu_context_new());
+    if (!internal) return NULL;
+    return efreet_menu_finish(path, internal, efreet_menu_lazy);
+}
+
+EAPI Eina_List *
+efreet_menu_update(Efreet_Menu *menu, Efreet_Cache_Changes *changes)
+{
+    Efreet_Menu_Source *source;
+    Efreet_Menu_Internal *internal = NULL;
+    Efreet_Menu *entry;
+    Eina_List *changed = NULL;
+
+    EINA_SAFETY_ON_NULL_RETURN_VAL(menu, NULL);
+
+    if (!efreet_menu_sources) return NULL;
+    source = eina_hash_find(efreet_menu_sources, &menu);
+    if (!source) return NULL;
+
+    if (source->internal && changes)
+    {
+        Eina_List *paths;
+        int updated;
+
+        /* only the pools which read a changed desktop are rebuilt */
+        paths = eina_list_merge(eina_list_clone(changes->added),
+                                eina_list_clone(changes->removed));
+        paths = eina_list_merge(paths, eina_list_clone(changes->modified));
+        updated = efreet_menu_update_pools(source->internal, paths);
+        eina_list_free(paths);
+        if (!updated) return NULL;
+
+        /* the pools were changed in place, so a tree which can't be
+         * processed again is dropped together with the stubs into it */
+        if (efreet_menu_process_tree(source->internal))
+            internal = source->internal;
+        else
+        {
+            efreet_menu_stubs_del(menu);
+            efreet_menu_internal_free(source->internal);
+            source->internal = NULL;
+        }
+    }
+
+    /* the stubs of the menu point into the old tree until the new one is
+     * merged, so it is only replaced then */
+    if (!internal)
+    {
+        internal = efreet_menu_build(source->path, efreet_menu_context_new());
+        if (!internal) return NULL;
+    }
+
+    entry = efreet_menu_layout_menu(internal, source->lazy);
+    if (!entry)
+    {
+        if (internal != source->internal) efreet_menu_internal_free(internal);
+        return NULL;
+    }
+    efreet_menu_update_merge(menu, entry, &changed);
+    efreet_menu_free(entry);
+    if (internal->context->inputs && !source->lazy)
+        efreet_cache_menu_save(source->path, efreet_menu_prefix_get(), menu,
+                               internal->context->inputs,
+                               internal->context->generation);
+    IF_FREE_HASH(internal->context->inputs);
+
+    if (internal != source->internal)
+    {
+        efreet_menu_internal_free(source->internal);
+        source->internal = internal;
+    }
+    return changed;
+}
+
+/**
+ * @internal
+ * @param path The menu file @a internal was built from
+ * @param internal The processed menu tree, which is taken over
+ * @param lazy Whether sub menus are laid out on first access
+ * @return Returns the laid out menu or NULL on failure
+ * @brief Lays out a built menu, stores it in the menu cache and records
+ * where it came from
+ */
+static Efreet_Menu *
+efreet_menu_finish(const char *path, Efreet_Menu_Internal *internal, int lazy)
+{
+    Efreet_Menu *entry;
+
+    entry = efreet_menu_layout_menu(internal, lazy);
+
+    /* a lazy menu keeps the tree its sub menus are laid out from, the
+     * cache only takes complete menus */
+    if (!lazy)
+    {
+        if (entry)
+            efreet_cache_menu_save(path, efreet_menu_prefix_get(), entry,
+                                   internal->context->inputs,
+                                   internal->context->generation);
+        efreet_menu_internal_free(internal);
+        internal = NULL;
+    }
+    else
+        IF_FREE_HASH(internal->context->inputs);
+
+    if (!entry)
+    {
+        efreet_menu_internal_free(internal);
+        return NULL;
+    }
+    efreet_menu_source_add(entry, path, internal);
+    return entry;
+}
+
+/**
+ * @internal
+ * @param path The path of the menu to load
+ * @param context The state for the build, from efreet_menu_context_new() on
+ * the main loop. The menu tree takes it over.
+ * @return Returns the processed menu tree on success or NULL on failure
+ * @brief Parses the given .menu file and works out the .desktop files of
+ * each menu in it. The files and dirs read are recorded in the menu inputs.
+ * This may run in a thread, the state of the build is kept in its context.
+ */
+static Efreet_Menu_Internal *
+efreet_menu_build(const char *path, Efreet_Menu_Context *context)
 {
     Efreet_Xml *xml;
     Efreet_Menu_Internal *internal = NULL;
-    Efreet_Menu *entry = NULL;
 
-    EINA_SAFETY_ON_NULL_RETURN_VAL(path, NULL);
+    if (!context) return NULL;
+
+    /* record the inputs before they are read */
+    efreet_cache_menu_input_add(context->inputs, path);
 
     xml = efreet_xml_new(path);
-    if (!xml) return NULL;
+    if (!xml)
+    {
+        efreet_menu_context_free(context);
+        return NULL;
+    }
 
     /* make sure we've got a <Menu> to start with */
-    if (xml->tag != efreet_tag_menu)
+    if (strcmp(xml->tag, efreet_tag_menu))
     {
         WRN("Efreet_menu: Menu file didn't start with <Menu> tag.");
         efreet_xml_del(xml);
+        efreet_menu_context_free(context);
         return NULL;
     }
 
-    IF_FREE_HASH(efreet_merged_menus);
-    efreet_merged_menus = eina_hash_string_superfast_new(NULL);
-
-    IF_FREE_HASH(efreet_merged_dirs);
-    efreet_merged_dirs = eina_hash_string_superfast_new(NULL);
-
     /* split apart the filename and the path */
-    internal = efreet_menu_internal_new();
-    if (!internal) return NULL;
+    internal = efreet_menu_internal_new(context);
+    if (!internal)
+    {
+        efreet_xml_del(xml);
+        efreet_menu_context_free(context);
+        return NULL;
+    }
+    context->root = internal;
 
     /* Set default values */
     internal->show_empty = 0;
@@ -625,30 +1227,42 @@ efreet_menu_parse(const char *path)
 
     efreet_menu_resolve_moves(internal);
 
-    if (!efreet_menu_process_dirs(internal))
-    {
-        efreet_menu_internal_free(internal);
-        return NULL;
-    }
+    /* all menu files are merged now */
+    IF_FREE_HASH(context->merged_menus);
+    IF_FREE_HASH(context->merged_dirs);
 
-    /* handle all .desktops */
-    if (!efreet_menu_process(internal, 0))
+    if (!efreet_menu_process_dirs(internal) ||
+        !efreet_menu_process_tree(internal))
     {
         efreet_menu_internal_free(internal);
         return NULL;
     }
 
-    /* handle menus with only unallocated .desktops */
-    if (!efreet_menu_process(internal, 1))
+    return internal;
+}
+
+EAPI Eina_List *
+efreet_menu_entries_get(Efreet_Menu *menu)
+{
+    Efreet_Menu_Internal *internal;
+    Efreet_Menu *entry;
+
+    EINA_SAFETY_ON_NULL_RETURN_VAL(menu, NULL);
+
+    if (!efreet_menu_stubs) return menu->entries;
+    internal = eina_hash_find(efreet_menu_stubs, &menu);
+    if (!internal) return menu->entries;
+    eina_hash_del_by_key(efreet_menu_stubs, &menu);
+
+    /* lay out this level, its sub menus become stubs in turn */
+    entry = efreet_menu_layout_menu(internal, 1);
+    if (entry)
     {
-        efreet_menu_internal_free(internal);
-        return NULL;
+        menu->entries = entry->entries;
+        entry->entries = NULL;
+        efreet_menu_free(entry);
     }
-
-    /* layout menu */
-    entry = efreet_menu_layout_menu(internal);
-    efreet_menu_internal_free(internal);
-    return entry;
+    return menu->entries;
 }
 
 EAPI int
@@ -698,7 +1312,7 @@ efreet_menu_save_menu(Efreet_Menu *menu, FILE *f, int indent)
         fprintf(f, "<Directory>%s</Directory>\n", menu->desktop->orig_path);
     }
 
-    if (menu->entries)
+    if (efreet_menu_entries_get(menu))
     {
         Efreet_Menu *entry;
         int has_desktop = 0, has_menu = 0;
@@ -788,6 +1402,7 @@ efreet_menu_desktop_insert(Efreet_Menu *menu, Efreet_Desktop *desktop, int pos)
     efreet_desktop_ref(desktop);
     entry->desktop = desktop;
 
+    efreet_menu_entries_get(menu);
     if (pos < 0 || (unsigned int)pos >= eina_list_count(menu->entries))
         menu->entries = eina_list_append(menu->entries, entry);
     else
@@ -806,7 +1421,7 @@ efreet_menu_desktop_remove(Efreet_Menu *menu, Efreet_Desktop *desktop)
     EINA_SAFETY_ON_NULL_RETURN_VAL(menu, 0);
     EINA_SAFETY_ON_NULL_RETURN_VAL(desktop, 0);
 
-    entry = eina_list_search_unsorted(menu->entries,
+    entry = eina_list_search_unsorted(efreet_menu_entries_get(menu),
                                       EINA_COMPARE_CB(efreet_menu_cb_entry_compare_desktop),
                             desktop);
     if (entry)
@@ -831,7 +1446,7 @@ efreet_menu_dump(Efreet_Menu *menu, const char *indent)
 
     /* XXX dump the rest of the menu info */
 
-    if (menu->entries)
+    if (efreet_menu_entries_get(menu))
     {
         Efreet_Menu *entry;
         char *new_indent;
@@ -892,16 +1507,18 @@ efreet_default_dirs_get(const char *user_dir, Eina_List *system_dirs,
 
 /**
  * @internal
+ * @param context The build the menu is part of
  * @return Returns a new Efreet_Menu_Internal struct
  * @brief Allocates and initializes a new Efreet_Menu_Internal structure
  */
 static Efreet_Menu_Internal *
-efreet_menu_internal_new(void)
+efreet_menu_internal_new(Efreet_Menu_Context *context)
 {
     Efreet_Menu_Internal *internal;
 
     internal = NEW(Efreet_Menu_Internal, 1);
     if (!internal) return NULL;
+    internal->context = context;
     internal->show_empty = -1;
     internal->in_line = -1;
     internal->inline_limit = -1;
@@ -919,19 +1536,28 @@ efreet_menu_internal_new(void)
 void
 efreet_menu_internal_free(Efreet_Menu_Internal *internal)
 {
+    Efreet_Menu_Context *context;
+
     if (!internal) return;
 
+    /* the desktops go back to the desktop cache of the main loop */
+    context = internal->context;
+    efreet_menu_main_loop_begin(context);
+
     IF_RELEASE(internal->file.path);
     IF_RELEASE(internal->file.name);
 
     IF_RELEASE(internal->name.internal);
     internal->name.name = NULL;
+    IF_FREE(internal->name.key);
 
     internal->applications = eina_list_free(internal->applications);
 
     IF_FREE_LIST(internal->directories, eina_stringshare_del);
     IF_FREE_LIST(internal->app_dirs, efreet_menu_app_dir_free);
     IF_FREE_LIST(internal->app_pool, efreet_menu_desktop_free);
+    IF_FREE_HASH(internal->app_pool_index);
+    IF_FREE(internal->visible);
     IF_FREE_LIST(internal->directory_dirs, eina_stringshare_del);
     IF_FREE_HASH(internal->directory_cache);
 
@@ -939,13 +1565,145 @@ efreet_menu_internal_free(Efreet_Menu_Internal *internal)
     IF_FREE_LIST(internal->filters, efreet_menu_filter_free);
 
     IF_FREE_LIST(internal->sub_menus, efreet_menu_internal_free);
+    IF_FREE_HASH(internal->sub_menus_index);
 
     IF_FREE_LIST(internal->layout, efreet_menu_layout_free);
     IF_FREE_LIST(internal->default_layout, efreet_menu_layout_free);
 
+    efreet_menu_main_loop_end(context);
+    if (context->root == internal) efreet_menu_context_free(context);
     FREE(internal);
 }
 
+/**
+ * @internal
+ * @return Returns a new Efreet_Menu_Context or NULL on failure
+ * @brief Allocates the state for building one menu
+ */
+static Efreet_Menu_Context *
+efreet_menu_context_new(void)
+{
+    Efreet_Menu_Context *context;
+
+    context = NEW(Efreet_Menu_Context, 1);
+    if (!context) return NULL;
+    context->merged_menus = eina_hash_string_superfast_new(NULL);
+    context->merged_dirs = eina_hash_string_superfast_new(NULL);
+    context->inputs = efreet_cache_menu_inputs_new();
+    context->generation = efreet_cache_desktop_generation();
+    return context;
+}
+
+/**
+ * @internal
+ * @param context The context to free
+ * @return Returns no value
+ * @brief Frees the state of a menu build
+ */
+static void
+efreet_menu_context_free(Efreet_Menu_Context *context)
+{
+    if (!context) return;
+    IF_FREE_HASH(context->merged_menus);
+    IF_FREE_HASH(context->merged_dirs);
+    IF_FREE_HASH(context->inputs);
+    efreet_menu_terms_free(context);
+    FREE(context);
+}
+
+/**
+ * @internal
+ * @param context The build which needs the main loop
+ * @return Returns no value
+ * @brief The desktop cache belongs to the main loop. A build in a thread
+ * holds the main loop while it gets or frees desktops, calls nest.
+ */
+static void
+efreet_menu_main_loop_begin(Efreet_Menu_Context *context)
+{
+    if (context->main_loop++) return;
+    if (eina_main_loop_is()) return;
+
+    eina_lock_take(&efreet_menu_async_lock);
+    efreet_menu_async_waiting++;
+    if (!efreet_menu_async_serving)
+    {
+        efreet_menu_async_serving = 1;
+        ecore_main_loop_thread_safe_call_async(efreet_menu_async_serve_cb, NULL);
+    }
+    /* a shutdown waiting for the builds serves us as well */
+    eina_condition_broadcast(&efreet_menu_async_cond);
+    while (!efreet_menu_async_granted)
+        eina_condition_wait(&efreet_menu_async_cond);
+    efreet_menu_async_granted = 0;
+    efreet_menu_async_waiting--;
+    eina_lock_release(&efreet_menu_async_lock);
+}
+
+/**
+ * @internal
+ * @param context The build which needed the main loop
+ * @return Returns no value
+ * @brief Lets go of the main loop taken by efreet_menu_main_loop_begin()
+ */
+static void
+efreet_menu_main_loop_end(Efreet_Menu_Context *context)
+{
+    if (--context->main_loop) return;
+    if (eina_main_loop_is()) return;
+
+    eina_lock_take(&efreet_menu_async_lock);
+    efreet_menu_async_holding = 0;
+    eina_condition_broadcast(&efreet_menu_async_cond);
+    eina_lock_release(&efreet_menu_async_lock);
+}
+
+/**
+ * @internal
+ * @param internal The menu the desktop is loaded for
+ * @param path The path of the desktop
+ * @param real Whether @a path is resolved already
+ * @return Returns the desktop or NULL if it can't be loaded
+ * @brief Loads a desktop from the main loop. The categories are read as
+ * well, the filters use them off the main loop.
+ */
+static Efreet_Desktop *
+efreet_menu_desktop_load(Efreet_Menu_Internal *internal, const char *path, int real)
+{
+    Efreet_Desktop *desktop;
+
+    if (!path) return NULL;
+    efreet_menu_main_loop_begin(internal->context);
+    if (real)
+        desktop = efreet_desktop_real_get(path);
+    else
+        desktop = efreet_desktop_get(path);
+    if (desktop) efreet_desktop_categories_get(desktop);
+    efreet_menu_main_loop_end(internal->context);
+
+    /* the desktop cache generation only covers what is in the cache,
+     * .directory files and desktops outside it are checked by mtime */
+    if (!desktop || !desktop->eet)
+        efreet_cache_menu_input_add(internal->context->inputs, path);
+    return desktop;
+}
+
+/**
+ * @internal
+ * @param internal The menu the desktop was loaded for
+ * @param desktop The desktop to free
+ * @return Returns no value
+ * @brief Frees a desktop from efreet_menu_desktop_load() on the main loop
+ */
+static void
+efreet_menu_desktop_release(Efreet_Menu_Internal *internal, Efreet_Desktop *desktop)
+{
+    if (!desktop) return;
+    efreet_menu_main_loop_begin(internal->context);
+    efreet_desktop_free(desktop);
+    efreet_menu_main_loop_end(internal->context);
+}
+
 /**
  * @internal
  * @return Returns the XDG_MENU_PREFIX env variable or "" if none set
@@ -978,11 +1736,12 @@ static int
 efreet_menu_handle_menu(Efreet_Menu_Internal *internal, Efreet_Xml *xml)
 {
     Efreet_Xml *child;
-    Eina_List *l;
+    unsigned int i;
     int (*cb)(Efreet_Menu_Internal *parent, Efreet_Xml *xml);
 
-    EINA_LIST_REVERSE_FOREACH(xml->children, l, child)
+    for (i = xml->children_count; i > 0; i--)
     {
+        child = xml->children[i - 1];
         cb = eina_hash_find(efreet_menu_handle_cbs, child->tag);
         if (cb)
         {
@@ -1012,7 +1771,7 @@ efreet_menu_handle_sub_menu(Efreet_Menu_Internal *parent, Efreet_Xml *xml)
 
     efreet_menu_create_sub_menu_list(parent);
 
-    internal = efreet_menu_internal_new();
+    internal = efreet_menu_internal_new(parent->context);
     if (!internal) return 0;
     internal->file.path = eina_stringshare_add(parent->file.path);
     if (!efreet_menu_handle_menu(internal, xml))
@@ -1023,16 +1782,14 @@ efreet_menu_handle_sub_menu(Efreet_Menu_Internal *parent, Efreet_Xml *xml)
 
     /* if this menu already exists we just take this one and stick it on the
      * start of the existing one */
-    if ((match = eina_list_search_unsorted(parent->sub_menus,
-                                           EINA_COMPARE_CB(efreet_menu_cb_menu_compare),
-                                           internal)))
+    if ((match = efreet_menu_sub_menu_find(parent, internal->name.internal)))
     {
 
         efreet_menu_concatenate(match, internal);
         efreet_menu_internal_free(internal);
     }
     else
-        parent->sub_menus = eina_list_prepend(parent->sub_menus, internal);
+        efreet_menu_sub_menu_add(parent, internal, 0);
 
     return 1;
 }
@@ -1544,6 +2301,8 @@ efreet_menu_merge(Efreet_Menu_Internal *parent, Efreet_Xml *xml, const char *pat
 
     if (!parent || !xml || !path) return 0;
 
+    efreet_cache_menu_input_add(parent->context->inputs, path);
+
     /* do nothing if the file doesn't exist */
     if (!ecore_file_exists(path)) return 1;
 
@@ -1554,12 +2313,12 @@ efreet_menu_merge(Efreet_Menu_Internal *parent, Efreet_Xml *xml, const char *pat
     }
 
     /* don't merge the same path twice */
-    if (eina_hash_find(efreet_merged_menus, rp))
+    if (eina_hash_find(parent->context->merged_menus, rp))
     {
         return 1;
     }
 
-    eina_hash_add(efreet_merged_menus, rp, (void *)1);
+    eina_hash_add(parent->context->merged_menus, rp, (void *)1);
 
     merge_xml = efreet_xml_new(rp);
 
@@ -1570,8 +2329,12 @@ efreet_menu_merge(Efreet_Menu_Internal *parent, Efreet_Xml *xml, const char *pat
         return 0;
     }
 
-    internal = efreet_menu_internal_new();
-    if (!internal) return 0;
+    internal = efreet_menu_internal_new(parent->context);
+    if (!internal)
+    {
+        efreet_xml_del(merge_xml);
+        return 0;
+    }
     efreet_menu_path_set(internal, path);
     efreet_menu_handle_menu(internal, merge_xml);
     efreet_menu_concatenate(parent, internal);
@@ -1599,6 +2362,7 @@ efreet_menu_handle_merge_dir(Efreet_Menu_Internal *parent, Efreet_Xml *xml)
 
     path = efreet_menu_path_get(parent, xml->text);
     if (!path) return 1;
+    efreet_cache_menu_input_add(parent->context->inputs, path);
     if (!ecore_file_exists(path))
     {
         eina_stringshare_del(path);
@@ -1629,8 +2393,9 @@ efreet_menu_merge_dir(Efreet_Menu_Internal *parent, Efreet_Xml *xml, const char
     if (!parent || !xml || !path) return 0;
 
     /* check to see if we've merged this directory already */
-    if (eina_hash_find(efreet_merged_dirs, path)) return 1;
-    eina_hash_add(efreet_merged_dirs, path, (void *)1);
+    if (eina_hash_find(parent->context->merged_dirs, path)) return 1;
+    eina_hash_add(parent->context->merged_dirs, path, (void *)1);
+    efreet_cache_menu_input_add(parent->context->inputs, path);
 
     it = eina_file_direct_ls(path);
     if (!it) return 1;
@@ -1766,6 +2531,7 @@ efreet_menu_handle_legacy_dir_helper(Efreet_Menu_Internal *root,
     if (!parent || !legacy_dir) return 0;
 
     path = efreet_menu_path_get(parent, legacy_dir);
+    efreet_cache_menu_input_add(parent->context->inputs, path);
 
     /* nothing to do if the legacy path doesn't exist */
     if (!path || !ecore_file_exists(path))
@@ -1774,7 +2540,7 @@ efreet_menu_handle_legacy_dir_helper(Efreet_Menu_Internal *root,
         return NULL;
     }
 
-    legacy_internal = efreet_menu_internal_new();
+    legacy_internal = efreet_menu_internal_new(parent->context);
     if (!legacy_internal)
         return NULL;
     legacy_internal->name.internal = eina_stringshare_add(ecore_file_file_get(path));
@@ -1847,18 +2613,18 @@ efreet_menu_handle_legacy_dir_helper(Efreet_Menu_Internal *root,
                 }
 
                 efreet_menu_create_sub_menu_list(legacy_internal);
-                legacy_internal->sub_menus = eina_list_prepend(legacy_internal->sub_menus, ret);
+                efreet_menu_sub_menu_add(legacy_internal, ret, 0);
 
                 continue;
             }
 
             if (!strcmp(fname, ".directory"))
             {
-                legacy_internal->directory = efreet_desktop_get(info->path);
+                legacy_internal->directory = efreet_menu_desktop_load(legacy_internal, info->path, 0);
                 if (legacy_internal->directory
                         && legacy_internal->directory->type != EFREET_DESKTOP_TYPE_DIRECTORY)
                 {
-                    efreet_desktop_free(legacy_internal->directory);
+                    efreet_menu_desktop_release(legacy_internal, legacy_internal->directory);
                     legacy_internal->directory = NULL;
                 }
                 continue;
@@ -1867,19 +2633,21 @@ efreet_menu_handle_legacy_dir_helper(Efreet_Menu_Internal *root,
             exten = strrchr(fname, '.');
 
             if (exten && !strcmp(exten, ".desktop"))
-                desktop = efreet_desktop_get(info->path);
+                desktop = efreet_menu_desktop_load(legacy_internal, info->path, 0);
 
             if (!desktop) continue;
 
             /* if the .desktop has categories it isn't legacy */
             if (efreet_desktop_category_count_get(desktop) != 0)
             {
-                efreet_desktop_free(desktop);
+                efreet_menu_desktop_release(legacy_internal, desktop);
                 continue;
             }
 
             /* XXX: This will disappear when the .desktop is free'd */
+            efreet_menu_main_loop_begin(legacy_internal->context);
             efreet_desktop_category_add(desktop, "Legacy");
+            efreet_menu_main_loop_end(legacy_internal->context);
 
             if (prefix)
             {
@@ -1890,7 +2658,7 @@ efreet_menu_handle_legacy_dir_helper(Efreet_Menu_Internal *root,
                 filter->op->filenames = eina_list_append(filter->op->filenames, eina_stringshare_add(fname));
 
             count++;
-            efreet_desktop_free(desktop);
+            efreet_menu_desktop_release(legacy_internal, desktop);
         }
         eina_iterator_free(it);
     }
@@ -1945,16 +2713,17 @@ static int
 efreet_menu_handle_move(Efreet_Menu_Internal *parent, Efreet_Xml *xml)
 {
     Efreet_Xml *child;
-    Eina_List *l;
+    unsigned int i;
 
     if (!parent || !xml) return 0;
 
     efreet_menu_create_move_list(parent);
 
-    EINA_LIST_FOREACH(xml->children, l, child)
+    for (i = 0; i < xml->children_count; i++)
     {
         int (*cb)(Efreet_Menu_Internal *parent, Efreet_Xml *xml);
 
+        child = xml->children[i];
         cb = eina_hash_find(efreet_menu_move_cbs, child->tag);
         if (cb)
         {
@@ -2052,7 +2821,7 @@ static int
 efreet_menu_handle_layout(Efreet_Menu_Internal *parent, Efreet_Xml *xml)
 {
     Efreet_Xml *child;
-    Eina_List *l;
+    unsigned int i;
 
     if (!parent || !xml) return 0;
 
@@ -2061,10 +2830,11 @@ efreet_menu_handle_layout(Efreet_Menu_Internal *parent, Efreet_Xml *xml)
 
     efreet_menu_create_layout_list(parent);
 
-    EINA_LIST_FOREACH(xml->children, l, child)
+    for (i = 0; i < xml->children_count; i++)
     {
         int (*cb)(Efreet_Menu_Internal *parent, Efreet_Xml *xml, int def);
 
+        child = xml->children[i];
         cb = eina_hash_find(efreet_menu_layout_cbs, child->tag);
         if (cb)
         {
@@ -2094,7 +2864,7 @@ efreet_menu_handle_default_layout(Efreet_Menu_Internal *parent, Efreet_Xml *xml)
 {
     const char *val;
     Efreet_Xml *child;
-    Eina_List *l;
+    unsigned int i;
 
     if (!parent || !xml) return 0;
 
@@ -2118,10 +2888,11 @@ efreet_menu_handle_default_layout(Efreet_Menu_Internal *parent, Efreet_Xml *xml)
 
     efreet_menu_create_default_layout_list(parent);
 
-    EINA_LIST_FOREACH(xml->children, l, child)
+    for (i = 0; i < xml->children_count; i++)
     {
         int (*cb)(Efreet_Menu_Internal *parent, Efreet_Xml *xml, int def);
 
+        child = xml->children[i];
         cb = eina_hash_find(efreet_menu_layout_cbs, child->tag);
         if (cb)
         {
@@ -2296,12 +3067,13 @@ static int
 efreet_menu_handle_filter_op(Efreet_Menu_Filter_Op *op, Efreet_Xml *xml)
 {
     Efreet_Xml *child;
-    Eina_List *l;
+    unsigned int i;
 
-    EINA_LIST_FOREACH(xml->children, l, child)
+    for (i = 0; i < xml->children_count; i++)
     {
         int (*cb)(Efreet_Menu_Filter_Op *op, Efreet_Xml *xml);
 
+        child = xml->children[i];
         cb = eina_hash_find(efreet_menu_filter_cbs, child->tag);
         if (cb)
         {
@@ -2449,6 +3221,7 @@ static void
 efreet_menu_desktop_free(Efreet_Menu_Desktop *md)
 {
     IF_RELEASE(md->id);
+    if (md->key_owned) free((char *)md->key);
     if (md->desktop) efreet_desktop_free(md->desktop);
     FREE(md);
 }
@@ -2475,6 +3248,9 @@ efreet_menu_free(Efreet_Menu *entry)
 
     if (!entry) return;
 
+    if (efreet_menu_sources) eina_hash_del_by_key(efreet_menu_sources, &entry);
+    if (efreet_menu_stubs) eina_hash_del_by_key(efreet_menu_stubs, &entry);
+
     IF_RELEASE(entry->name);
     IF_RELEASE(entry->icon);
     EINA_LIST_FREE(entry->entries, sub)
@@ -2512,16 +3288,52 @@ efreet_menu_handle_filter_child_op(Efreet_Menu_Filter_Op *op, Efreet_Xml *xml,
     return 1;
 }
 
+/**
+ * @internal
+ * @param internal The root menu
+ * @return Returns 1 on success or 0 on failure
+ * @brief Runs the filters of every menu in the tree over the current app
+ * pools
+ */
+static int
+efreet_menu_process_tree(Efreet_Menu_Internal *internal)
+{
+    Efreet_Menu_Internal *sub;
+    Eina_List *unallocated = NULL;
+
+    if (!efreet_menu_terms_build(internal))
+    {
+        efreet_menu_terms_free(internal->context);
+        return 0;
+    }
+
+    /* handle all .desktops, menus with only unallocated .desktops are
+     * queued until every other menu has allocated its .desktops */
+    if (!efreet_menu_process(internal, &unallocated))
+    {
+        eina_list_free(unallocated);
+        efreet_menu_terms_free(internal->context);
+        return 0;
+    }
+
+    /* handle menus with only unallocated .desktops */
+    EINA_LIST_FREE(unallocated, sub)
+        efreet_menu_process_filters(sub);
+    efreet_menu_terms_free(internal->context);
+    return 1;
+}
+
 /**
  * @internal
  * @param menu The menu to work with
- * @param only_unallocated Do we only look for unallocated items?
+ * @param unallocated The list to queue menus with only unallocated items on
  * @return Returns 1 if we've successfully processed the menu, 0 otherwise
  * @brief Handles the processing of the menu data to retrieve the .desktop
- * files for the menu
+ * files for the menu. Menus which only take unallocated items are appended
+ * to @a unallocated, to be processed once all other menus are done.
  */
 static int
-efreet_menu_process(Efreet_Menu_Internal *internal, unsigned int only_unallocated)
+efreet_menu_process(Efreet_Menu_Internal *internal, Eina_List **unallocated)
 {
     Eina_List *l;
 
@@ -2529,9 +3341,14 @@ efreet_menu_process(Efreet_Menu_Internal *internal, unsigned int only_unallocate
     if (!internal->name.internal || (internal->name.internal[0] == '\0'))
         return 0;
 
-    /* handle filtering out .desktop files as needed. This deals with all
-     * .desktop files */
-    efreet_menu_process_filters(internal, only_unallocated);
+    /* the pool our children see builds on ours */
+    efreet_menu_process_visible(internal);
+
+    /* handle filtering out .desktop files as needed */
+    if (internal->only_unallocated)
+        *unallocated = eina_list_append(*unallocated, internal);
+    else
+        efreet_menu_process_filters(internal);
 
     if (internal->sub_menus)
     {
@@ -2540,16 +3357,60 @@ efreet_menu_process(Efreet_Menu_Internal *internal, unsigned int only_unallocate
         EINA_LIST_FOREACH(internal->sub_menus, l, sub_internal)
         {
             sub_internal->parent = internal;
-            efreet_menu_process(sub_internal, only_unallocated);
+            efreet_menu_process(sub_internal, unallocated);
+            if (!sub_internal->name.key && sub_internal->name.internal)
+                sub_internal->name.key = efreet_collate_key_new(sub_internal->name.internal);
         }
+
+        /* sorted once here, so every layout of the tree can use this order */
+        internal->sub_menus = eina_list_sort(internal->sub_menus,
+                                             0,
+                                             EINA_COMPARE_CB(efreet_menu_cb_menu_compare));
+        if (internal->sub_menus_index) efreet_menu_sub_menus_index(internal);
     }
 
     return 1;
 }
 
+/**
+ * @internal
+ * @param internal The menu to work with
+ * @return Returns no value
+ * @brief Works out which pool desktops @a internal can see: its own pool,
+ * and the desktops its parent sees which aren't hidden by a desktop with the
+ * same id in its own pool.
+ */
+static void
+efreet_menu_process_visible(Efreet_Menu_Internal *internal)
+{
+    Efreet_Menu_Desktop *md, *other;
+    Efreet_Menu_Terms *terms;
+    Eina_List *l, *ll, *others;
+    unsigned int words;
+
+    IF_FREE(internal->visible);
+    terms = internal->context->terms;
+    if (!terms) return;
+
+    words = terms->words;
+    internal->visible = NEW(unsigned long, words);
+    if (!internal->visible) return;
+
+    if (internal->parent && internal->parent->visible)
+        memcpy(internal->visible, internal->parent->visible, words * sizeof(unsigned long));
+
+    EINA_LIST_FOREACH(internal->app_pool, l, md)
+    {
+        others = eina_hash_find(terms->ids, md->id);
+        EINA_LIST_FOREACH(others, ll, other)
+            EFREET_MENU_BIT_CLEAR(internal->visible, other->index);
+    }
+    EINA_LIST_FOREACH(internal->app_pool, l, md)
+        EFREET_MENU_BIT_SET(internal->visible, md->index);
+}
+
 /* This will walk through all of the app dirs and load all the .desktop
- * files into the cache for the menu. The .desktop files will have their
- * allocated flag set to 0 */
+ * files into the cache for the menu */
 static int
 efreet_menu_process_dirs(Efreet_Menu_Internal *internal)
 {
@@ -2580,28 +3441,33 @@ efreet_menu_process_dirs(Efreet_Menu_Internal *internal)
 /**
  * @internal
  * @param menu the menu to process
- * @param only_unallocated Only handle menus that deal with unallocated items
  * @return Returns no value
  * @brief Handles the processing of the filters attached to the given menu.
  *
- * For each include filter we'll add the items to our applications array. Each
- * exclude filter will remove items from the applications array
+ * For each include filter we'll add the visible items to our applications.
+ * Each exclude filter will remove items from the applications. If the menu
+ * only takes unallocated items, items allocated by other menus are skipped.
  */
 static void
-efreet_menu_process_filters(Efreet_Menu_Internal *internal, unsigned int only_unallocated)
+efreet_menu_process_filters(Efreet_Menu_Internal *internal)
 {
     Efreet_Menu_Filter *filter;
-    Efreet_Menu_Desktop *md;
-    Eina_List *l, *ll;
+    Efreet_Menu_Terms *terms;
+    Efreet_Menu_Desktop *md, **mds;
+    Eina_List *l;
+    unsigned long *bits, *apps, word;
+    unsigned int i, j, words, count;
 
     int included = 0;
 
-    /* nothing to do if we're checking the other option */
-    if (only_unallocated != internal->only_unallocated) return;
-
     internal->applications = eina_list_free(internal->applications);
 
-    if (!internal->filters) return;
+    if (!internal->filters || !internal->visible) return;
+
+    terms = internal->context->terms;
+    words = terms->words;
+    apps = NEW(unsigned long, words);
+    if (!apps) return;
 
     EINA_LIST_FOREACH(internal->filters, l, filter)
     {
@@ -2610,253 +3476,429 @@ efreet_menu_process_filters(Efreet_Menu_Internal *internal, unsigned int only_un
             continue;
         included = 1;
 
+        bits = efreet_menu_filter_matches(terms, filter->op);
+        if (!bits) continue;
+
         if (filter->type == EFREET_MENU_FILTER_INCLUDE)
         {
-            Eina_Hash *matches;
-
-            matches = eina_hash_string_superfast_new(NULL);
-            internal->applications = efreet_menu_process_app_pool(internal->app_pool, internal->applications,
-                                        matches, filter, internal->only_unallocated);
-            if (internal->parent)
+            for (i = 0; i < words; i++)
             {
-                Efreet_Menu_Internal *parent;
-
-                parent = internal->parent;
-                do {
-                    internal->applications = efreet_menu_process_app_pool(parent->app_pool,
-                                                internal->applications, matches, filter,
-                                                internal->only_unallocated);
-                } while ((parent = parent->parent));
+                bits[i] &= internal->visible[i];
+                if (internal->only_unallocated)
+                    bits[i] &= ~terms->allocated[i];
+                apps[i] |= bits[i];
+                terms->allocated[i] |= bits[i];
             }
-            eina_hash_free(matches);
         }
         else
         {
-            /* check each item in our menu so far and see if it's excluded */
-            l = internal->applications;
-            while ((md = eina_list_data_get(l)))
-            {
-                ll = eina_list_next(l);
-                if (efreet_menu_filter_matches(filter->op, md))
-                    internal->applications = eina_list_remove_list(internal->applications, l);
-                l = ll;
-            }
+            /* remove the excluded items from our menu so far */
+            for (i = 0; i < words; i++)
+                apps[i] &= ~bits[i];
         }
+        free(bits);
     }
 
-    /* sort the menu applications. we do this in process filters so it will only
-     * be done once per menu.*/
-    if (eina_list_count(internal->applications))
+    count = 0;
+    for (i = 0; i < words; i++)
+        for (word = apps[i]; word; word &= word - 1)
+            count++;
+    if (!count)
+    {
+        free(apps);
+        return;
+    }
+    mds = malloc(count * sizeof(Efreet_Menu_Desktop *));
+    if (!mds)
     {
-        Eina_List           *l2;
+        free(apps);
+        return;
+    }
 
-        EINA_LIST_FOREACH_SAFE(internal->applications, l, l2, md)
+    count = 0;
+    for (i = 0; i < words; i++)
+    {
+        if (!apps[i]) continue;
+        for (j = 0; j < sizeof(unsigned long) * 8; j++)
         {
-            if (md->desktop->no_display)
-                internal->applications = eina_list_remove_list(internal->applications, l);
+            if (!(apps[i] & (1UL << j))) continue;
+            md = terms->desktops[i * sizeof(unsigned long) * 8 + j];
+            if (md->desktop->no_display) continue;
+            efreet_menu_desktop_key_get(md);
+            mds[count++] = md;
         }
-        internal->applications = eina_list_sort(internal->applications,
-                                                eina_list_count(internal->applications),
-                                                EINA_COMPARE_CB(efreet_menu_cb_md_compare));
     }
+    free(apps);
+
+    /* sort the menu applications. we do this in process filters so it will only
+     * be done once per menu. The keys are made once per desktop, so this is
+     * a plain compare of bytes */
+    qsort(mds, count, sizeof(Efreet_Menu_Desktop *), efreet_menu_cb_md_compare);
+    for (i = 0; i < count; i++)
+        internal->applications = eina_list_append(internal->applications, mds[i]);
+    free(mds);
 }
 
 /**
  * @internal
- * @param pool The app pool to iterate
- * @param applications The list of applications to append too
- * @param matches The hash of previously matched ids
- * @param filter The menu filter to run on the pool items
- * @param only_unallocated Do we check only unallocated pool items?
- * @return Returns no value.
- * @brief This will iterate the items in @a pool and append them to @a
- * applications if they match the @a filter given and aren't previoulsy entered
- * in @a matches. If @a only_unallocated is set we'll only only at the
- * .desktop files that haven't been previoulsy matched
+ * @param internal The root menu
+ * @return Returns 1 on success or 0 on failure
+ * @brief Numbers every desktop in the app pools of the menu tree and builds
+ * a bitset over them for each category and desktop id used in a filter.
  */
-static Eina_List *
-efreet_menu_process_app_pool(Eina_List *pool, Eina_List *applications,
-                                Eina_Hash *matches, Efreet_Menu_Filter *filter,
-                                unsigned int only_unallocated)
+static int
+efreet_menu_terms_build(Efreet_Menu_Internal *internal)
+{
+    Efreet_Menu_Terms *terms;
+
+    efreet_menu_terms_free(internal->context);
+
+    terms = NEW(Efreet_Menu_Terms, 1);
+    if (!terms) return 0;
+    internal->context->terms = terms;
+
+    efreet_menu_terms_number(internal);
+    terms->words = EFREET_MENU_BIT_WORD(terms->count) + 1;
+
+    terms->categories = eina_hash_string_superfast_new(EINA_FREE_CB(free));
+    terms->filenames = eina_hash_string_superfast_new(EINA_FREE_CB(free));
+    terms->ids = eina_hash_string_superfast_new(efreet_menu_cb_ids_free);
+    terms->desktops = NEW(Efreet_Menu_Desktop *, terms->count + 1);
+    terms->with_categories = NEW(unsigned long, terms->words);
+    terms->allocated = NEW(unsigned long, terms->words);
+    if (!terms->categories || !terms->filenames || !terms->ids ||
+        !terms->desktops || !terms->with_categories || !terms->allocated)
+        return 0;
+
+    efreet_menu_terms_collect(internal);
+    efreet_menu_terms_fill(internal);
+    return 1;
+}
+
+/**
+ * @internal
+ * @param data The list of desktops with a desktop id
+ * @return Returns no value
+ * @brief Frees the list of desktops stored for a desktop id
+ */
+static void
+efreet_menu_cb_ids_free(void *data)
+{
+    eina_list_free(data);
+}
+
+/**
+ * @internal
+ * @return Returns no value
+ * @brief Frees the filter terms of the last menu build
+ */
+static void
+efreet_menu_terms_free(Efreet_Menu_Context *context)
+{
+    Efreet_Menu_Terms *terms;
+
+    terms = context->terms;
+    if (!terms) return;
+
+    IF_FREE_HASH(terms->categories);
+    IF_FREE_HASH(terms->filenames);
+    IF_FREE_HASH(terms->ids);
+    IF_FREE(terms->desktops);
+    IF_FREE(terms->with_categories);
+    IF_FREE(terms->allocated);
+    FREE(terms);
+    context->terms = NULL;
+}
+
+/**
+ * @internal
+ * @param internal The menu to number
+ * @return Returns no value
+ * @brief Gives each desktop in the app pools of @a internal and its sub
+ * menus its bit index
+ */
+static void
+efreet_menu_terms_number(Efreet_Menu_Internal *internal)
 {
+    Efreet_Menu_Internal *sub;
     Efreet_Menu_Desktop *md;
     Eina_List *l;
 
-    EINA_LIST_FOREACH(pool, l, md)
+    EINA_LIST_FOREACH(internal->app_pool, l, md)
+        md->index = internal->context->terms->count++;
+
+    EINA_LIST_FOREACH(internal->sub_menus, l, sub)
+        efreet_menu_terms_number(sub);
+}
+
+/**
+ * @internal
+ * @param internal The menu to collect from
+ * @return Returns no value
+ * @brief Adds an empty bitset for each category and desktop id used by the
+ * filters of @a internal and its sub menus
+ */
+static void
+efreet_menu_terms_collect(Efreet_Menu_Internal *internal)
+{
+    Efreet_Menu_Internal *sub;
+    Efreet_Menu_Filter *filter;
+    Eina_List *l;
+
+    EINA_LIST_FOREACH(internal->filters, l, filter)
+        efreet_menu_terms_op_collect(internal->context->terms, filter->op);
+
+    EINA_LIST_FOREACH(internal->sub_menus, l, sub)
+        efreet_menu_terms_collect(sub);
+}
+
+static void
+efreet_menu_terms_op_collect(Efreet_Menu_Terms *terms, Efreet_Menu_Filter_Op *op)
+{
+    Efreet_Menu_Filter_Op *child;
+    Eina_List *l;
+    const char *t;
+
+    EINA_LIST_FOREACH(op->categories, l, t)
+    {
+        if (eina_hash_find(terms->categories, t)) continue;
+        eina_hash_add(terms->categories, t,
+                      NEW(unsigned long, terms->words));
+    }
+    EINA_LIST_FOREACH(op->filenames, l, t)
+    {
+        if (eina_hash_find(terms->filenames, t)) continue;
+        eina_hash_add(terms->filenames, t,
+                      NEW(unsigned long, terms->words));
+    }
+    EINA_LIST_FOREACH(op->filters, l, child)
+        efreet_menu_terms_op_collect(terms, child);
+}
+
+/**
+ * @internal
+ * @param internal The menu to fill from
+ * @return Returns no value
+ * @brief Sets the bit of each pool desktop in the bitsets of its categories
+ * and its desktop id, and indexes the pool desktops by bit and by id
+ */
+static void
+efreet_menu_terms_fill(Efreet_Menu_Internal *internal)
+{
+    Efreet_Menu_Internal *sub;
+    Efreet_Menu_Desktop *md;
+    Eina_List *l, *ll;
+    Efreet_Menu_Terms *terms;
+    unsigned long *bits;
+    const char *t;
+
+    terms = internal->context->terms;
+
+    EINA_LIST_FOREACH(internal->app_pool, l, md)
     {
-        if (eina_hash_find(matches, md->id)) continue;
-        if (only_unallocated && md->allocated) continue;
-        if (efreet_menu_filter_matches(filter->op, md))
+        Eina_List *categories, *others;
+
+        terms->desktops[md->index] = md;
+        others = eina_hash_find(terms->ids, md->id);
+        if (others)
+            eina_hash_modify(terms->ids, md->id, eina_list_append(others, md));
+        else
+            eina_hash_add(terms->ids, md->id, eina_list_append(NULL, md));
+
+        categories = efreet_desktop_categories_get(md->desktop);
+        if (categories)
+            EFREET_MENU_BIT_SET(terms->with_categories, md->index);
+        EINA_LIST_FOREACH(categories, ll, t)
         {
-            applications = eina_list_append(applications, md);
-            eina_hash_direct_add(matches, (void *)md->id, md);
-            md->allocated = 1;
+            bits = eina_hash_find(terms->categories, t);
+            if (bits) EFREET_MENU_BIT_SET(bits, md->index);
         }
+
+        bits = eina_hash_find(terms->filenames, md->id);
+        if (bits) EFREET_MENU_BIT_SET(bits, md->index);
     }
-    return applications;
+
+    EINA_LIST_FOREACH(internal->sub_menus, l, sub)
+        efreet_menu_terms_fill(sub);
 }
 
 /**
  * @internal
+ * @param terms The filter bitsets of the build
  * @param op The filter operation to execute
- * @param md The desktop to run the filter on
- * @return Returns 1 if this desktop matches the given filter, 0 otherwise
- * @brief This will execute the given @a filter on the given desktop
+ * @return Returns the bitset of the pool desktops matching @a op, or NULL on
+ * failure. The caller must free it.
+ * @brief This will execute the given @a filter on all pool desktops at once
  */
-static int
-efreet_menu_filter_matches(Efreet_Menu_Filter_Op *op, Efreet_Menu_Desktop *md)
+static unsigned long *
+efreet_menu_filter_matches(Efreet_Menu_Terms *terms, Efreet_Menu_Filter_Op *op)
 {
-    if (op->type == EFREET_MENU_FILTER_OP_OR)
-        return efreet_menu_filter_or_matches(op, md);
+    unsigned long *ret;
 
-    if (op->type == EFREET_MENU_FILTER_OP_AND)
-        return efreet_menu_filter_and_matches(op, md);
+    if (!terms) return NULL;
+    ret = NEW(unsigned long, terms->words);
+    if (!ret) return NULL;
 
-    if (op->type == EFREET_MENU_FILTER_OP_NOT)
-        return efreet_menu_filter_not_matches(op, md);
+    if (op->type == EFREET_MENU_FILTER_OP_OR)
+        efreet_menu_filter_or_matches(terms, op, ret);
+    else if (op->type == EFREET_MENU_FILTER_OP_AND)
+        efreet_menu_filter_and_matches(terms, op, ret);
+    else if (op->type == EFREET_MENU_FILTER_OP_NOT)
+        efreet_menu_filter_not_matches(terms, op, ret);
 
-    return 0;
+    return ret;
 }
 
 /**
  * @internal
+ * @param terms The filter bitsets of the build
  * @param op The filter operation to execute
- * @param md The desktop to execute on
- * @return Returns 1 if the desktop matches, 0 otherwise
- * @brief Executes the OR operation, @a op, on the desktop, @a md.
+ * @param ret The zeroed bitset to store the matches in
+ * @return Returns no value
+ * @brief Executes the OR operation, @a op, on all pool desktops.
  */
-static int
-efreet_menu_filter_or_matches(Efreet_Menu_Filter_Op *op, Efreet_Menu_Desktop *md)
+static void
+efreet_menu_filter_or_matches(Efreet_Menu_Terms *terms, Efreet_Menu_Filter_Op *op, unsigned long *ret)
 {
     Efreet_Menu_Filter_Op *child;
     Eina_List *l;
+    unsigned long *bits;
+    unsigned int i, words;
     char *t;
 
-    if (op->all) return 1;
-
-    if (op->categories && md->desktop->categories)
+    words = terms->words;
+    if (op->all)
     {
-        EINA_LIST_FOREACH(op->categories, l, t)
-        {
-            if (eina_list_search_unsorted(md->desktop->categories,
-                                          EINA_COMPARE_CB(strcmp), t))
-                return 1;
-        }
+        memset(ret, 0xff, words * sizeof(unsigned long));
+        return;
     }
 
-    if (op->filenames)
+    EINA_LIST_FOREACH(op->categories, l, t)
     {
-        EINA_LIST_FOREACH(op->filenames, l, t)
-            if (t == md->id) return 1;
+        bits = eina_hash_find(terms->categories, t);
+        if (!bits) continue;
+        for (i = 0; i < words; i++) ret[i] |= bits[i];
     }
 
-    if (op->filters)
+    EINA_LIST_FOREACH(op->filenames, l, t)
     {
-        EINA_LIST_FOREACH(op->filters, l, child)
-        {
-            if (efreet_menu_filter_matches(child, md))
-                return 1;
-        }
+        bits = eina_hash_find(terms->filenames, t);
+        if (!bits) continue;
+        for (i = 0; i < words; i++) ret[i] |= bits[i];
     }
 
-    return 0;
+    EINA_LIST_FOREACH(op->filters, l, child)
+    {
+        bits = efreet_menu_filter_matches(terms, child);
+        if (!bits) continue;
+        for (i = 0; i < words; i++) ret[i] |= bits[i];
+        free(bits);
+    }
 }
 
 /**
  * @internal
+ * @param terms The filter bitsets of the build
  * @param op The filter operation to execute
- * @param md The desktop to execute on
- * @return Returns 1 if the desktop matches, 0 otherwise
- * @brief Executes the AND operation, @a op, on the desktop, @a md.
+ * @param ret The zeroed bitset to store the matches in
+ * @return Returns no value
+ * @brief Executes the AND operation, @a op, on all pool desktops.
  */
-static int
-efreet_menu_filter_and_matches(Efreet_Menu_Filter_Op *op, Efreet_Menu_Desktop *md)
+static void
+efreet_menu_filter_and_matches(Efreet_Menu_Terms *terms, Efreet_Menu_Filter_Op *op, unsigned long *ret)
 {
     Efreet_Menu_Filter_Op *child;
     Eina_List *l;
+    unsigned long *bits;
+    unsigned int i, words;
     char *t;
 
-    if (op->categories)
-    {
-        if ((eina_list_count(op->categories) > 0) && !md->desktop->categories)
-            return 0;
+    words = terms->words;
+    memset(ret, 0xff, words * sizeof(unsigned long));
 
-        EINA_LIST_FOREACH(op->categories, l, t)
+    /* a term no desktop has leaves nothing */
+    EINA_LIST_FOREACH(op->categories, l, t)
+    {
+        bits = eina_hash_find(terms->categories, t);
+        if (!bits)
         {
-            if (!eina_list_search_unsorted(md->desktop->categories,
-                                           EINA_COMPARE_CB(strcmp), t))
-                return 0;
+            memset(ret, 0, words * sizeof(unsigned long));
+            return;
         }
+        for (i = 0; i < words; i++) ret[i] &= bits[i];
     }
 
-    if (op->filenames)
+    EINA_LIST_FOREACH(op->filenames, l, t)
     {
-        EINA_LIST_FOREACH(op->filenames, l, t)
+        bits = eina_hash_find(terms->filenames, t);
+        if (!bits)
         {
-            if (t != md->id) return 0;
+            memset(ret, 0, words * sizeof(unsigned long));
+            return;
         }
+        for (i = 0; i < words; i++) ret[i] &= bits[i];
     }
 
-    if (op->filters)
+    EINA_LIST_FOREACH(op->filters, l, child)
     {
-        EINA_LIST_FOREACH(op->filters, l, child)
-        {
-            if (!efreet_menu_filter_matches(child, md))
-                return 0;
-        }
+        bits = efreet_menu_filter_matches(terms, child);
+        if (!bits) continue;
+        for (i = 0; i < words; i++) ret[i] &= bits[i];
+        free(bits);
     }
-
-    return 1;
 }
 
 /**
  * @internal
+ * @param terms The filter bitsets of the build
  * @param op The filter operation to execute
- * @param md The desktop to execute on
- * @return Returns 1 if the desktop matches, 0 otherwise
- * @brief Executes the NOT operation, @a op, on the desktop, @a md.
+ * @param ret The zeroed bitset to store the matches in
+ * @return Returns no value
+ * @brief Executes the NOT operation, @a op, on all pool desktops.
  */
-static int
-efreet_menu_filter_not_matches(Efreet_Menu_Filter_Op *op, Efreet_Menu_Desktop *md)
+static void
+efreet_menu_filter_not_matches(Efreet_Menu_Terms *terms, Efreet_Menu_Filter_Op *op, unsigned long *ret)
 {
     Efreet_Menu_Filter_Op *child;
     Eina_List *l;
+    unsigned long *bits;
+    unsigned int i, words;
     char *t;
 
     /* !all means no desktops match */
-    if (op->all) return 0;
+    if (op->all) return;
 
-    if (op->categories)
-    {
-        if ((eina_list_count(op->categories) > 0) && !md->desktop->categories)
-            return 1;
+    words = terms->words;
+    memset(ret, 0xff, words * sizeof(unsigned long));
 
-        EINA_LIST_FOREACH(op->categories, l, t)
-        {
-            if (eina_list_search_unsorted(md->desktop->categories,
-                                          EINA_COMPARE_CB(strcmp), t))
-                return 0;
-        }
+    EINA_LIST_FOREACH(op->categories, l, t)
+    {
+        bits = eina_hash_find(terms->categories, t);
+        if (!bits) continue;
+        for (i = 0; i < words; i++) ret[i] &= ~bits[i];
     }
 
-    if (op->filenames)
+    EINA_LIST_FOREACH(op->filenames, l, t)
     {
-        EINA_LIST_FOREACH(op->filenames, l, t)
-        {
-            if (t == md->id) return 0;
-        }
+        bits = eina_hash_find(terms->filenames, t);
+        if (!bits) continue;
+        for (i = 0; i < words; i++) ret[i] &= ~bits[i];
     }
 
-    if (op->filters)
+    EINA_LIST_FOREACH(op->filters, l, child)
     {
-        EINA_LIST_FOREACH(op->filters, l, child)
-        {
-            if (efreet_menu_filter_matches(child, md))
-                return 0;
-        }
+        bits = efreet_menu_filter_matches(terms, child);
+        if (!bits) continue;
+        for (i = 0; i < words; i++) ret[i] &= ~bits[i];
+        free(bits);
     }
 
-    return 1;
+    /* desktops without categories always match a NOT with categories */
+    if (op->categories)
+    {
+        for (i = 0; i < words; i++)
+            ret[i] |= ~terms->with_categories[i];
+    }
 }
 
 /**
@@ -2931,21 +3973,21 @@ efreet_menu_concatenate(Efreet_Menu_Internal *dest, Efreet_Menu_Internal *src)
     {
         efreet_menu_create_sub_menu_list(dest);
 
+        /* src is freed by the caller, so drop its index right away */
+        IF_FREE_HASH(src->sub_menus_index);
         while ((submenu = eina_list_data_get(eina_list_last(src->sub_menus))))
         {
             Efreet_Menu_Internal *match;
 
-            src->sub_menus = eina_list_remove(src->sub_menus, submenu);
+            src->sub_menus = eina_list_remove_list(src->sub_menus, eina_list_last(src->sub_menus));
             /* if this menu is in the list already we just add to that */
-            if ((match = eina_list_search_unsorted(dest->sub_menus,
-                                                   EINA_COMPARE_CB(efreet_menu_cb_menu_compare),
-                                                   submenu)))
+            if ((match = efreet_menu_sub_menu_find(dest, submenu->name.internal)))
             {
                 efreet_menu_concatenate(match, submenu);
                 efreet_menu_internal_free(submenu);
             }
             else
-                dest->sub_menus = eina_list_prepend(dest->sub_menus, submenu);
+                efreet_menu_sub_menu_add(dest, submenu, 0);
         }
     }
 }
@@ -2982,7 +4024,7 @@ efreet_menu_resolve_moves(Efreet_Menu_Internal *internal)
         if (!origin) continue;
 
         /* remove the origin menu from the parent */
-        parent->sub_menus = eina_list_remove(parent->sub_menus, origin);
+        efreet_menu_sub_menu_remove(parent, origin);
 
         /* if the destination path doesn't exist we just rename the origin
          * menu and append to the parents list of children */
@@ -3005,12 +4047,12 @@ efreet_menu_resolve_moves(Efreet_Menu_Internal *internal)
 
                 *path = '\0';
 
-                ancestor = efreet_menu_internal_new();
+                ancestor = efreet_menu_internal_new(parent->context);
                 if (!ancestor) goto error;
                 ancestor->name.internal = eina_stringshare_add(tmp);
 
                 efreet_menu_create_sub_menu_list(parent);
-                parent->sub_menus = eina_list_append(parent->sub_menus, ancestor);
+                efreet_menu_sub_menu_add(parent, ancestor, 1);
 
                 parent = ancestor;
                 tmp = ++path;
@@ -3021,7 +4063,7 @@ efreet_menu_resolve_moves(Efreet_Menu_Internal *internal)
             origin->name.internal = eina_stringshare_add(tmp);
 
             efreet_menu_create_sub_menu_list(parent);
-            parent->sub_menus = eina_list_append(parent->sub_menus, origin);
+            efreet_menu_sub_menu_add(parent, origin, 1);
         }
         else
         {
@@ -3060,12 +4102,8 @@ efreet_menu_by_name_find(Efreet_Menu_Internal *internal, const char *name, Efree
     {
         *part = '\0';
 
-        if (!(internal = eina_list_search_unsorted(internal->sub_menus,
-                                                   EINA_COMPARE_CB(efreet_menu_cb_compare_names),
-                                                   ptr)))
-        {
+        if (!(internal = efreet_menu_sub_menu_find(internal, ptr)))
             return NULL;
-        }
 
         ptr = ++part;
         part = strchr(ptr, '/');
@@ -3074,14 +4112,93 @@ efreet_menu_by_name_find(Efreet_Menu_Internal *internal, const char *name, Efree
     if (parent) *parent = internal;
 
     /* find the menu in the parent list */
-    if (!(internal = eina_list_search_unsorted(internal->sub_menus,
-                                               EINA_COMPARE_CB(efreet_menu_cb_compare_names),
-                                               ptr)))
-    {
-        return NULL;
-    }
+    return efreet_menu_sub_menu_find(internal, ptr);
+}
 
-    return internal;
+/**
+ * @internal
+ * @param internal The menu to search
+ * @param name The name of the sub menu
+ * @return Returns the first sub menu called @a name or NULL if none found
+ * @brief Looks up a direct sub menu through the sub menu index
+ */
+static Efreet_Menu_Internal *
+efreet_menu_sub_menu_find(Efreet_Menu_Internal *internal, const char *name)
+{
+    if (!internal->sub_menus || !name) return NULL;
+    if (!internal->sub_menus_index) efreet_menu_sub_menus_index(internal);
+    return eina_hash_find(internal->sub_menus_index, name);
+}
+
+/**
+ * @internal
+ * @param parent The menu to add to
+ * @param sub The sub menu to add
+ * @param append Whether to append or prepend @a sub
+ * @return Returns no value
+ * @brief Adds @a sub to the sub menus of @a parent and its index
+ */
+static void
+efreet_menu_sub_menu_add(Efreet_Menu_Internal *parent, Efreet_Menu_Internal *sub, int append)
+{
+    if (append)
+        parent->sub_menus = eina_list_append(parent->sub_menus, sub);
+    else
+        parent->sub_menus = eina_list_prepend(parent->sub_menus, sub);
+
+    if (!parent->sub_menus_index || !sub->name.internal) return;
+    /* the index points at the first menu of a name in list order */
+    if (!append)
+        eina_hash_set(parent->sub_menus_index, sub->name.internal, sub);
+    else if (!eina_hash_find(parent->sub_menus_index, sub->name.internal))
+        eina_hash_add(parent->sub_menus_index, sub->name.internal, sub);
+}
+
+/**
+ * @internal
+ * @param parent The menu to remove from
+ * @param sub The sub menu to remove
+ * @return Returns no value
+ * @brief Removes @a sub from the sub menus of @a parent and its index
+ */
+static void
+efreet_menu_sub_menu_remove(Efreet_Menu_Internal *parent, Efreet_Menu_Internal *sub)
+{
+    Efreet_Menu_Internal *next;
+
+    parent->sub_menus = eina_list_remove(parent->sub_menus, sub);
+
+    if (!parent->sub_menus_index || !sub->name.internal) return;
+    if (eina_hash_find(parent->sub_menus_index, sub->name.internal) != sub) return;
+
+    eina_hash_del_by_key(parent->sub_menus_index, sub->name.internal);
+    next = eina_list_search_unsorted(parent->sub_menus,
+                                     EINA_COMPARE_CB(efreet_menu_cb_compare_names),
+                                     sub->name.internal);
+    if (next) eina_hash_add(parent->sub_menus_index, next->name.internal, next);
+}
+
+/**
+ * @internal
+ * @param internal The menu to index
+ * @return Returns no value
+ * @brief (Re)builds the name index over the sub menus of @a internal
+ */
+static void
+efreet_menu_sub_menus_index(Efreet_Menu_Internal *internal)
+{
+    Efreet_Menu_Internal *sub;
+    Eina_List *l;
+
+    IF_FREE_HASH(internal->sub_menus_index);
+    internal->sub_menus_index = eina_hash_string_superfast_new(NULL);
+
+    EINA_LIST_FOREACH(internal->sub_menus, l, sub)
+    {
+        if (!sub->name.internal) continue;
+        if (eina_hash_find(internal->sub_menus_index, sub->name.internal)) continue;
+        eina_hash_add(internal->sub_menus_index, sub->name.internal, sub);
+    }
 }
 
 static void
@@ -3275,36 +4392,218 @@ efreet_menu_path_get(Efreet_Menu_Internal *internal, const char *suffix)
 static int
 efreet_menu_cb_menu_compare(Efreet_Menu_Internal *a, Efreet_Menu_Internal *b)
 {
-    if (!a->name.internal || !b->name.internal) return 1;
-    if (a->name.internal == b->name.internal) return 0;
-    return strcmp(a->name.internal, b->name.internal);
+    if (!a->name.key || !b->name.key) return 1;
+    return strcmp(a->name.key, b->name.key);
 }
 
 static int
 efreet_menu_app_dirs_process(Efreet_Menu_Internal *internal)
 {
     Efreet_Menu_App_Dir *app_dir;
+    Efreet_Menu_Util_Dir *util_dir;
     Efreet_Menu_Desktop *md;
-    Eina_List *l;
+    Eina_List *util_dirs, *l, *ll;
+    Eina_Bool scan = EINA_FALSE;
 
+    efreet_menu_main_loop_begin(internal->context);
     EINA_LIST_FREE(internal->app_pool, md)
         efreet_menu_desktop_free(md);
+    efreet_menu_main_loop_end(internal->context);
+    IF_FREE_HASH(internal->app_pool_index);
+
+    /* the standard application dirs are known from the desktop util cache */
+    util_dirs = efreet_menu_util_dirs_get(internal);
 
     EINA_LIST_FOREACH(internal->app_dirs, l, app_dir)
-        efreet_menu_app_dir_scan(internal, app_dir->path, app_dir->prefix, app_dir->legacy);
+    {
+        EINA_LIST_FOREACH(util_dirs, ll, util_dir)
+        {
+            if (!strcmp(util_dir->path, app_dir->path)) break;
+        }
+        /* the util cache only knows the first desktop of each id. Once one
+         * of them isn't taken, ie. it is for another environment, the
+         * lower dirs are scanned for the next desktop with that id */
+        if (ll && !scan)
+        {
+            if (!efreet_menu_util_dir_add(internal, util_dir)) scan = EINA_TRUE;
+        }
+        else
+            efreet_menu_app_dir_scan(internal, app_dir->path, app_dir->prefix, app_dir->legacy);
+    }
+    efreet_menu_util_dirs_free(util_dirs);
 
     return 1;
 }
 
+/**
+ * @internal
+ * @param internal The menu whose app dirs to check
+ * @return Returns the standard application dirs, with the file ids and paths
+ * the util cache has for each, or NULL if the app dirs must be scanned
+ * @brief The util cache resolves each file id to the first standard dir
+ * which has it. That matches a scan of the app dirs as long as all standard
+ * dirs are app dirs, in the standard order and without a prefix.
+ */
+static Eina_List *
+efreet_menu_util_dirs_get(Efreet_Menu_Internal *internal)
+{
+    Efreet_Menu_App_Dir *app_dir;
+    Efreet_Menu_Util_Dir *util_dir;
+    Efreet_Cache_Hash *file_ids;
+    Eina_List *dirs, *util_dirs = NULL, *l, *next;
+    Eina_Iterator *it;
+    Eina_Hash_Tuple *tuple;
+    char rp[PATH_MAX];
+    char *dir;
+
+    if (!internal->app_dirs) return NULL;
+
+    dirs = efreet_default_dirs_get(efreet_data_home_get(), efreet_data_dirs_get(),
+                                                                    "applications");
+    EINA_LIST_FREE(dirs, dir)
+    {
+        util_dir = NEW(Efreet_Menu_Util_Dir, 1);
+        if (!util_dir)
+        {
+            eina_stringshare_del(dir);
+            continue;
+        }
+        util_dir->path = dir;
+        if (realpath(dir, rp))
+        {
+            util_dir->real = strdup(rp);
+            util_dir->real_len = strlen(rp);
+        }
+        util_dirs = eina_list_append(util_dirs, util_dir);
+    }
+    if (!util_dirs) return NULL;
+
+    /* every standard dir must be an app dir, in the same order */
+    next = util_dirs;
+    EINA_LIST_FOREACH(internal->app_dirs, l, app_dir)
+    {
+        Eina_List *ll;
+
+        EINA_LIST_FOREACH(util_dirs, ll, util_dir)
+        {
+            if (!strcmp(util_dir->path, app_dir->path)) break;
+        }
+        if (!ll) continue;
+        if ((ll != next) || app_dir->legacy || app_dir->prefix) goto error;
+        next = eina_list_next(next);
+    }
+    if (next) goto error;
+
+    /* the util cache belongs to the main loop, the ids and paths are copied
+     * out so the dirs are walked without it */
+    efreet_menu_main_loop_begin(internal->context);
+    file_ids = efreet_cache_util_hash_string("file_id");
+    if (!file_ids || !file_ids->hash)
+    {
+        efreet_menu_main_loop_end(internal->context);
+        goto error;
+    }
+
+    /* sort the file ids by the dir their desktop is in */
+    it = eina_hash_iterator_tuple_new(file_ids->hash);
+    EINA_ITERATOR_FOREACH(it, tuple)
+    {
+        const char *path;
+
+        path = tuple->data;
+        EINA_LIST_FOREACH(util_dirs, l, util_dir)
+        {
+            if (!util_dir->real) continue;
+            if (!strncmp(path, util_dir->real, util_dir->real_len) &&
+                (path[util_dir->real_len] == '/'))
+                break;
+        }
+        /* not below a standard dir, ie. through a symlink */
+        if (!l)
+        {
+            eina_iterator_free(it);
+            efreet_menu_main_loop_end(internal->context);
+            goto error;
+        }
+        util_dir->ids = eina_list_append(util_dir->ids, eina_stringshare_add(tuple->key));
+        util_dir->paths = eina_list_append(util_dir->paths, eina_stringshare_add(path));
+    }
+    eina_iterator_free(it);
+    efreet_menu_main_loop_end(internal->context);
+
+    return util_dirs;
+error:
+    efreet_menu_util_dirs_free(util_dirs);
+    return NULL;
+}
+
+/**
+ * @internal
+ * @param util_dirs The dirs to free
+ * @return Returns no value
+ * @brief Frees the dirs from efreet_menu_util_dirs_get()
+ */
+static void
+efreet_menu_util_dirs_free(Eina_List *util_dirs)
+{
+    Efreet_Menu_Util_Dir *util_dir;
+
+    EINA_LIST_FREE(util_dirs, util_dir)
+    {
+        IF_RELEASE(util_dir->path);
+        IF_FREE(util_dir->real);
+        IF_FREE_LIST(util_dir->ids, eina_stringshare_del);
+        IF_FREE_LIST(util_dir->paths, eina_stringshare_del);
+        free(util_dir);
+    }
+}
+
+/**
+ * @internal
+ * @param internal The menu to add to
+ * @param util_dir The standard dir to add
+ * @return Returns EINA_FALSE if a desktop of the dir wasn't added, then a
+ * lower dir may have another desktop with its id
+ * @brief Adds the desktops of a standard application dir to the app pool of
+ * @a internal without scanning the dir
+ */
+static Eina_Bool
+efreet_menu_util_dir_add(Efreet_Menu_Internal *internal, Efreet_Menu_Util_Dir *util_dir)
+{
+    Efreet_Desktop *desktop;
+    const char *id;
+    Eina_List *l, *path;
+    Eina_Bool ret = EINA_TRUE;
+
+    efreet_cache_menu_input_add(internal->context->inputs, util_dir->path);
+
+    path = util_dir->paths;
+    EINA_LIST_FOREACH(util_dir->ids, l, id)
+    {
+        const char *file;
+
+        file = eina_list_data_get(path);
+        path = eina_list_next(path);
+        if (internal->app_pool_index && eina_hash_find(internal->app_pool_index, id))
+            continue;
+
+        desktop = efreet_menu_desktop_load(internal, file, 1);
+        efreet_menu_app_pool_add(internal, id, desktop);
+        if (!internal->app_pool_index || !eina_hash_find(internal->app_pool_index, id))
+            ret = EINA_FALSE;
+    }
+    return ret;
+}
+
 static int
 efreet_menu_app_dir_scan(Efreet_Menu_Internal *internal, const char *path, const char *id, int legacy)
 {
     Efreet_Desktop *desktop;
-    Efreet_Menu_Desktop *menu_desktop;
     char buf2[PATH_MAX];
     Eina_Iterator *it;
     Eina_File_Direct_Info *info;
 
+    efreet_cache_menu_input_add(internal->context->inputs, path);
     it = eina_file_direct_ls(path);
     if (!it) return 1;
 
@@ -3330,26 +4629,8 @@ efreet_menu_app_dir_scan(Efreet_Menu_Internal *internal, const char *path, const
             ext = strrchr(fname, '.');
 
             if (!ext || strcmp(ext, ".desktop")) continue;
-            desktop = efreet_desktop_get(info->path);
-
-            if (!desktop || desktop->type != EFREET_DESKTOP_TYPE_APPLICATION)
-            {
-                if (desktop) efreet_desktop_free(desktop);
-                continue;
-            }
-            /* Don't add two files with the same id in the app pool */
-            if (eina_list_search_unsorted(internal->app_pool,
-                                          EINA_COMPARE_CB(efreet_menu_cb_md_compare_ids),
-                                          buf2))
-            {
-                if (desktop) efreet_desktop_free(desktop);
-                continue;
-            }
-
-            menu_desktop = efreet_menu_desktop_new();
-            menu_desktop->desktop = desktop;
-            menu_desktop->id = eina_stringshare_add(buf2);
-            internal->app_pool = eina_list_prepend(internal->app_pool, menu_desktop);
+            desktop = efreet_menu_desktop_load(internal, info->path, 0);
+            efreet_menu_app_pool_add(internal, buf2, desktop);
         }
     }
     eina_iterator_free(it);
@@ -3357,6 +4638,42 @@ efreet_menu_app_dir_scan(Efreet_Menu_Internal *internal, const char *path, const
     return 1;
 }
 
+/**
+ * @internal
+ * @param internal The menu to add to
+ * @param id The desktop file id
+ * @param desktop The desktop, which the pool takes over
+ * @return Returns no value
+ * @brief Adds an application to the app pool of @a internal, unless the pool
+ * already has a desktop with this id
+ */
+static void
+efreet_menu_app_pool_add(Efreet_Menu_Internal *internal, const char *id,
+                            Efreet_Desktop *desktop)
+{
+    Efreet_Menu_Desktop *menu_desktop;
+
+    if (!desktop || desktop->type != EFREET_DESKTOP_TYPE_APPLICATION)
+    {
+        efreet_menu_desktop_release(internal, desktop);
+        return;
+    }
+    /* Don't add two files with the same id in the app pool */
+    if (!internal->app_pool_index)
+        internal->app_pool_index = eina_hash_string_superfast_new(NULL);
+    if (eina_hash_find(internal->app_pool_index, id))
+    {
+        efreet_menu_desktop_release(internal, desktop);
+        return;
+    }
+
+    menu_desktop = efreet_menu_desktop_new();
+    menu_desktop->desktop = desktop;
+    menu_desktop->id = eina_stringshare_add(id);
+    internal->app_pool = eina_list_prepend(internal->app_pool, menu_desktop);
+    eina_hash_add(internal->app_pool_index, menu_desktop->id, menu_desktop);
+}
+
 /**
  * @internal
  * @param menu The menu to work with
@@ -3375,7 +4692,7 @@ efreet_menu_directory_dirs_process(Efreet_Menu_Internal *internal)
             eina_hash_string_superfast_new(EINA_FREE_CB(efreet_desktop_free));
 
         EINA_LIST_REVERSE_FOREACH(internal->directory_dirs, l, path)
-            efreet_menu_directory_dir_scan(path, NULL, internal->directory_cache);
+            efreet_menu_directory_dir_scan(internal, path, NULL, internal->directory_cache);
     }
 
     if (internal->directories)
@@ -3396,6 +4713,7 @@ efreet_menu_directory_dirs_process(Efreet_Menu_Internal *internal)
 
 /**
  * @internal
+ * @param internal The menu the dir is scanned for
  * @param path The path to scan
  * @param relative_path The relative portion of the path
  * @param cache The cache to populate
@@ -3404,15 +4722,16 @@ efreet_menu_directory_dirs_process(Efreet_Menu_Internal *internal)
  * applications to the cache
  */
 static int
-efreet_menu_directory_dir_scan(const char *path, const char *relative_path,
-                                Eina_Hash *cache)
+efreet_menu_directory_dir_scan(Efreet_Menu_Internal *internal, const char *path,
+                                const char *relative_path, Eina_Hash *cache)
 {
-    Efreet_Desktop *desktop;
+    Efreet_Desktop *desktop, *old;
     char buf2[PATH_MAX];
     Eina_Iterator *it;
     Eina_File_Direct_Info *info;
     char *ext;
 
+    efreet_cache_menu_input_add(internal->context->inputs, path);
     it = eina_file_direct_ls(path);
     if (!it) return 1;
 
@@ -3427,22 +4746,30 @@ efreet_menu_directory_dir_scan(const char *path, const char *relative_path,
             strcpy(buf2, fname);
 
         if (ecore_file_is_dir(info->path))
-            efreet_menu_directory_dir_scan(info->path, buf2, cache);
+            efreet_menu_directory_dir_scan(internal, info->path, buf2, cache);
 
         else
         {
             ext = strrchr(fname, '.');
             if (!ext || strcmp(ext, ".directory")) continue;
 
-            desktop = efreet_desktop_get(info->path);
+            desktop = efreet_menu_desktop_load(internal, info->path, 0);
             if (!desktop || desktop->type != EFREET_DESKTOP_TYPE_DIRECTORY)
             {
-                efreet_desktop_free(desktop);
+                efreet_menu_desktop_release(internal, desktop);
                 continue;
             }
 
-            eina_hash_del(cache, buf2, NULL);
-            eina_hash_add(cache, buf2, desktop);
+            /* deleting from the hash would free the old desktop without
+             * the main loop held, so it is replaced and released here */
+            old = eina_hash_find(cache, buf2);
+            if (old)
+            {
+                eina_hash_modify(cache, buf2, desktop);
+                efreet_menu_desktop_release(internal, old);
+            }
+            else
+                eina_hash_add(cache, buf2, desktop);
         }
     }
     eina_iterator_free(it);
@@ -3476,20 +4803,51 @@ efreet_menu_directory_get(Efreet_Menu_Internal *internal, const char *path)
 
 /**
  * @internal
- * @param a The first desktop
- * @param b The second desktop
+ * @param a Pointer to the first desktop
+ * @param b Pointer to the second desktop
  * @return Returns the comparison of the desktop files
- * @brief Compares the desktop files.
+ * @brief Compares the desktop files, for qsort(). Desktops which sort the
+ * same keep their pool order.
  */
 static int
-efreet_menu_cb_md_compare(const Efreet_Menu_Desktop *a, const Efreet_Menu_Desktop *b)
+efreet_menu_cb_md_compare(const void *a, const void *b)
 {
+    const Efreet_Menu_Desktop *md_a = *(const Efreet_Menu_Desktop **)a;
+    const Efreet_Menu_Desktop *md_b = *(const Efreet_Menu_Desktop **)b;
+    int ret;
+
 #ifdef STRICT_SPEC
-    return strcmp(ecore_file_file_get(a->desktop->orig_path), ecore_file_file_get(b->desktop->orig_path));
+    ret = strcmp(ecore_file_file_get(md_a->desktop->orig_path),
+                 ecore_file_file_get(md_b->desktop->orig_path));
 #else
-    if (a->desktop->name == b->desktop->name) return 0;
-    return strcasecmp(a->desktop->name, b->desktop->name);
+    ret = strcmp(md_a->key, md_b->key);
 #endif
+    if (ret) return ret;
+    if (md_a->index == md_b->index) return 0;
+    return (md_a->index < md_b->index) ? -1 : 1;
+}
+
+/**
+ * @internal
+ * @param md The desktop to get the key for
+ * @return Returns the collation key of the desktop name
+ * @brief The key is read from the desktop cache when it was built for our
+ * collation, else it is made once for @a md.
+ */
+static const char *
+efreet_menu_desktop_key_get(Efreet_Menu_Desktop *md)
+{
+    if (md->key) return md->key;
+
+    md->key = efreet_cache_desktop_collate_key(md->desktop);
+    if (md->key) return md->key;
+
+    md->key = efreet_collate_key_new(md->desktop->name ? md->desktop->name : "");
+    if (md->key)
+        md->key_owned = 1;
+    else
+        md->key = "";
+    return md->key;
 }
 
 static int
@@ -3507,11 +4865,12 @@ efreet_menu_cb_md_compare_ids(Efreet_Menu_Desktop *md, const char *name)
 }
 
 static Efreet_Menu *
-efreet_menu_layout_menu(Efreet_Menu_Internal *internal)
+efreet_menu_layout_menu(Efreet_Menu_Internal *internal, int lazy)
 {
     Efreet_Menu *entry;
-    Eina_List *layout = NULL;
-    Eina_List *l;
+    Eina_List *layout;
+    Eina_List *l, *sub_menus, *applications;
+    Eina_Hash *sub_menus_index;
 
     if (internal->parent)
     {
@@ -3523,19 +4882,7 @@ efreet_menu_layout_menu(Efreet_Menu_Internal *internal)
         if (internal->inline_alias == -1)  internal->inline_alias = internal->parent->inline_alias;
     }
 
-    if (internal->layout)
-        layout = internal->layout;
-
-    else if (internal->parent)
-    {
-        Efreet_Menu_Internal *parent;
-        parent = internal->parent;
-        do
-        {
-            layout = parent->default_layout;
-            parent = parent->parent;
-        } while (!layout && parent);
-    }
+    layout = efreet_menu_layout_rules_get(internal);
 
     /* init entry */
     entry = efreet_menu_entry_new();
@@ -3550,21 +4897,21 @@ efreet_menu_layout_menu(Efreet_Menu_Internal *internal)
     }
     entry->entries = NULL;
 
-#if 1 //STRICT_SPEC
-    if (internal->sub_menus)
-    {
-        internal->sub_menus = eina_list_sort(internal->sub_menus,
-                                             0,
-                                             EINA_COMPARE_CB(efreet_menu_cb_menu_compare));
-    }
-#endif
+    /* the layout uses up the sub menus and applications it places, so it
+     * works on copies and the menu tree stays as is */
+    sub_menus = internal->sub_menus;
+    sub_menus_index = internal->sub_menus_index;
+    applications = internal->applications;
+    internal->sub_menus = eina_list_clone(sub_menus);
+    internal->sub_menus_index = NULL;
+    internal->applications = eina_list_clone(applications);
 
     if (layout)
     {
         Efreet_Menu_Layout *lay;
 
         EINA_LIST_FOREACH(layout, l, lay)
-            efreet_menu_layout_entries_get(entry, internal, lay);
+            efreet_menu_layout_entries_get(entry, internal, lay, lazy);
     }
     else
     {
@@ -3577,9 +4924,12 @@ efreet_menu_layout_menu(Efreet_Menu_Internal *internal)
             {
                 Efreet_Menu *sub_entry;
                 if ((sub->directory && sub->directory->no_display) || sub->deleted) continue;
-                sub_entry = efreet_menu_layout_menu(sub);
+                if (lazy)
+                    sub_entry = efreet_menu_layout_stub(sub);
+                else
+                    sub_entry = efreet_menu_layout_menu(sub, 0);
                 /* Don't show empty menus */
-                if (!sub_entry->entries)
+                if (lazy ? efreet_menu_layout_is_empty(sub_entry) : !sub_entry->entries)
                 {
                     efreet_menu_free(sub_entry);
                     continue;
@@ -3601,7 +4951,12 @@ efreet_menu_layout_menu(Efreet_Menu_Internal *internal)
         }
     }
 
-    /* Don't keep this list around if it is empty */
+    eina_list_free(internal->sub_menus);
+    IF_FREE_HASH(internal->sub_menus_index);
+    eina_list_free(internal->applications);
+    internal->sub_menus = sub_menus;
+    internal->sub_menus_index = sub_menus_index;
+    internal->applications = applications;
 
     return entry;
 }
@@ -3623,9 +4978,39 @@ efreet_menu_layout_desktop(Efreet_Menu_Desktop *md)
     return entry;
 }
 
+/**
+ * @internal
+ * @param internal The menu to lay out later
+ * @return Returns a menu entry without entries
+ * @brief Creates the entry for a sub menu whose entries are laid out by
+ * efreet_menu_entries_get()
+ */
+static Efreet_Menu *
+efreet_menu_layout_stub(Efreet_Menu_Internal *internal)
+{
+    Efreet_Menu *entry;
+
+    entry = efreet_menu_entry_new();
+    entry->type = EFREET_MENU_ENTRY_MENU;
+    entry->id = eina_stringshare_add(internal->name.internal);
+    entry->name = eina_stringshare_add(internal->name.name);
+    if (internal->directory)
+    {
+        entry->icon = eina_stringshare_add(internal->directory->icon);
+        efreet_desktop_ref(internal->directory);
+        entry->desktop = internal->directory;
+    }
+
+    if (!efreet_menu_stubs)
+        efreet_menu_stubs = eina_hash_pointer_new(NULL);
+    eina_hash_add(efreet_menu_stubs, &entry, internal);
+
+    return entry;
+}
+
 static void
 efreet_menu_layout_entries_get(Efreet_Menu *entry, Efreet_Menu_Internal *internal,
-        Efreet_Menu_Layout *layout)
+        Efreet_Menu_Layout *layout, int lazy)
 {
     Efreet_Menu *sub_entry;
 
@@ -3651,13 +5036,16 @@ efreet_menu_layout_entries_get(Efreet_Menu *entry, Efreet_Menu_Internal *interna
         if (layout->inline_alias == -1) inline_alias = internal->inline_alias;
         else inline_alias = layout->inline_alias;
 
-        sub = eina_list_search_unsorted(internal->sub_menus,
-                                        EINA_COMPARE_CB(efreet_menu_cb_compare_names), layout->name);
+        sub = efreet_menu_sub_menu_find(internal, layout->name);
         if (sub)
         {
             if (!(sub->directory && sub->directory->no_display) && !sub->deleted)
             {
-                sub_entry = efreet_menu_layout_menu(sub);
+                /* an inlined menu is needed now, others can wait */
+                if (lazy && !in_line)
+                    sub_entry = efreet_menu_layout_stub(sub);
+                else
+                    sub_entry = efreet_menu_layout_menu(sub, lazy);
                 if (!show_empty && efreet_menu_layout_is_empty(sub_entry))
                     efreet_menu_free(sub_entry);
                 else if (in_line &&
@@ -3711,8 +5099,7 @@ efreet_menu_layout_entries_get(Efreet_Menu *entry, Efreet_Menu_Internal *interna
                 else
                     entry->entries = eina_list_append(entry->entries, sub_entry);
             }
-            internal->sub_menus = eina_list_remove(internal->sub_menus, sub);
-            efreet_menu_internal_free(sub);
+            efreet_menu_sub_menu_remove(internal, sub);
         }
     }
     else if (internal->applications && layout->type == EFREET_MENU_LAYOUT_FILENAME)
@@ -3752,20 +5139,22 @@ efreet_menu_layout_entries_get(Efreet_Menu *entry, Efreet_Menu_Internal *interna
         {
             Efreet_Menu_Internal *sub;
 
+            /* every sub menu is consumed below */
+            IF_FREE_HASH(internal->sub_menus_index);
             while ((sub = eina_list_data_get(internal->sub_menus)))
             {
                 internal->sub_menus = eina_list_remove_list(internal->sub_menus, internal->sub_menus);
                 if ((sub->directory && sub->directory->no_display) || sub->deleted)
-                {
-                    efreet_menu_internal_free(sub);
                     continue;
-                }
                 sub_entry = eina_list_search_unsorted(entry->entries,
                                                       EINA_COMPARE_CB(efreet_menu_cb_entry_compare_menu),
                                                       sub);
                 if (!sub_entry)
                 {
-                    sub_entry = efreet_menu_layout_menu(sub);
+                    if (lazy && !internal->in_line)
+                        sub_entry = efreet_menu_layout_stub(sub);
+                    else
+                        sub_entry = efreet_menu_layout_menu(sub, lazy);
                     if (!internal->show_empty && efreet_menu_layout_is_empty(sub_entry))
                         efreet_menu_free(sub_entry);
                     else if (internal->in_line &&
@@ -3823,9 +5212,7 @@ efreet_menu_layout_entries_get(Efreet_Menu *entry, Efreet_Menu_Internal *interna
                     else
                         entry->entries = eina_list_append(entry->entries, sub_entry);
                 }
-                efreet_menu_internal_free(sub);
             }
-            IF_FREE_LIST(internal->sub_menus, efreet_menu_internal_free);
         }
         else if (internal->sub_menus && !strcmp(layout->name, "all"))
         {
@@ -3833,9 +5220,9 @@ efreet_menu_layout_entries_get(Efreet_Menu *entry, Efreet_Menu_Internal *interna
 
             orig = layout->name;
             layout->name = "menus";
-            efreet_menu_layout_entries_get(entry, internal, layout);
+            efreet_menu_layout_entries_get(entry, internal, layout, lazy);
             layout->name = "files";
-            efreet_menu_layout_entries_get(entry, internal, layout);
+            efreet_menu_layout_entries_get(entry, internal, layout, lazy);
             layout->name = orig;
         }
     }
@@ -3869,16 +5256,19 @@ static int
 efreet_menu_cb_move_compare(Efreet_Menu_Move *move, const char *old)
 {
     if (!move->old_name || !old) return 1;
-    if (move->old_name == old) return 0;
-    return 1;
+    /* old is xml text, which isn't a stringshare */
+    return strcmp(move->old_name, old);
 }
 
 static int
 efreet_menu_layout_is_empty(Efreet_Menu *entry)
 {
+    Efreet_Menu_Internal *internal;
     Efreet_Menu *sub_entry;
     Eina_List *l;
 
+    if (efreet_menu_stubs && (internal = eina_hash_find(efreet_menu_stubs, &entry)))
+        return efreet_menu_layout_internal_is_empty(internal);
     if (!entry->entries) return 1;
 
     EINA_LIST_FOREACH(entry->entries, l, sub_entry)
@@ -3888,3 +5278,334 @@ efreet_menu_layout_is_empty(Efreet_Menu *entry)
     }
     return 1;
 }
+
+/**
+ * @internal
+ * @param entry The parsed menu
+ * @param path The menu file @a entry was parsed from
+ * @param internal The menu tree of a lazy menu, which the source takes over
+ * @return Returns no value
+ * @brief Remembers where @a entry came from for efreet_menu_update() and
+ * efreet_menu_entries_get()
+ */
+static void
+efreet_menu_source_add(Efreet_Menu *entry, const char *path, Efreet_Menu_Internal *internal)
+{
+    Efreet_Menu_Source *source;
+
+    if (!efreet_menu_sources)
+        efreet_menu_sources = eina_hash_pointer_new(EINA_FREE_CB(efreet_menu_source_free));
+    if (!efreet_menu_sources) return;
+
+    source = NEW(Efreet_Menu_Source, 1);
+    if (!source)
+    {
+        efreet_menu_internal_free(internal);
+        return;
+    }
+    source->path = eina_stringshare_add(path);
+    source->internal = internal;
+    source->lazy = !!internal;
+    eina_hash_add(efreet_menu_sources, &entry, source);
+}
+
+/**
+ * @internal
+ * @param source The source to free
+ * @return Returns no value
+ * @brief Frees the given structure
+ */
+static void
+efreet_menu_source_free(Efreet_Menu_Source *source)
+{
+    IF_RELEASE(source->path);
+    efreet_menu_internal_free(source->internal);
+    FREE(source);
+}
+
+/**
+ * @internal
+ * @param internal The menu to update
+ * @param paths The paths of the changed desktop files
+ * @return Returns the number of app pools rebuilt
+ * @brief Rebuilds the app pool of each menu in the tree which has one of
+ * @a paths below its app dirs
+ */
+static int
+efreet_menu_update_pools(Efreet_Menu_Internal *internal, Eina_List *paths)
+{
+    Efreet_Menu_App_Dir *app_dir;
+    Efreet_Menu_Internal *sub;
+    Eina_List *l, *ll;
+    const char *path, *dir;
+    char rp[PATH_MAX];
+    size_t len;
+    int ret = 0;
+
+    EINA_LIST_FOREACH(internal->app_dirs, l, app_dir)
+    {
+        /* desktop paths are resolved, a removed dir has to match as is */
+        dir = realpath(app_dir->path, rp) ? rp : app_dir->path;
+        len = strlen(dir);
+        EINA_LIST_FOREACH(paths, ll, path)
+        {
+            if (!strncmp(path, dir, len) && (path[len] == '/')) break;
+        }
+        if (ll) break;
+    }
+    if (l)
+    {
+        efreet_menu_app_dirs_process(internal);
+        ret++;
+    }
+
+    EINA_LIST_FOREACH(internal->sub_menus, l, sub)
+        ret += efreet_menu_update_pools(sub, paths);
+    return ret;
+}
+
+/**
+ * @internal
+ * @param entry The menu entry to drop the stubs of
+ * @return Returns no value
+ * @brief Drops the stubs of @a entry and its sub menus, so nothing refers to
+ * the menu tree they were laid out from anymore. Sub menus which weren't laid
+ * out are left empty.
+ */
+static void
+efreet_menu_stubs_del(Efreet_Menu *entry)
+{
+    Efreet_Menu *sub;
+    Eina_List *l;
+
+    if (!efreet_menu_stubs) return;
+    if (eina_hash_find(efreet_menu_stubs, &entry))
+    {
+        eina_hash_del_by_key(efreet_menu_stubs, &entry);
+        return;
+    }
+    EINA_LIST_FOREACH(entry->entries, l, sub)
+    {
+        if (sub->type == EFREET_MENU_ENTRY_MENU)
+            efreet_menu_stubs_del(sub);
+    }
+}
+
+/**
+ * @internal
+ * @param entry The menu entry to update
+ * @param update The new layout of @a entry
+ * @param changed The list to append changed entries to
+ * @return Returns no value
+ * @brief Moves the changes in @a update over to @a entry. Entries still in
+ * the menu are kept, new ones are taken from @a update and those gone are
+ * freed. @a update is left without entries.
+ */
+static void
+efreet_menu_update_merge(Efreet_Menu *entry, Efreet_Menu *update, Eina_List **changed)
+{
+    Efreet_Menu_Internal *internal = NULL;
+    Efreet_Menu *sub, *old;
+    Eina_List *olds, *l;
+    int dirty;
+
+    if (efreet_menu_stubs) internal = eina_hash_find(efreet_menu_stubs, &update);
+    if (internal && eina_hash_find(efreet_menu_stubs, &entry))
+    {
+        /* neither is laid out, the old stub lays out the new tree */
+        eina_hash_set(efreet_menu_stubs, &entry, internal);
+        if (efreet_menu_update_fields(entry, update))
+            *changed = eina_list_append(*changed, entry);
+        return;
+    }
+    if (internal)
+        efreet_menu_entries_get(update);
+    else if (efreet_menu_stubs)
+        eina_hash_del_by_key(efreet_menu_stubs, &entry);
+
+    dirty = efreet_menu_update_fields(entry, update);
+
+    olds = entry->entries;
+    entry->entries = NULL;
+    EINA_LIST_FREE(update->entries, sub)
+    {
+        l = eina_list_search_unsorted_list(olds,
+                                           EINA_COMPARE_CB(efreet_menu_cb_entry_compare_same),
+                                           sub);
+        if (!l)
+        {
+            entry->entries = eina_list_append(entry->entries, sub);
+            dirty = 1;
+            continue;
+        }
+
+        /* an entry found further down has been moved */
+        if (l != olds) dirty = 1;
+        old = eina_list_data_get(l);
+        olds = eina_list_remove_list(olds, l);
+
+        if (old->type == EFREET_MENU_ENTRY_MENU)
+            efreet_menu_update_merge(old, sub, changed);
+        else if (efreet_menu_update_fields(old, sub))
+            *changed = eina_list_append(*changed, old);
+        efreet_menu_free(sub);
+        entry->entries = eina_list_append(entry->entries, old);
+    }
+
+    /* what is left has gone from the menu */
+    if (olds) dirty = 1;
+    EINA_LIST_FREE(olds, old)
+        efreet_menu_free(old);
+
+    if (dirty) *changed = eina_list_append(*changed, entry);
+}
+
+/**
+ * @internal
+ * @param entry The menu entry to update
+ * @param update The new version of @a entry
+ * @return Returns 1 if @a entry changed, 0 otherwise
+ * @brief Swaps the name, icon and desktop of @a entry with those of
+ * @a update where they differ
+ */
+static int
+efreet_menu_update_fields(Efreet_Menu *entry, Efreet_Menu *update)
+{
+    const char *tmp;
+    Efreet_Desktop *desktop;
+    int ret = 0;
+
+    if (entry->name != update->name)
+    {
+        tmp = entry->name;
+        entry->name = update->name;
+        update->name = tmp;
+        ret = 1;
+    }
+    if (entry->icon != update->icon)
+    {
+        tmp = entry->icon;
+        entry->icon = update->icon;
+        update->icon = tmp;
+        ret = 1;
+    }
+    if (entry->desktop != update->desktop)
+    {
+        desktop = entry->desktop;
+        entry->desktop = update->desktop;
+        update->desktop = desktop;
+        ret = 1;
+    }
+    return ret;
+}
+
+static int
+efreet_menu_cb_entry_compare_same(Efreet_Menu *entry, Efreet_Menu *update)
+{
+    if (entry->type != update->type) return 1;
+    if (entry->type == EFREET_MENU_ENTRY_SEPARATOR) return 0;
+    if (entry->type == EFREET_MENU_ENTRY_HEADER) return (entry->name != update->name);
+    return (entry->id != update->id);
+}
+
+/**
+ * @internal
+ * @param internal The menu to work with
+ * @return Returns the layout rules of @a internal or NULL to use the default
+ * layout
+ * @brief Finds the Layout of @a internal or the closest DefaultLayout
+ */
+static Eina_List *
+efreet_menu_layout_rules_get(Efreet_Menu_Internal *internal)
+{
+    Efreet_Menu_Internal *parent;
+    Eina_List *layout = NULL;
+
+    if (internal->layout) return internal->layout;
+
+    for (parent = internal->parent; parent && !layout; parent = parent->parent)
+        layout = parent->default_layout;
+    return layout;
+}
+
+/**
+ * @internal
+ * @param internal The menu to work with
+ * @return Returns 1 if laying out @a internal gives no menus and no
+ * desktops, 0 otherwise
+ * @brief Works out whether a menu is empty from its layout rules, without
+ * laying it out
+ */
+static int
+efreet_menu_layout_internal_is_empty(Efreet_Menu_Internal *internal)
+{
+    Efreet_Menu_Internal *sub;
+    Efreet_Menu_Layout *lay;
+    Eina_List *layout, *l, *ll;
+    int show_empty;
+
+    layout = efreet_menu_layout_rules_get(internal);
+    if (!layout)
+    {
+        /* Default layout, first menus, then desktop */
+        if (internal->applications) return 0;
+        EINA_LIST_FOREACH(internal->sub_menus, l, sub)
+        {
+            if ((sub->directory && sub->directory->no_display) || sub->deleted) continue;
+            if (!efreet_menu_layout_internal_is_empty(sub)) return 0;
+        }
+        return 1;
+    }
+
+    EINA_LIST_FOREACH(layout, l, lay)
+    {
+        if (lay->type == EFREET_MENU_LAYOUT_FILENAME)
+        {
+            if (eina_list_search_unsorted(internal->applications,
+                                          EINA_COMPARE_CB(efreet_menu_cb_md_compare_ids),
+                                          lay->name))
+                return 0;
+        }
+        else if (lay->type == EFREET_MENU_LAYOUT_MENUNAME)
+        {
+            sub = efreet_menu_sub_menu_find(internal, lay->name);
+            if (!sub || (sub->directory && sub->directory->no_display) || sub->deleted)
+                continue;
+
+            /* a shown menu is a menu entry or its inlined entries */
+            if (lay->show_empty == -1) show_empty = efreet_menu_show_empty_get(internal);
+            else show_empty = lay->show_empty;
+            if (show_empty || !efreet_menu_layout_internal_is_empty(sub)) return 0;
+        }
+        else if (lay->type == EFREET_MENU_LAYOUT_MERGE)
+        {
+            if (internal->applications && !strcmp(lay->name, "files")) return 0;
+            if (!internal->sub_menus) continue;
+            if (internal->applications && !strcmp(lay->name, "all")) return 0;
+            if (strcmp(lay->name, "menus") && strcmp(lay->name, "all")) continue;
+
+            show_empty = efreet_menu_show_empty_get(internal);
+            EINA_LIST_FOREACH(internal->sub_menus, ll, sub)
+            {
+                if ((sub->directory && sub->directory->no_display) || sub->deleted) continue;
+                if (show_empty || !efreet_menu_layout_internal_is_empty(sub)) return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/**
+ * @internal
+ * @param internal The menu to work with
+ * @return Returns the show_empty rule of @a internal
+ * @brief Looks up show_empty the way layout inherits it, without changing
+ * the menu
+ */
+static int
+efreet_menu_show_empty_get(Efreet_Menu_Internal *internal)
+{
+    while ((internal->show_empty == -1) && internal->parent)
+        internal = internal->parent;
+    return internal->show_empty;
+}
@@ -40,9 +40,17 @@ struct Efreet_Menu
     const char *icon; /**< Icon for this entry */
 
     Efreet_Desktop *desktop;   /**< The desktop we refer too */
-    Eina_List      *entries;   /**< The menu items */
+    Eina_List      *entries;   /**< The menu items, see efreet_menu_entries_get() */
 };
 
+/**
+ * Efreet_Menu_Cb
+ * Gets the menu built by efreet_menu_get_async(), or NULL on failure. The
+ * menu is owned by the callback.
+ * @since 1.7
+ */
+typedef void (*Efreet_Menu_Cb) (void *data, Efreet_Menu *menu);
+
 
 /**
  * @return Returns no value
@@ -68,6 +76,16 @@ EAPI Efreet_Menu     *efreet_menu_new(const char *name);
  */
 EAPI void             efreet_menu_file_set(const char *file);
 
+/**
+ * @param lazy Whether menus are laid out lazily
+ * @return Returns no value
+ * @brief Sets whether efreet_menu_get() and efreet_menu_parse() lay out sub
+ * menus only when their entries are asked for. Entries of sub menus in a
+ * lazy menu must be read with efreet_menu_entries_get().
+ * @since 1.7
+ */
+EAPI void             efreet_menu_lazy_set(Eina_Bool lazy);
+
 /**
  * @return Returns the Efreet_Menu_Internal representation of the default menu or
  * NULL if none found
@@ -75,6 +93,20 @@ EAPI void             efreet_menu_file_set(const char *file);
  */
 EAPI Efreet_Menu     *efreet_menu_get(void);
 
+/**
+ * @param cb The function to call with the menu
+ * @param data The data to pass to @a cb
+ * @return Returns EINA_FALSE if there's no default menu, then @a cb isn't
+ * called
+ * @brief Builds the default menu like efreet_menu_get(), but reads and
+ * processes the menu files in a thread. @a cb is called on the main loop,
+ * always after this function returned, also when threads aren't available
+ * and the build runs right away. It gets NULL if the build fails or is
+ * cancelled by efreet_shutdown().
+ * @since 1.7
+ */
+EAPI Eina_Bool        efreet_menu_get_async(Efreet_Menu_Cb cb, const void *data);
+
 /**
  * @param path The path of the menu to load
  * @return Returns the Efreet_Menu_Internal representation on success or NULL on
@@ -83,6 +115,26 @@ EAPI Efreet_Menu     *efreet_menu_get(void);
  */
 EAPI Efreet_Menu     *efreet_menu_parse(const char *path);
 
+/**
+ * @param menu The menu to update, as returned by efreet_menu_get() or
+ * efreet_menu_parse()
+ * @param changes The changes sent with EFREET_EVENT_DESKTOP_CACHE_UPDATE or
+ * NULL if not known
+ * @return Returns the menu entries which changed. The list must be freed
+ * with eina_list_free(), the entries belong to @a menu.
+ * @brief Updates @a menu after the desktop cache changed. Entries which are
+ * still in the menu are kept, so a UI only has to redraw the entries
+ * returned. A menu entry is returned when its entries changed, and any entry
+ * is returned when its name, icon or desktop changed. Entries which left
+ * the menu are freed.
+ *
+ * The first update reads the menu file again. Later updates only rebuild
+ * the menus which read one of the changed desktops.
+ * @since 1.7
+ */
+EAPI Eina_List       *efreet_menu_update(Efreet_Menu *menu,
+                                            Efreet_Cache_Changes *changes);
+
 /**
  * @param menu The menu to work with
  * @param path The path where the menu should be saved
@@ -98,6 +150,16 @@ EAPI int              efreet_menu_save(Efreet_Menu *menu, const char *path);
  */
 EAPI void             efreet_menu_free(Efreet_Menu *menu);
 
+/**
+ * @param menu The menu to work with
+ * @return Returns the entries of @a menu
+ * @brief Returns the entries of @a menu, laying them out first if @a menu
+ * is a sub menu of a lazy menu which hasn't been opened yet. Sub menus in
+ * the returned entries may again not be laid out.
+ * @since 1.7
+ */
+EAPI Eina_List       *efreet_menu_entries_get(Efreet_Menu *menu);
+
 
 /**
  * @param menu The menu to work with
@@ -79,6 +79,12 @@
     (x) = NULL; \
 } while (0)
 
+/**
+ * @def EFREET_EXEC_OP
+ * Marks a field code in a compiled Exec template, the code follows it
+ */
+#define EFREET_EXEC_OP '\001'
+
 #ifdef EFREET_DEFAULT_LOG_COLOR
 #undef EFREET_DEFAULT_LOG_COLOR
 #endif
@@ -169,6 +175,7 @@ void efreet_cache_shutdown(void);
 
 int efreet_icon_init(void);
 void efreet_icon_shutdown(void);
+void efreet_icon_changes_listen(void);
 
 int efreet_menu_init(void);
 void efreet_menu_shutdown(void);
@@ -178,9 +185,11 @@ EAPI Eina_List *efreet_default_dirs_get(const char *user_dir,
 
 int efreet_ini_init(void);
 void efreet_ini_shutdown(void);
+Efreet_Ini *efreet_ini_desktop_new(const char *file);
 
 int efreet_desktop_init(void);
 void efreet_desktop_shutdown(void);
+void efreet_desktop_changes_listen(void);
 
 int efreet_util_init(void);
 int efreet_util_shutdown(void);
@@ -196,16 +205,39 @@ size_t efreet_array_cat(char *buffer, size_t size, const char *strs[]);
 
 void efreet_cache_desktop_update(void);
 void efreet_cache_icon_update(void);
+Eina_Bool efreet_cache_watch_budget_get(void);
+Eina_Bool efreet_cache_watch_owner_get(void);
 
 Efreet_Desktop *efreet_cache_desktop_find(const char *file);
+Efreet_Desktop *efreet_cache_desktop_real_find(const char *rp);
+Efreet_Desktop *efreet_desktop_real_get(const char *rp);
 void efreet_cache_desktop_free(Efreet_Desktop *desktop);
-void efreet_cache_desktop_add(Efreet_Desktop *desktop);
+void efreet_cache_desktop_cold_load(Efreet_Desktop *desktop);
+void efreet_cache_desktop_cold_expand(Efreet_Desktop *desktop);
+Eina_Bool efreet_cache_desktop_x_field_find(Efreet_Desktop *desktop, const char *key,
+                                            const char **value);
+Eina_Bool efreet_cache_desktop_category_count(Efreet_Desktop *desktop, unsigned int *count);
+void efreet_cache_desktop_lazy_set(Eina_Bool lazy);
+void efreet_cache_desktop_compact_set(Eina_Bool compact);
+void efreet_cache_desktop_dir_add(const char *dir);
+const char *efreet_cache_desktop_exec_template(Efreet_Desktop *desktop, int *flags);
+const char *efreet_cache_desktop_collate_key(Efreet_Desktop *desktop);
 Efreet_Cache_Array_String *efreet_cache_desktop_dirs(void);
+long long efreet_cache_desktop_generation(void);
+
+Eina_Hash *efreet_cache_menu_inputs_new(void);
+void efreet_cache_menu_input_add(Eina_Hash *inputs, const char *path);
+Efreet_Menu *efreet_cache_menu_find(const char *path, const char *prefix);
+void efreet_cache_menu_save(const char *path, const char *prefix,
+                            Efreet_Menu *menu, Eina_Hash *inputs,
+                            long long generation);
 
 Efreet_Cache_Icon *efreet_cache_icon_find(Efreet_Icon_Theme *theme, const char *icon);
 Efreet_Cache_Fallback_Icon *efreet_cache_icon_fallback_find(const char *icon);
 Efreet_Icon_Theme *efreet_cache_icon_theme_find(const char *theme);
 Eina_List *efreet_cache_icon_theme_list(void);
+Eina_List *efreet_cache_icon_theme_summary_list(void);
+Efreet_Cache_Array_String *efreet_cache_icon_extra_dirs(void);
 
 Efreet_Cache_Hash *efreet_cache_util_hash_string(const char *key);
 Efreet_Cache_Hash *efreet_cache_util_hash_array_string(const char *key);
@@ -214,6 +246,9 @@ Efreet_Cache_Array_String *efreet_cache_util_names(const char *key);
 EAPI void efreet_cache_array_string_free(Efreet_Cache_Array_String *array);
 
 EAPI void efreet_hash_free(Eina_Hash *hash, Eina_Free_Cb free_cb);
+EAPI char *efreet_desktop_exec_compile(const char *exec, const char *path, int *flags);
+EAPI Eina_Bool efreet_util_wm_class_normalize(const char *str, char *buf, size_t size);
+EAPI char *efreet_collate_key_new(const char *str);
 EAPI void efreet_setowner(const char *path);
 EAPI void efreet_fsetowner(int fd);
 
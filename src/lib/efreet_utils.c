@@ -23,6 +23,8 @@ void *alloca (size_t);
 #endif
 
 #include <fnmatch.h>
+#include <ctype.h>
+#include <locale.h>
 
 #include <Ecore_File.h>
 
@@ -154,6 +156,38 @@ efreet_util_desktop_wm_class_find(const char *wmname, const char *wmclass)
     return efreet_util_cache_find("startup_wm_class", wmname, wmclass);
 }
 
+EAPI Efreet_Desktop *
+efreet_util_desktop_wm_class_match(const char *wmname, const char *wmclass)
+{
+    Efreet_Desktop *ret;
+    char name[PATH_MAX], klass[PATH_MAX];
+    const char *n = NULL, *c = NULL;
+    const char *tags = "wie";
+    int i;
+
+    EINA_SAFETY_ON_TRUE_RETURN_VAL((!wmname) && (!wmclass), NULL);
+
+    ret = efreet_util_cache_find("startup_wm_class", wmname, wmclass);
+    if (ret) return ret;
+
+    /* The index keys are a tag, ':' and the normalized name */
+    if (wmname && efreet_util_wm_class_normalize(wmname, name + 2, sizeof(name) - 2))
+        n = name;
+    if (wmclass && efreet_util_wm_class_normalize(wmclass, klass + 2, sizeof(klass) - 2))
+        c = klass;
+    if (!n && !c) return NULL;
+    name[1] = klass[1] = ':';
+
+    /* StartupWMClass, then file id stems, then exec basenames */
+    for (i = 0; tags[i]; i++)
+    {
+        name[0] = klass[0] = tags[i];
+        ret = efreet_util_cache_find("wm_class_index", n, c);
+        if (ret) return ret;
+    }
+    return NULL;
+}
+
 EAPI Efreet_Desktop *
 efreet_util_desktop_file_id_find(const char *file_id)
 {
@@ -486,3 +520,69 @@ efreet_hash_free(Eina_Hash *hash, Eina_Free_Cb free_cb)
     eina_hash_free(hash);
 }
 
+/*
+ * Needs EAPI because of helper binaries
+ */
+EAPI Eina_Bool
+efreet_util_wm_class_normalize(const char *str, char *buf, size_t size)
+{
+    char *p;
+    size_t len;
+    int dots = 0;
+
+    if (!str || !str[0]) return EINA_FALSE;
+    len = eina_strlcpy(buf, str, size);
+    if (len >= size) return EINA_FALSE;
+    for (p = buf; *p; p++)
+        *p = tolower((unsigned char)*p);
+
+    /* Strip a version suffix, "gimp-2.8" */
+    p = buf + len;
+    while ((p > buf) && (isdigit((unsigned char)p[-1]) || (p[-1] == '.'))) p--;
+    if ((p > buf + 1) && (*p) && ((p[-1] == '-') || (p[-1] == '_')))
+        p[-1] = '\0';
+
+    /* Strip a reverse DNS prefix, "org.gnome.nautilus" */
+    for (p = buf; *p; p++)
+        if (*p == '.') dots++;
+    p = strchr(buf, '.');
+    if ((dots >= 2) && (p - buf >= 2) && (p - buf <= 3))
+    {
+        p = strrchr(buf, '.');
+        memmove(buf, p + 1, strlen(p + 1) + 1);
+    }
+
+    return buf[0] != '\0';
+}
+
+/*
+ * Needs EAPI because of helper binaries
+ *
+ * Returns a key which sorts with strcmp() as str sorts in the current
+ * LC_COLLATE locale. The C locale collates by byte value, there the key
+ * keeps the case insensitive order menus always had.
+ */
+EAPI char *
+efreet_collate_key_new(const char *str)
+{
+    const char *locale;
+    char *key, *p;
+    size_t len;
+
+    if (!str) return NULL;
+    locale = setlocale(LC_COLLATE, NULL);
+    if (!locale || !strcmp(locale, "C") || !strcmp(locale, "POSIX"))
+    {
+        key = strdup(str);
+        if (!key) return NULL;
+        for (p = key; *p; p++)
+            *p = tolower((unsigned char)*p);
+        return key;
+    }
+
+    len = strxfrm(NULL, str, 0);
+    key = malloc(len + 1);
+    if (!key) return NULL;
+    strxfrm(key, str, len + 1);
+    return key;
+}
@@ -44,6 +44,23 @@ EAPI Eina_List *efreet_util_desktop_mime_list(const char *mime);
  */
 EAPI Efreet_Desktop *efreet_util_desktop_wm_class_find(const char *wmname, const char *wmclass);
 
+/**
+ * Find the desktop which best matches a window
+ *
+ * Tries an exact StartupWMClass match first, then compares the normalized
+ * names against StartupWMClass, desktop file ids and exec basenames, in
+ * that order. Normalized names are lowercased, with a reverse DNS prefix
+ * and a version suffix removed.
+ *
+ * The returned desktop must be freed using efreet_desktop_free
+ *
+ * @param wmname the wm name
+ * @param wmclass the wm class
+ * @return the best matching desktop, or NULL
+ * @since 1.7
+ */
+EAPI Efreet_Desktop *efreet_util_desktop_wm_class_match(const char *wmname, const char *wmclass);
+
 /**
  * Find a desktop by file id
  *
@@ -18,26 +18,75 @@ static int _efreet_xml_log_dom = -1;
 #include "efreet_private.h"
 #include "efreet_xml.h"
 
+typedef struct Efreet_Xml_Chunk Efreet_Xml_Chunk;
+typedef struct Efreet_Xml_Document Efreet_Xml_Document;
+typedef struct Efreet_Xml_Frame Efreet_Xml_Frame;
+
+/* A block of memory the nodes and strings of a document are carved from */
+struct Efreet_Xml_Chunk
+{
+    Efreet_Xml_Chunk *next;     /**< The previous chunk of the document */
+    size_t size;                /**< Usable bytes after the header */
+    size_t used;                /**< Bytes handed out */
+};
+
+/*
+ * A parsed file. The root node comes first, so the Efreet_Xml handed out
+ * for a document is the document. Documents are shared through the cache
+ * until the file changes.
+ */
+struct Efreet_Xml_Document
+{
+    Efreet_Xml xml;             /**< The root node */
+    time_t mtime;               /**< The mtime of the file when parsed */
+    off_t size;                 /**< The size of the file when parsed */
+    int ref;                    /**< Users of the document, the cache included */
+    Efreet_Xml_Chunk *chunks;   /**< The arena, newest chunk first */
+    int error;                  /**< Set when the markup is broken */
+};
+
+/* An element whose children are being parsed */
+struct Efreet_Xml_Frame
+{
+    Efreet_Xml *xml;            /**< The open element */
+    unsigned int first;         /**< Its first child on the pending stack */
+};
+
+#define EFREET_XML_ALIGN(s) (((s) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+#define EFREET_XML_CHUNK_SIZE 4096
+
 #if 0
 static void efreet_xml_dump(Efreet_Xml *xml, int level);
 #endif
 
-static Efreet_Xml *efreet_xml_parse(char **data, int *size);
-static int efreet_xml_tag_parse(char **data, int *size, const char **tag);
-static void efreet_xml_attributes_parse(char **data, int *size,
+static Efreet_Xml_Document *efreet_xml_document_new(struct stat *st);
+static void efreet_xml_document_unref(Efreet_Xml_Document *doc);
+static void *efreet_xml_alloc(Efreet_Xml_Document *doc, size_t size);
+static const char *efreet_xml_strndup(Efreet_Xml_Document *doc, const char *str, size_t len);
+
+static int efreet_xml_parse(Efreet_Xml_Document *doc, char **data, int *size);
+static Efreet_Xml *efreet_xml_element_parse(Efreet_Xml_Document *doc, Efreet_Xml *xml,
+                                            char **data, int *size, int *open);
+static int efreet_xml_tag_parse(Efreet_Xml_Document *doc, char **data, int *size,
+                                const char **tag);
+static void efreet_xml_attributes_parse(Efreet_Xml_Document *doc, char **data, int *size,
                                         Efreet_Xml_Attribute ***attributes);
-static void efreet_xml_text_parse(char **data, int *size, const char **text);
+static void efreet_xml_text_parse(Efreet_Xml_Document *doc, char **data, int *size,
+                                  const char **text);
 
-static int efreet_xml_tag_empty(char **data, int *size);
-static int efreet_xml_tag_close(char **data, int *size, const char *tag);
+static int efreet_xml_tag_empty(Efreet_Xml_Document *doc, char **data, int *size);
+static int efreet_xml_tag_close(Efreet_Xml_Document *doc, char **data, int *size,
+                                const char *tag);
 
-static void efreet_xml_cb_attribute_free(void *data);
 static void efreet_xml_comment_skip(char **data, int *size);
 
-static int error = 0;
-
 static int _efreet_xml_init_count = 0;
 
+/* Menus are built in threads as well, the lock covers the cache and the
+ * references to the shared documents */
+static Eina_Hash *efreet_xml_cache = NULL; /**< path -> Efreet_Xml_Document */
+static Eina_Lock efreet_xml_lock;
+
 /**
  * @internal
  * @return Returns > 0 on success or 0 on failure
@@ -56,6 +105,7 @@ efreet_xml_init(void)
         EINA_LOG_ERR("Efreet: Could not create a log domain for efreet_xml.");
         return _efreet_xml_init_count;
     }
+    eina_lock_new(&efreet_xml_lock);
     return _efreet_xml_init_count;
 }
 
@@ -69,6 +119,8 @@ efreet_xml_shutdown(void)
 {
     _efreet_xml_init_count--;
     if (_efreet_xml_init_count > 0) return;
+    IF_FREE_HASH(efreet_xml_cache);
+    eina_lock_free(&efreet_xml_lock);
     eina_log_domain_unregister(_efreet_xml_log_dom);
     _efreet_xml_log_dom = -1;
 }
@@ -78,19 +130,35 @@ efreet_xml_shutdown(void)
  * @param file The file to parse
  * @return Returns an Efreet_Xml structure for the given file @a file or
  * NULL on failure
- * @brief Parses the given file into an Efreet_Xml structure.
+ * @brief Parses the given file into an Efreet_Xml structure. As long as the
+ * file doesn't change, the same read only tree is returned for it.
  */
 Efreet_Xml *
 efreet_xml_new(const char *file)
 {
-    Efreet_Xml *xml = NULL;
-    int size, fd = -1;
-    char *data = MAP_FAILED;
+    Efreet_Xml_Document *doc = NULL;
+    struct stat st;
+    int size, left, fd = -1;
+    char *data = MAP_FAILED, *p;
 
     if (!file) return NULL;
-    if (!ecore_file_exists(file)) return NULL;
+    if (stat(file, &st) == -1) return NULL;
+
+    eina_lock_take(&efreet_xml_lock);
+    if (efreet_xml_cache)
+    {
+        doc = eina_hash_find(efreet_xml_cache, file);
+        if (doc && (doc->mtime == st.st_mtime) && (doc->size == st.st_size))
+        {
+            doc->ref++;
+            eina_lock_release(&efreet_xml_lock);
+            return &(doc->xml);
+        }
+        doc = NULL;
+    }
+    eina_lock_release(&efreet_xml_lock);
 
-    size = ecore_file_size(file);
+    size = st.st_size;
     if (size <= 0) goto efreet_error;
 
     fd = open(file, O_RDONLY);
@@ -102,19 +170,37 @@ efreet_xml_new(const char *file)
     data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
     if (data == MAP_FAILED) goto efreet_error;
 
-    error = 0;
-    xml = efreet_xml_parse(&data, &size);
-    if (!xml || error) goto efreet_error;
+    doc = efreet_xml_document_new(&st);
+    if (!doc) goto efreet_error;
+
+    /* the parser moves through the map, keep the map itself for munmap */
+    p = data;
+    left = size;
+    if (!efreet_xml_parse(doc, &p, &left) || doc->error) goto efreet_error;
 
     munmap(data, size);
     close(fd);
-    return xml;
+
+    /* the cache keeps a reference until the file changes */
+    eina_lock_take(&efreet_xml_lock);
+    if (!efreet_xml_cache)
+        efreet_xml_cache = eina_hash_string_superfast_new(EINA_FREE_CB(efreet_xml_document_unref));
+    if (efreet_xml_cache)
+    {
+        Efreet_Xml_Document *old;
+
+        doc->ref++;
+        old = eina_hash_set(efreet_xml_cache, file, doc);
+        if (old) efreet_xml_document_unref(old);
+    }
+    eina_lock_release(&efreet_xml_lock);
+    return &(doc->xml);
 
 efreet_error:
     ERR("could not parse xml file");
     if (data != MAP_FAILED) munmap(data, size);
     if (fd != -1) close(fd);
-    if (xml) efreet_xml_del(xml);
+    if (doc) efreet_xml_document_unref(doc);
     return NULL;
 }
 
@@ -122,31 +208,15 @@ efreet_error:
  * @internal
  * @param xml The Efree_Xml to free
  * @return Returns no value
- * @brief Frees up the given Efreet_Xml structure
+ * @brief Releases the given tree from efreet_xml_new()
  */
 void
 efreet_xml_del(Efreet_Xml *xml)
 {
-    IF_FREE_LIST(xml->children, efreet_xml_cb_attribute_free);
-
-    if (xml->tag) eina_stringshare_del(xml->tag);
-    if (xml->attributes)
-    {
-        Efreet_Xml_Attribute **curr;
-
-        curr = xml->attributes;
-        while (*curr)
-        {
-            eina_stringshare_del((*curr)->key);
-            eina_stringshare_del((*curr)->value);
-
-            FREE(*curr);
-            curr++;
-        }
-        FREE(xml->attributes);
-    }
-    IF_RELEASE(xml->text);
-    FREE(xml);
+    if (!xml) return;
+    eina_lock_take(&efreet_xml_lock);
+    efreet_xml_document_unref((Efreet_Xml_Document *)xml);
+    eina_lock_release(&efreet_xml_lock);
 }
 
 /**
@@ -170,10 +240,117 @@ efreet_xml_attribute_get(Efreet_Xml *xml, const char *key)
     return NULL;
 }
 
+/**
+ * @internal
+ * @param st The stat of the file the document is parsed from
+ * @return Returns a new, empty document or NULL on failure
+ * @brief Creates a document with an arena sized after the file
+ */
+static Efreet_Xml_Document *
+efreet_xml_document_new(struct stat *st)
+{
+    Efreet_Xml_Document *doc;
+    Efreet_Xml_Chunk *chunk;
+    size_t size;
+
+    doc = NEW(Efreet_Xml_Document, 1);
+    if (!doc) return NULL;
+    doc->mtime = st->st_mtime;
+    doc->size = st->st_size;
+    doc->ref = 1;
+
+    /* tags and text are copied, and a node takes about as much as its markup */
+    size = EFREET_XML_ALIGN((size_t)st->st_size * 2);
+    if (size < EFREET_XML_CHUNK_SIZE) size = EFREET_XML_CHUNK_SIZE;
+    chunk = malloc(sizeof(Efreet_Xml_Chunk) + size);
+    if (!chunk)
+    {
+        efreet_xml_document_unref(doc);
+        return NULL;
+    }
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    doc->chunks = chunk;
+
+    return doc;
+}
+
+/**
+ * @internal
+ * @param doc The document to release
+ * @return Returns no value
+ * @brief Drops a reference to @a doc and frees it with the last one
+ */
 static void
-efreet_xml_cb_attribute_free(void *data)
+efreet_xml_document_unref(Efreet_Xml_Document *doc)
 {
-    efreet_xml_del(data);
+    Efreet_Xml_Chunk *chunk;
+
+    doc->ref--;
+    if (doc->ref > 0) return;
+
+    while ((chunk = doc->chunks))
+    {
+        doc->chunks = chunk->next;
+        free(chunk);
+    }
+    FREE(doc);
+}
+
+/**
+ * @internal
+ * @param doc The document to allocate for
+ * @param size The number of bytes needed
+ * @return Returns zeroed memory which lives as long as @a doc or NULL on
+ * failure
+ * @brief Carves @a size bytes out of the arena of @a doc
+ */
+static void *
+efreet_xml_alloc(Efreet_Xml_Document *doc, size_t size)
+{
+    Efreet_Xml_Chunk *chunk;
+    void *ret;
+
+    size = EFREET_XML_ALIGN(size);
+    chunk = doc->chunks;
+    if (chunk->size - chunk->used < size)
+    {
+        size_t chunk_size;
+
+        chunk_size = chunk->size * 2;
+        if (chunk_size < size) chunk_size = size;
+        chunk = malloc(sizeof(Efreet_Xml_Chunk) + chunk_size);
+        if (!chunk) return NULL;
+        chunk->next = doc->chunks;
+        chunk->size = chunk_size;
+        chunk->used = 0;
+        doc->chunks = chunk;
+    }
+
+    ret = (char *)(chunk + 1) + chunk->used;
+    chunk->used += size;
+    memset(ret, 0, size);
+    return ret;
+}
+
+/**
+ * @internal
+ * @param doc The document to allocate for
+ * @param str The string to copy
+ * @param len The length of @a str
+ * @return Returns a nul terminated copy of @a str or NULL on failure
+ * @brief Copies a string into the arena of @a doc
+ */
+static const char *
+efreet_xml_strndup(Efreet_Xml_Document *doc, const char *str, size_t len)
+{
+    char *ret;
+
+    ret = efreet_xml_alloc(doc, len + 1);
+    if (!ret) return NULL;
+    memcpy(ret, str, len);
+    return ret;
 }
 
 #if 0
@@ -194,13 +371,12 @@ efreet_xml_dump(Efreet_Xml *xml, int level)
 
     if (xml->children)
     {
-        Efreet_Xml *child;
-        Eina_List *l;
+        Efreet_Xml **child;
 
         printf(">");
 
-        EINA_LIST_FOREACH(xml->children, l, child)
-            efreet_xml_dump(child, level + 1);
+        for (child = xml->children; *child; child++)
+            efreet_xml_dump(*child, level + 1);
 
         for (i = 0; i < level; i++)
             printf("\t");
@@ -213,47 +389,139 @@ efreet_xml_dump(Efreet_Xml *xml, int level)
 }
 #endif
 
+/**
+ * @internal
+ * @param doc The document to parse into
+ * @param data The markup
+ * @param size The size of @a data
+ * @return Returns 1 on success or 0 on failure
+ * @brief Parses the root element of @a data into @a doc. Open elements are
+ * kept on a stack instead of recursing, and finished children wait on a
+ * second stack until their parent closes and gets them as one array.
+ */
+static int
+efreet_xml_parse(Efreet_Xml_Document *doc, char **data, int *size)
+{
+    Efreet_Xml_Frame *frames = NULL, *frame;
+    Efreet_Xml **pending = NULL, *xml;
+    unsigned int depth = 0, frames_size = 0;
+    unsigned int count = 0, pending_size = 0;
+    int open, ret = 0;
+
+    if (!efreet_xml_element_parse(doc, &(doc->xml), data, size, &open)) return 0;
+    if (!open) return 1;
+    xml = &(doc->xml);
+
+    while (1)
+    {
+        if (xml)
+        {
+            /* open element, its children come next */
+            if (depth == frames_size)
+            {
+                Efreet_Xml_Frame *tmp;
+
+                frames_size += 16;
+                tmp = realloc(frames, frames_size * sizeof(Efreet_Xml_Frame));
+                if (!tmp) goto end;
+                frames = tmp;
+            }
+            frames[depth].xml = xml;
+            frames[depth].first = count;
+            depth++;
+        }
+
+        frame = &(frames[depth - 1]);
+        xml = efreet_xml_element_parse(doc, NULL, data, size, &open);
+        if (doc->error) goto end;
+
+        if (!xml)
+        {
+            /* no more children, close the element */
+            efreet_xml_tag_close(doc, data, size, frame->xml->tag);
+            if (count > frame->first)
+            {
+                frame->xml->children = efreet_xml_alloc(doc,
+                        (count - frame->first + 1) * sizeof(Efreet_Xml *));
+                if (!frame->xml->children) goto end;
+                memcpy(frame->xml->children, pending + frame->first,
+                       (count - frame->first) * sizeof(Efreet_Xml *));
+                frame->xml->children_count = count - frame->first;
+                count = frame->first;
+            }
+            xml = frame->xml;
+            depth--;
+            if (!depth) break;
+        }
+        else if (open) continue;
+
+        /* a finished child of the element on top of the stack */
+        if (count == pending_size)
+        {
+            Efreet_Xml **tmp;
+
+            pending_size += 32;
+            tmp = realloc(pending, pending_size * sizeof(Efreet_Xml *));
+            if (!tmp) goto end;
+            pending = tmp;
+        }
+        pending[count++] = xml;
+        xml = NULL;
+    }
+    ret = 1;
+
+end:
+    free(frames);
+    free(pending);
+    return ret;
+}
+
+/**
+ * @internal
+ * @param doc The document to parse into
+ * @param xml The node to fill in, or NULL to allocate one
+ * @param data The markup
+ * @param size The size of @a data
+ * @param open Returns 1 if the element has children to parse
+ * @return Returns the element or NULL if there is none before the end tag
+ * of the parent
+ * @brief Parses the start tag of an element, its attributes and its text
+ */
 static Efreet_Xml *
-efreet_xml_parse(char **data, int *size)
+efreet_xml_element_parse(Efreet_Xml_Document *doc, Efreet_Xml *xml,
+                            char **data, int *size, int *open)
 {
-    Efreet_Xml *xml, *sub_xml;
     const char *tag = NULL;
 
+    *open = 0;
+
     /* parse this tag */
-    if (!efreet_xml_tag_parse(data, size, &(tag))) return NULL;
-    xml = NEW(Efreet_Xml, 1);
+    if (!efreet_xml_tag_parse(doc, data, size, &(tag))) return NULL;
+    if (!xml) xml = efreet_xml_alloc(doc, sizeof(Efreet_Xml));
     if (!xml)
     {
-        eina_stringshare_del(tag);
+        doc->error = 1;
         return NULL;
     }
 
-    xml->children = NULL;
-
     xml->tag = tag;
-    efreet_xml_attributes_parse(data, size, &(xml->attributes));
+    efreet_xml_attributes_parse(doc, data, size, &(xml->attributes));
 
     /* Check wether element is empty */
-    if (efreet_xml_tag_empty(data, size)) return xml;
-    efreet_xml_text_parse(data, size, &(xml->text));
+    if (efreet_xml_tag_empty(doc, data, size)) return xml;
+    efreet_xml_text_parse(doc, data, size, &(xml->text));
 
     /* Check wether element is closed */
-    if (efreet_xml_tag_close(data, size, xml->tag)) return xml;
-
-    while ((sub_xml = efreet_xml_parse(data, size)))
-        xml->children = eina_list_append(xml->children, sub_xml);
-
-    efreet_xml_tag_close(data, size, xml->tag);
+    if (efreet_xml_tag_close(doc, data, size, xml->tag)) return xml;
 
+    *open = 1;
     return xml;
 }
 
 static int
-efreet_xml_tag_parse(char **data, int *size, const char **tag)
+efreet_xml_tag_parse(Efreet_Xml_Document *doc, char **data, int *size, const char **tag)
 {
     const char *start = NULL, *end = NULL;
-    char buf[256];
-    int buf_size;
 
     /* Search for tag */
     while (*size > 1)
@@ -289,7 +557,7 @@ efreet_xml_tag_parse(char **data, int *size, const char **tag)
     if (!start)
     {
         ERR("missing start tag");
-        error = 1;
+        doc->error = 1;
         return 0;
     }
 
@@ -307,31 +575,32 @@ efreet_xml_tag_parse(char **data, int *size, const char **tag)
     if (!end)
     {
         ERR("no end of tag");
-        error = 1;
+        doc->error = 1;
         return 0;
     }
 
-    buf_size = end - start + 1;
-    if (buf_size <= 1)
+    if (end == start)
     {
         ERR("no tag name");
-        error = 1;
+        doc->error = 1;
         return 0;
     }
 
-    if (buf_size > 256) buf_size = 256;
-    memcpy(buf, start, buf_size - 1);
-    buf[buf_size - 1] = '\0';
-    *tag = eina_stringshare_add(buf);
+    *tag = efreet_xml_strndup(doc, start, end - start);
+    if (!*tag)
+    {
+        doc->error = 1;
+        return 0;
+    }
 
     return 1;
 }
 
 static void
-efreet_xml_attributes_parse(char **data, int *size,
+efreet_xml_attributes_parse(Efreet_Xml_Document *doc, char **data, int *size,
         Efreet_Xml_Attribute ***attributes)
 {
-    Efreet_Xml_Attribute attr[10];
+    Efreet_Xml_Attribute *attr[10];
     int i, count = 0;
 
     while (*size > 0)
@@ -346,11 +615,6 @@ efreet_xml_attributes_parse(char **data, int *size,
         {
             /* beginning of key */
             const char *start = NULL, *end = NULL;
-            char buf[256];
-            int buf_size;
-
-            attr[count].key = NULL;
-            attr[count].value = NULL;
 
             start = *data;
             while ((*size > 0) && ((isalpha(**data)) || (**data == '_')))
@@ -360,17 +624,15 @@ efreet_xml_attributes_parse(char **data, int *size,
             }
 
             end = *data;
-            buf_size = end - start + 1;
-            if (buf_size <= 1)
+            if (end == start)
             {
                 ERR("zero length key");
                 goto efreet_error;
             }
-
-            if (buf_size > 256) buf_size = 256;
-            memcpy(buf, start, buf_size - 1);
-            buf[buf_size - 1] = '\0';
-            attr[count].key = eina_stringshare_add(buf);
+            attr[count] = efreet_xml_alloc(doc, sizeof(Efreet_Xml_Attribute));
+            if (!attr[count]) goto efreet_error;
+            attr[count]->key = efreet_xml_strndup(doc, start, end - start);
+            if (!attr[count]->key) goto efreet_error;
 
             /* search for '=', key/value seperator */
             start = NULL;
@@ -434,17 +696,14 @@ efreet_xml_attributes_parse(char **data, int *size,
                 goto efreet_error;
             }
 
-            buf_size = end - start + 1;
-            if (buf_size <= 1)
+            if (end == start)
             {
                 ERR("zero length value");
                 goto efreet_error;
             }
 
-            if (buf_size > 256) buf_size = 256;
-            memcpy(buf, start, buf_size - 1);
-            buf[buf_size - 1] = '\0';
-            attr[count].value = eina_stringshare_add(buf);
+            attr[count]->value = efreet_xml_strndup(doc, start, end - start);
+            if (!attr[count]->value) goto efreet_error;
 
             count++;
         }
@@ -453,32 +712,23 @@ efreet_xml_attributes_parse(char **data, int *size,
         (*data)++;
     }
 
-    *attributes = NEW(Efreet_Xml_Attribute *, count + 1);
+    if (!count) return;
+    *attributes = efreet_xml_alloc(doc, (count + 1) * sizeof(Efreet_Xml_Attribute *));
     if (!*attributes) goto efreet_error;
     for (i = 0; i < count; i++)
-    {
-        (*attributes)[i] = malloc(sizeof(Efreet_Xml_Attribute));
-        (*attributes)[i]->key = attr[i].key;
-        (*attributes)[i]->value = attr[i].value;
-    }
+        (*attributes)[i] = attr[i];
     return;
 
 efreet_error:
-    while (count >= 0)
-    {
-        if (attr[count].key) eina_stringshare_del(attr[count].key);
-        if (attr[count].value) eina_stringshare_del(attr[count].value);
-        count--;
-    }
-    error = 1;
+    /* the arena goes with the document */
+    doc->error = 1;
     return;
 }
 
 static void
-efreet_xml_text_parse(char **data, int *size, const char **text)
+efreet_xml_text_parse(Efreet_Xml_Document *doc, char **data, int *size, const char **text)
 {
     const char *start = NULL, *end = NULL;
-    int buf_size;
 
     /* skip leading whitespace */
     while (*size > 0)
@@ -511,14 +761,14 @@ efreet_xml_text_parse(char **data, int *size, const char **text)
     while (isspace(*(end - 1))) end--;
 
     /* copy text */
-    buf_size = end - start + 1;
-    if (buf_size <= 1) return;
+    if (end == start) return;
 
-    *text = eina_stringshare_add_length(start, buf_size - 1);
+    *text = efreet_xml_strndup(doc, start, end - start);
+    if (!*text) doc->error = 1;
 }
 
 static int
-efreet_xml_tag_empty(char **data, int *size)
+efreet_xml_tag_empty(Efreet_Xml_Document *doc, char **data, int *size)
 {
     while (*size > 1)
     {
@@ -543,13 +793,13 @@ efreet_xml_tag_empty(char **data, int *size)
         (*data)++;
     }
     ERR("missing end of tag");
-    error = 1;
+    doc->error = 1;
 
     return 1;
 }
 
 static int
-efreet_xml_tag_close(char **data, int *size, const char *tag)
+efreet_xml_tag_close(Efreet_Xml_Document *doc, char **data, int *size, const char *tag)
 {
     while (*size > 1)
     {
@@ -562,7 +812,7 @@ efreet_xml_tag_close(char **data, int *size, const char *tag)
                 if ((int)strlen(tag) > *size)
                 {
                     ERR("wrong end tag");
-                    error = 1;
+                    doc->error = 1;
                     return 1;
                 }
                 else
@@ -578,7 +828,7 @@ efreet_xml_tag_close(char **data, int *size, const char *tag)
                     if (*tag)
                     {
                         ERR("wrong end tag");
-                        error = 1;
+                        doc->error = 1;
                         return 1;
                     }
                 }
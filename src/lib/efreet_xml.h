@@ -32,7 +32,8 @@ typedef struct Efreet_Xml Efreet_Xml;
 
 /**
  * Efreet_Xml
- * @brief Contains the XML tree for a given XML document
+ * @brief Contains the XML tree for a given XML document. Trees are shared
+ * between users of the same file and must not be changed.
  */
 struct Efreet_Xml
 {
@@ -41,7 +42,8 @@ struct Efreet_Xml
 
     Efreet_Xml_Attribute **attributes;  /**< The attributes for this node */
 
-    Eina_List *children;               /**< Child nodes */
+    Efreet_Xml **children;              /**< NULL terminated child nodes */
+    unsigned int children_count;        /**< The number of child nodes */
 };
 
 int efreet_xml_init(void);
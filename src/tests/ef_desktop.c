@@ -73,6 +73,32 @@ ef_cb_desktop_parse(void)
     return ret;
 }
 
+int
+ef_cb_desktop_overlay(void)
+{
+    Efreet_Desktop *desktop, *desktop2;
+    int ret = 1;
+
+    desktop = efreet_desktop_get(PKG_DATA_DIR"/test/test.desktop");
+    if (!desktop)
+    {
+        printf("No desktop found.\n");
+        return 0;
+    }
+
+    desktop2 = efreet_desktop_get(PKG_DATA_DIR"/test/test.desktop");
+    if (desktop2 != desktop)
+    {
+        printf("Desktop not shared between lookups\n");
+        ret = 0;
+    }
+
+    efreet_desktop_free(desktop2);
+    efreet_desktop_free(desktop);
+
+    return ret;
+}
+
 #if 0
 int
 ef_cb_desktop_file_id(void)
@@ -163,9 +189,10 @@ ef_cb_desktop_command_get(void)
 {
     Efreet_Desktop *desktop;
     Eina_List *files, *expected;
-    char olddir[PATH_MAX];
+    char olddir[PATH_MAX], buf[PATH_MAX];
+    const char *deprecated = "dDnNvm";
     Test_Info *info;
-    int ret;
+    int ret, i;
 
     if (getcwd(olddir, PATH_MAX) != 0) ret = 0;
     if (chdir("/") != 0) ret = 0;
@@ -315,7 +342,64 @@ ef_cb_desktop_command_get(void)
 
     info->expected = expected;
     efreet_desktop_command_get(desktop, NULL, _cb_command, info);
-    eina_list_free(expected);
+    expected = eina_list_free(expected);
+
+    /* test icon, name and path together, with a quote in the name */
+    info->type = 'c';
+    IF_FREE(desktop->exec);
+    desktop->exec = strdup("app %i %c %k");
+    IF_FREE(desktop->name);
+    desktop->name = strdup("App's Name");
+    expected = eina_list_append(expected, "app --icon 'icon.png' 'App'\\''s Name' 'test.desktop'");
+
+    info->expected = expected;
+    efreet_desktop_command_get(desktop, NULL, _cb_command, info);
+    expected = eina_list_free(expected);
+
+    /* test no icon */
+    info->type = 'i';
+    IF_FREE(desktop->exec);
+    desktop->exec = strdup("app %i");
+    IF_FREE(desktop->icon);
+    expected = eina_list_append(expected, "app ");
+
+    info->expected = expected;
+    efreet_desktop_command_get(desktop, NULL, _cb_command, info);
+    expected = eina_list_free(expected);
+
+    /* test escaped percent */
+    info->type = '%';
+    IF_FREE(desktop->exec);
+    desktop->exec = strdup("app --ratio=100%% %%f");
+    expected = eina_list_append(expected, "app --ratio=100% %f");
+
+    info->expected = expected;
+    efreet_desktop_command_get(desktop, NULL, _cb_command, info);
+    expected = eina_list_free(expected);
+
+    /* test trailing percent */
+    info->type = '%';
+    IF_FREE(desktop->exec);
+    desktop->exec = strdup("app %");
+    expected = eina_list_append(expected, "app ");
+
+    info->expected = expected;
+    efreet_desktop_command_get(desktop, NULL, _cb_command, info);
+    expected = eina_list_free(expected);
+
+    /* test deprecated fields, they are dropped */
+    for (i = 0; deprecated[i]; i++)
+    {
+        info->type = deprecated[i];
+        IF_FREE(desktop->exec);
+        snprintf(buf, sizeof(buf), "app %%%c --end", deprecated[i]);
+        desktop->exec = strdup(buf);
+        expected = eina_list_append(expected, "app  --end");
+
+        info->expected = expected;
+        efreet_desktop_command_get(desktop, NULL, _cb_command, info);
+        expected = eina_list_free(expected);
+    }
 
     /* clean up */
     efreet_desktop_free(desktop);
@@ -329,6 +413,55 @@ ef_cb_desktop_command_get(void)
     return ret;
 }
 
+int
+ef_cb_desktop_command_argv_get(void)
+{
+    Efreet_Desktop *desktop;
+    Eina_List *files, *argvs;
+    char **argv;
+    int i, ret = 1;
+    const char *expected[] = {
+        "app", "quoted \"arg\"", "/tmp/absolute_path", "/tmp/with space",
+        "--name=App Name", "--icon", "icon.png", NULL
+    };
+
+    desktop = efreet_desktop_empty_new("test.desktop");
+    desktop->name = strdup("App Name");
+    desktop->icon = strdup("icon.png");
+    desktop->exec = strdup("app \"quoted \\\"arg\\\"\" %F --name=%c %i");
+
+    files = NULL;
+    files = eina_list_append(files, "/tmp/absolute_path");
+    files = eina_list_append(files, "/tmp/with space");
+
+    argvs = efreet_desktop_command_argv_get(desktop, files);
+    if (eina_list_count(argvs) != 1)
+    {
+        printf("Expected one command, got %u\n", eina_list_count(argvs));
+        ret = 0;
+    }
+    EINA_LIST_FREE(argvs, argv)
+    {
+        for (i = 0; expected[i] || argv[i]; i++)
+        {
+            if (!expected[i] || !argv[i] || strcmp(expected[i], argv[i]))
+            {
+                printf("Expected argument %s, got %s\n",
+                       expected[i] ? expected[i] : "(null)",
+                       argv[i] ? argv[i] : "(null)");
+                ret = 0;
+                break;
+            }
+        }
+        free(argv);
+    }
+
+    efreet_desktop_free(desktop);
+    eina_list_free(files);
+
+    return ret;
+}
+
 static void *
 _cb_command(void *data, Efreet_Desktop *desktop __UNUSED__,
             char *exec, int remaining __UNUSED__)
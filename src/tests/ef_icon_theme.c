@@ -136,6 +136,53 @@ ef_cb_efreet_icon_theme_list(void)
     return ret;
 }
 
+int
+ef_cb_efreet_icon_theme_summary_list(void)
+{
+    int ret = 1;
+    Eina_List *themes;
+    Eina_List *summaries;
+    Eina_List *l;
+    Efreet_Icon_Theme *theme;
+    Efreet_Icon_Theme_Summary *summary;
+
+    themes = efreet_icon_theme_list_get();
+    summaries = efreet_icon_theme_summary_list();
+
+    if (eina_list_count(themes) != eina_list_count(summaries))
+    {
+        printf("efreet_icon_theme_summary_list() returned %d themes, "
+                "efreet_icon_theme_list_get() %d\n",
+                eina_list_count(summaries), eina_list_count(themes));
+        ret = 0;
+    }
+
+    EINA_LIST_FOREACH(summaries, l, summary)
+    {
+        theme = efreet_icon_theme_find(summary->name.internal);
+        if (!theme)
+        {
+            printf("efreet_icon_theme_summary_list() returned %s which "
+                    "efreet_icon_theme_find() doesn't know.\n", summary->name.internal);
+            ret = 0;
+            continue;
+        }
+        if ((theme->name.name != summary->name.name) &&
+            (!theme->name.name || !summary->name.name ||
+             strcmp(theme->name.name, summary->name.name)))
+        {
+            printf("Summary name for %s doesn't match the theme name.\n",
+                   summary->name.internal);
+            ret = 0;
+        }
+    }
+
+    eina_list_free(themes);
+    eina_list_free(summaries);
+
+    return ret;
+}
+
 static void
 ef_icon_theme_themes_find(const char *search_dir, Eina_Hash *themes)
 {
@@ -1,7 +1,12 @@
 #include "Efreet.h"
 #include "config.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include <unistd.h>
+#include <Ecore.h>
+#include <Ecore_File.h>
 
 #if 0
 static void
@@ -79,6 +84,142 @@ ef_cb_menu_save(void)
     return ret;
 }
 
+int
+ef_cb_menu_update(void)
+{
+    Efreet_Menu *menu;
+    Eina_List *changed;
+
+    menu = efreet_menu_parse(PKG_DATA_DIR"/test/test.menu");
+    if (!menu)
+    {
+        printf("efreet_menu_parse() returned NULL\n");
+        return 0;
+    }
+
+    /* nothing changed on disk, so a full rebuild must not touch the menu */
+    changed = efreet_menu_update(menu, NULL);
+    if (changed)
+    {
+        printf("efreet_menu_update() changed %d entries\n", eina_list_count(changed));
+        eina_list_free(changed);
+        efreet_menu_free(menu);
+        return 0;
+    }
+
+    efreet_menu_free(menu);
+    return 1;
+}
+
+static int
+ef_menu_count(Efreet_Menu *menu)
+{
+    Efreet_Menu *entry;
+    Eina_List *l;
+    int count = 0;
+
+    EINA_LIST_FOREACH(efreet_menu_entries_get(menu), l, entry)
+    {
+        count++;
+        if (entry->type == EFREET_MENU_ENTRY_MENU)
+            count += ef_menu_count(entry);
+    }
+    return count;
+}
+
+/* removes the processed menu caches, so the next parse builds the menu */
+static void
+ef_menu_cache_clear(void)
+{
+    Eina_List *files;
+    char dir[PATH_MAX], path[PATH_MAX];
+    char *file;
+
+    snprintf(dir, sizeof(dir), "%s/efreet", efreet_cache_home_get());
+    files = ecore_file_ls(dir);
+    EINA_LIST_FREE(files, file)
+    {
+        if (!strncmp(file, "menu_", 5))
+        {
+            snprintf(path, sizeof(path), "%s/%s", dir, file);
+            ecore_file_unlink(path);
+        }
+        free(file);
+    }
+}
+
+int
+ef_cb_menu_lazy(void)
+{
+    Efreet_Menu *menu, *lazy;
+    int ret = 1;
+
+    /* a lazy parse takes a complete menu from the menu cache */
+    ef_menu_cache_clear();
+    efreet_menu_lazy_set(EINA_TRUE);
+    lazy = efreet_menu_parse(PKG_DATA_DIR"/test/test.menu");
+    efreet_menu_lazy_set(EINA_FALSE);
+    menu = efreet_menu_parse(PKG_DATA_DIR"/test/test.menu");
+    if (!menu || !lazy)
+    {
+        printf("efreet_menu_parse() returned NULL\n");
+        ret = 0;
+    }
+    /* opening every sub menu must give the complete menu */
+    else if (ef_menu_count(menu) != ef_menu_count(lazy))
+    {
+        printf("lazy menu has %d entries, not %d\n",
+               ef_menu_count(lazy), ef_menu_count(menu));
+        ret = 0;
+    }
+
+    efreet_menu_free(menu);
+    efreet_menu_free(lazy);
+    return ret;
+}
+
+static void
+ef_menu_async_cb(void *data, Efreet_Menu *menu)
+{
+    Efreet_Menu **ret;
+
+    ret = data;
+    *ret = menu;
+    ecore_main_loop_quit();
+}
+
+int
+ef_cb_menu_async(void)
+{
+    Efreet_Menu *menu, *async = NULL;
+    int ret = 1;
+
+    /* build in the thread, not from the menu cache, and compare with a
+     * build on the main loop */
+    ef_menu_cache_clear();
+    efreet_menu_file_set(PKG_DATA_DIR"/test/test.menu");
+    if (efreet_menu_get_async(ef_menu_async_cb, &async))
+        ecore_main_loop_begin();
+    efreet_menu_file_set(NULL);
+    ef_menu_cache_clear();
+    menu = efreet_menu_parse(PKG_DATA_DIR"/test/test.menu");
+    if (!menu || !async)
+    {
+        printf("efreet_menu_get_async() gave no menu\n");
+        ret = 0;
+    }
+    else if (ef_menu_count(menu) != ef_menu_count(async))
+    {
+        printf("async menu has %d entries, not %d\n",
+               ef_menu_count(async), ef_menu_count(menu));
+        ret = 0;
+    }
+
+    efreet_menu_free(menu);
+    efreet_menu_free(async);
+    return ret;
+}
+
 int
 ef_cb_menu_edit(void)
 {
@@ -1,5 +1,13 @@
 #include "Efreet.h"
+/* no logging */
+#define EFREET_MODULE_LOG_DOM
+#include "efreet_private.h"
+#include "config.h"
+#include <Ecore_File.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 
 int
 ef_cb_utils(void)
@@ -26,3 +34,83 @@ ef_cb_utils(void)
 
     return 1;
 }
+
+int
+ef_cb_utils_wm_class(void)
+{
+    Efreet_Desktop *desktop;
+    char buf[PATH_MAX], dir[PATH_MAX];
+    int i, ret = 1;
+    const char *normalized[][2] = {
+        /* version suffixes */
+        {"Gimp-2.8", "gimp"},
+        {"VirtualBox_4.1.18", "virtualbox"},
+        {"2.8", "2.8"},
+        /* reverse DNS prefixes */
+        {"org.gnome.Nautilus", "nautilus"},
+        {"com.example.App-1.0", "app"},
+        {"libreoffice.writer", "libreoffice.writer"},
+        {"mozilla.firefox.bin", "mozilla.firefox.bin"},
+        /* case */
+        {"XTerm", "xterm"},
+        {NULL, NULL}
+    };
+    const char *matches[][3] = {
+        /* wm name, wm class, desktop file */
+        {"gimp-2.8", "Gimp-2.8", "gimp.desktop"},
+        {NULL, "GIMP", "gimp.desktop"},
+        {"nautilus", "Nautilus", "org.gnome.Nautilus.desktop"},
+        {NULL, "org.gnome.Nautilus", "org.gnome.Nautilus.desktop"},
+        {"xterm", "xterm", "xterm.desktop"},
+        {NULL, NULL, NULL}
+    };
+
+    printf("\n");
+
+    for (i = 0; normalized[i][0]; i++)
+    {
+        if (!efreet_util_wm_class_normalize(normalized[i][0], buf, sizeof(buf)) ||
+            strcmp(buf, normalized[i][1]))
+        {
+            printf("Normalized %s to %s, expected %s\n",
+                   normalized[i][0], buf, normalized[i][1]);
+            ret = 0;
+        }
+    }
+    if (efreet_util_wm_class_normalize("", buf, sizeof(buf)))
+    {
+        printf("Normalized an empty class\n");
+        ret = 0;
+    }
+
+    /* the tests don't update caches, build the one of the fixtures */
+    snprintf(dir, sizeof(dir), "/tmp/efreet_wm_class_XXXXXX");
+    if (!mkdtemp(dir)) return 0;
+    efreet_shutdown();
+    setenv("XDG_DATA_DIRS", PKG_DATA_DIR"/test/wm_class", 1);
+    setenv("XDG_DATA_HOME", dir, 1);
+    setenv("XDG_CACHE_HOME", dir, 1);
+    if (system(PACKAGE_LIB_DIR"/efreet/efreet_desktop_cache_create") != 0)
+    {
+        printf("Building the desktop cache failed\n");
+        ret = 0;
+    }
+    efreet_init();
+
+    for (i = 0; matches[i][2]; i++)
+    {
+        desktop = efreet_util_desktop_wm_class_match(matches[i][0], matches[i][1]);
+        if (!desktop || strcmp(ecore_file_file_get(desktop->orig_path), matches[i][2]))
+        {
+            printf("Matched %s %s to %s, expected %s\n",
+                   matches[i][0] ? matches[i][0] : "(null)", matches[i][1],
+                   desktop ? desktop->orig_path : "(null)", matches[i][2]);
+            ret = 0;
+        }
+        if (desktop) efreet_desktop_free(desktop);
+    }
+
+    ecore_file_recursive_rm(dir);
+
+    return ret;
+}
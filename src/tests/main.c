@@ -16,6 +16,7 @@ int ef_cb_efreet_data_dirs(void);
 int ef_cb_efreet_config_dirs(void);
 int ef_cb_efreet_icon_theme(void);
 int ef_cb_efreet_icon_theme_list(void);
+int ef_cb_efreet_icon_theme_summary_list(void);
 int ef_cb_efreet_icon_match(void);
 int ef_cb_ini_parse(void);
 int ef_cb_ini_long_line(void);
@@ -24,8 +25,10 @@ int ef_cb_ini_garbage(void);
 int ef_cb_locale(void);
 #endif
 int ef_cb_desktop_parse(void);
+int ef_cb_desktop_overlay(void);
 int ef_cb_desktop_save(void);
 int ef_cb_desktop_command_get(void);
+int ef_cb_desktop_command_argv_get(void);
 int ef_cb_desktop_type_parse(void);
 #if 0
 int ef_cb_desktop_file_id(void);
@@ -33,10 +36,14 @@ int ef_cb_desktop_file_id(void);
 int ef_cb_menu_get(void);
 int ef_cb_menu_with_slashes(void);
 int ef_cb_menu_save(void);
+int ef_cb_menu_update(void);
+int ef_cb_menu_lazy(void);
+int ef_cb_menu_async(void);
 #if 0
 int ef_cb_menu_edit(void);
 #endif
 int ef_cb_utils(void);
+int ef_cb_utils_wm_class(void);
 int ef_mime_cb_get(void);
 
 typedef struct Efreet_Test Efreet_Test;
@@ -54,6 +61,7 @@ static Efreet_Test tests[] = {
     {"Config Directories", ef_cb_efreet_config_dirs},
     {"Icon Theme Basic", ef_cb_efreet_icon_theme},
     {"Icon Theme List", ef_cb_efreet_icon_theme_list},
+    {"Icon Theme Summary List", ef_cb_efreet_icon_theme_summary_list},
     {"Icon Matching", ef_cb_efreet_icon_match},
     {"INI Parsing", ef_cb_ini_parse},
     {"INI Long Line Parsing", ef_cb_ini_long_line},
@@ -62,19 +70,25 @@ static Efreet_Test tests[] = {
     {"Locale Parsing", ef_cb_locale},
 #endif
     {"Desktop Parsing", ef_cb_desktop_parse},
+    {"Desktop Overlay", ef_cb_desktop_overlay},
     {"Desktop Type Parsing", ef_cb_desktop_type_parse},
     {"Desktop Save", ef_cb_desktop_save},
     {"Desktop Command", ef_cb_desktop_command_get},
+    {"Desktop Command Argv", ef_cb_desktop_command_argv_get},
 #if 0
     {"Desktop File ID", ef_cb_desktop_file_id},
 #endif
     {"Menu Parsing", ef_cb_menu_get},
     {"Menu Incorrect Names", ef_cb_menu_with_slashes},
     {"Menu Save", ef_cb_menu_save},
+    {"Menu Update", ef_cb_menu_update},
+    {"Menu Lazy", ef_cb_menu_lazy},
+    {"Menu Async", ef_cb_menu_async},
 #if 0
     {"Menu Edit", ef_cb_menu_edit},
 #endif
     {"Utils", ef_cb_utils},
+    {"Utils WM Class", ef_cb_utils_wm_class},
     {"Mime", ef_mime_cb_get},
     {NULL, NULL}
 };